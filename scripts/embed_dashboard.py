@@ -0,0 +1,71 @@
+"""Gzips web/dashboard.html into src/generated/dashboard_gz.h before each build.
+
+Runs as a PlatformIO pre-script (see extra_scripts in platformio.ini) and can
+also be run by hand: python scripts/embed_dashboard.py
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO's SCons environment
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "web", "dashboard.html")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "generated", "dashboard_gz.h")
+BYTES_PER_LINE = 16
+
+
+def render(html):
+    # mtime=0 keeps the bytes, and so the ETag, stable across rebuilds.
+    packed = gzip.compress(html, compresslevel=9, mtime=0)
+    digest = hashlib.sha256(packed).hexdigest()[:16]
+    lines = []
+    for offset in range(0, len(packed), BYTES_PER_LINE):
+        chunk = packed[offset:offset + BYTES_PER_LINE]
+        lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+    return "\n".join([
+        "// Generated by scripts/embed_dashboard.py from web/dashboard.html; do not edit.",
+        "#pragma once",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "namespace web {",
+        "namespace dashboard {",
+        "",
+        "// %d bytes of HTML, %d gzipped." % (len(html), len(packed)),
+        "constexpr size_t kGzipLength = %d;" % len(packed),
+        "constexpr const char* kEtag = \"\\\"%s\\\"\";" % digest,
+        "constexpr const char* kPath = \"/dashboard-%s.html\";" % digest[:8],
+        "// const, so it stays in flash and is sent from there.",
+        "alignas(4) inline constexpr uint8_t kGzip[kGzipLength] = {",
+        *lines,
+        "};",
+        "",
+        "}  // namespace dashboard",
+        "}  // namespace web",
+        "",
+    ]), len(html), len(packed)
+
+
+def main():
+    with open(SOURCE, "rb") as source:
+        html = source.read()
+    header, raw, packed = render(html)
+    try:
+        with open(OUTPUT, "r", encoding="utf-8") as existing:
+            if existing.read() == header:
+                return  # unchanged; do not force a rebuild
+    except FileNotFoundError:
+        pass
+    os.makedirs(os.path.dirname(OUTPUT), exist_ok=True)
+    with open(OUTPUT, "w", encoding="utf-8") as out:
+        out.write(header)
+    print("Embedded dashboard: %d bytes -> %d gzipped" % (raw, packed))
+
+
+main()
@@ -0,0 +1,145 @@
+"""Compares a `display:pbm` serial capture against the golden frames.
+
+Save the serial output of `display:pbm` to a file (the monitor's log is fine;
+lines that are not part of a frame are skipped), then:
+
+    python scripts/snapshot_diff.py capture.txt            # diff against test/golden/
+    python scripts/snapshot_diff.py capture.txt --update   # accept the capture as golden
+    python scripts/snapshot_diff.py capture.txt --out diffs/
+
+The capture is split on its `# snapshot <name>` lines. Each frame is compared
+pixel by pixel with test/golden/<name>.pbm. --out writes the captured frame and
+an XOR image of the differences for every frame that changed. The exit status
+is 1 when any frame differs, is missing a golden, or a golden was not captured.
+"""
+
+import argparse
+import os
+import sys
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+GOLDEN_DIR = os.path.join(PROJECT_DIR, "test", "golden")
+HEADER = "# snapshot "
+END = "end"
+
+
+def split_capture(lines):
+    """Returns {name: [pbm lines]} for every frame in a capture, in order."""
+    frames = {}
+    current = None
+    for raw in lines:
+        line = raw.strip()
+        if line.startswith(HEADER):
+            name = line[len(HEADER):].strip()
+            current = None if name == END else frames.setdefault(name, [])
+            if current is not None:
+                del current[:]  # a repeated name keeps the last capture
+            continue
+        if current is None or not line:
+            continue
+        if line == "P1" or line[0].isdigit():
+            current.append(line)
+    return frames
+
+
+def parse_pbm(lines):
+    """Plain PBM lines to (width, height, rows of 0/1 ints)."""
+    if not lines or lines[0] != "P1":
+        raise ValueError("not a plain PBM")
+    width, height = (int(v) for v in lines[1].split())
+    bits = [int(c) for c in "".join(lines[2:]) if c in "01"]
+    if len(bits) != width * height:
+        raise ValueError("expected %d pixels, got %d" % (width * height, len(bits)))
+    return width, height, [bits[y * width:(y + 1) * width] for y in range(height)]
+
+
+def format_pbm(width, height, rows):
+    # Same layout as writePbm(): each row split in two to stay under 70 columns.
+    half = width // 2
+    out = ["P1", "%d %d" % (width, height)]
+    for row in rows:
+        text = "".join(str(bit) for bit in row)
+        out.append(text[:half])
+        out.append(text[half:])
+    return "\n".join(out) + "\n"
+
+
+def compare(captured, golden):
+    """Returns (changed pixel count, (x0, y0, x1, y1) or None, xor rows)."""
+    width, height, rows = captured
+    if golden[:2] != (width, height):
+        return width * height, (0, 0, width - 1, height - 1), rows
+    xor = [[a ^ b for a, b in zip(row, golden_row)] for row, golden_row in zip(rows, golden[2])]
+    points = [(x, y) for y, row in enumerate(xor) for x, bit in enumerate(row) if bit]
+    if not points:
+        return 0, None, xor
+    xs = [p[0] for p in points]
+    ys = [p[1] for p in points]
+    return len(points), (min(xs), min(ys), max(xs), max(ys)), xor
+
+
+def write(path, text):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w", encoding="ascii") as out:
+        out.write(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="serial output of display:pbm")
+    parser.add_argument("--golden", default=GOLDEN_DIR, help="golden frame directory (default: test/golden)")
+    parser.add_argument("--update", action="store_true", help="write the captured frames as the new goldens")
+    parser.add_argument("--out", help="directory for the captured and XOR images of changed frames")
+    args = parser.parse_args()
+
+    with open(args.capture, "r", encoding="utf-8", errors="replace") as capture:
+        frames = split_capture(capture)
+    if not frames:
+        print("No '%s<name>' frames in %s" % (HEADER, args.capture))
+        return 1
+
+    failures = 0
+    matched = 0
+    for name, lines in frames.items():
+        try:
+            captured = parse_pbm(lines)
+        except (ValueError, IndexError) as error:
+            print("%-20s BROKEN  %s" % (name, error))
+            failures += 1
+            continue
+        golden_path = os.path.join(args.golden, name + ".pbm")
+        if args.update:
+            write(golden_path, format_pbm(*captured))
+            print("%-20s written" % name)
+            continue
+        if not os.path.exists(golden_path):
+            print("%-20s NEW     no golden (run with --update to accept it)" % name)
+            failures += 1
+            continue
+        with open(golden_path, "r", encoding="ascii") as golden_file:
+            golden = parse_pbm([line.strip() for line in golden_file if line.strip()])
+        changed, box, xor = compare(captured, golden)
+        if changed == 0:
+            print("%-20s ok" % name)
+            matched += 1
+            continue
+        failures += 1
+        print("%-20s DIFF    %d pixels in (%d,%d)-(%d,%d)" % ((name, changed) + box))
+        if args.out:
+            width, height = captured[:2]
+            write(os.path.join(args.out, name + ".pbm"), format_pbm(*captured))
+            write(os.path.join(args.out, name + ".diff.pbm"), format_pbm(width, height, xor))
+
+    if not args.update and os.path.isdir(args.golden):
+        for entry in sorted(os.listdir(args.golden)):
+            if entry.endswith(".pbm") and entry[:-4] not in frames:
+                print("%-20s MISSING golden not in the capture" % entry[:-4])
+                failures += 1
+
+    if not args.update:
+        print("%d of %d frames match" % (matched, len(frames)))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
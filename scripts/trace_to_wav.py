@@ -0,0 +1,95 @@
+"""Renders an `audio:trace` event log to a square-wave WAV file.
+
+Record a trace (e.g. `audio:trace:boot`), send `audio:trace`, save the serial
+output to a file, then:
+
+    python scripts/trace_to_wav.py capture.txt boot.wav
+
+Only the event lines of the dump are used ("<us> us  <Hz> Hz (div <n>)" and
+"<us> us  off"); anything else in the capture is skipped. Pitches come from the
+LEDC dividers and the clock settings in src/hardware_config.h, so the file plays
+what the buzzer was told to play, at the captured timestamps.
+"""
+
+import argparse
+import array
+import os
+import re
+import sys
+import wave
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+HARDWARE_CONFIG = os.path.join(PROJECT_DIR, "src", "hardware_config.h")
+EVENT = re.compile(r"^\s*(\d+) us\s+(?:off|\d+ Hz \(div (\d+)\))\s*$")
+TAIL_US = 200000  # silence after the last event, so the end is audible
+
+
+def ledc_settings():
+    """(clock Hz, resolution bits) as the firmware is built."""
+    with open(HARDWARE_CONFIG, "r", encoding="utf-8") as source:
+        text = source.read()
+    clock = re.search(r"BUZZER_LEDC_CLOCK_HZ\s*=\s*(\d+)", text)
+    bits = re.search(r"BUZZER_LEDC_RESOLUTION\s*=\s*(\d+)", text)
+    if clock is None or bits is None:
+        raise SystemExit("BUZZER_LEDC_CLOCK_HZ/RESOLUTION not found in %s" % HARDWARE_CONFIG)
+    return int(clock.group(1)), int(bits.group(1))
+
+
+def parse_events(lines):
+    """[(time us, divider Q8 or 0)] from the event lines of a dump."""
+    events = []
+    for line in lines:
+        match = EVENT.match(line)
+        if match:
+            events.append((int(match.group(1)), int(match.group(2) or 0)))
+    return events
+
+
+def render(events, rate, volume, clock_hz, resolution_bits):
+    """16-bit mono samples; the phase carries across notes like the timer's."""
+    end_us = events[-1][0] + TAIL_US
+    samples = array.array("h", [0]) * (end_us * rate // 1000000)
+    amplitude = int(32767 * volume)
+    phase = 0.0
+    for index, (start_us, divider) in enumerate(events):
+        stop_us = events[index + 1][0] if index + 1 < len(events) else end_us
+        first = start_us * rate // 1000000
+        last = min(stop_us * rate // 1000000, len(samples))
+        if divider == 0:
+            continue
+        hz = clock_hz * 256.0 / ((1 << resolution_bits) * divider)
+        step = hz / rate
+        for n in range(first, last):
+            samples[n] = amplitude if phase < 0.5 else -amplitude
+            phase = (phase + step) % 1.0
+    return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="serial output containing an audio:trace dump")
+    parser.add_argument("output", help="WAV file to write")
+    parser.add_argument("--rate", type=int, default=44100, help="sample rate (default 44100)")
+    parser.add_argument("--volume", type=float, default=0.3, help="0..1 (default 0.3)")
+    args = parser.parse_args()
+
+    with open(args.capture, "r", encoding="utf-8", errors="replace") as capture:
+        events = parse_events(capture)
+    if not events:
+        print("No trace events in %s" % args.capture)
+        return 1
+    clock_hz, resolution_bits = ledc_settings()
+    samples = render(events, args.rate, max(0.0, min(args.volume, 1.0)), clock_hz, resolution_bits)
+    if sys.byteorder != "little":
+        samples.byteswap()
+    with wave.open(args.output, "wb") as out:
+        out.setnchannels(1)
+        out.setsampwidth(2)
+        out.setframerate(args.rate)
+        out.writeframes(samples.tobytes())
+    print("Wrote %s: %d events, %.2f s" % (args.output, len(events), len(samples) / float(args.rate)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,58 @@
+#include "alloc_counter.h"
+
+#ifndef PLANTEY_ALLOC_TRACKING
+#define PLANTEY_ALLOC_TRACKING 0
+#endif
+
+namespace diag {
+namespace {
+volatile TaskHandle_t trackedTask = nullptr;
+AllocCounts counts;  // written only by trackedTask
+
+inline void record(size_t bytes) {
+  if (trackedTask != nullptr && xTaskGetCurrentTaskHandle() == trackedTask) {
+    ++counts.calls;
+    counts.bytes += bytes;
+  }
+}
+}  // namespace
+
+bool allocTrackingEnabled() {
+  return PLANTEY_ALLOC_TRACKING != 0;
+}
+
+void trackAllocations(TaskHandle_t task) {
+  counts = AllocCounts();
+  trackedTask = task;
+}
+
+AllocCounts allocCounts() {
+  return counts;
+}
+
+}  // namespace diag
+
+#if PLANTEY_ALLOC_TRACKING
+// Linked in place of the C allocator by -Wl,--wrap=...; newlib's internal
+// _malloc_r (used by printf) goes straight to the heap and is not seen.
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  diag::record(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  diag::record(count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  diag::record(size);
+  return __real_realloc(ptr, size);
+}
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Counts heap allocations made by one task. Only builds with
+// PLANTEY_ALLOC_TRACKING=1 (the bench environment in platformio.ini, which
+// links malloc/calloc/realloc through wrappers) see any; elsewhere the
+// counters stay at zero and allocTrackingEnabled() is false.
+namespace diag {
+
+struct AllocCounts {
+  uint32_t calls = 0;
+  uint32_t bytes = 0;
+};
+
+bool allocTrackingEnabled();
+// Counts from now on only for task (nullptr stops counting).
+void trackAllocations(TaskHandle_t task);
+AllocCounts allocCounts();
+
+}  // namespace diag
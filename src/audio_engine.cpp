@@ -1,168 +1,590 @@
 #include "audio_engine.h"
 
 #include <algorithm>
+#include <driver/ledc.h>
+
+#include "logging.h"
+#include "melody_dsl.h"
 
 namespace audio {
 namespace {
 
-constexpr MelodyStep kBootMelody[] = {
-    {415.3f, 180, 45},
-    {554.4f, 200, 30},
-    {659.3f, 240, 60},
-    {830.6f, 260, 140},
-};
-
-constexpr MelodyStep kAmbientMelody[] = {
-    {246.9f, 180, 30},
-    {329.6f, 170, 40},
-    {415.3f, 200, 70},
-    {0.0f, 0, 160},
-    {311.1f, 170, 30},
-    {466.2f, 210, 80},
-    {0.0f, 0, 240},
-};
+constexpr const char* kLogTagAudio = "audio";
+constexpr ledc_mode_t kBuzzerMode = LEDC_LOW_SPEED_MODE;
+constexpr ledc_channel_t kBuzzerChannel = static_cast<ledc_channel_t>(hw::BUZZER_LEDC_CHANNEL);
+constexpr ledc_timer_t kBuzzerTimer = static_cast<ledc_timer_t>(hw::BUZZER_LEDC_TIMER);
+constexpr uint32_t kHalfDuty = (1UL << hw::BUZZER_LEDC_RESOLUTION) / 2;
+// Never arm the timer closer than this; esp_timer rejects very short periods.
+constexpr int64_t kMinTimerPeriodUs = 50;
+
+constexpr auto kBootMelody = PLANTEY_MELODY("G#4:180/45 C#5:200/30 E5:240/60 G#5:260/140");
+
+constexpr auto kAmbientMelody = PLANTEY_MELODY(
+    "B3:180/30 E4:170/40 G#4:200/70 R:160 "
+    "D#4:170/30 A#4:210/80 R:240");
+
+constexpr uint32_t kAmbientResumeDelayMs = 6000;
+// How long a request may wait in the queue, indexed by SoundPriority.
+constexpr uint16_t kDefaultTtlMs[] = {0, 250, 5000, 30000};
+
+// Steps are timed from their nominal start so lateness does not accumulate,
+// unless a step ran so late (loop-driven fallback) that catching up would be audible.
+constexpr int64_t kResyncUs = 20000;
+
+int64_t onSchedule(int64_t nominalUs, int64_t nowUs) {
+  return (nowUs - nominalUs >= kResyncUs) ? nowUs : nominalUs;
+}
 
 }  // namespace
 
 void AudioEngine::begin() {
+#if PLANTEY_AUDIO_SYNTH
+  if (!synth_.begin()) {
+    LOG_ERROR(kLogTagAudio, "Synth sample timer unavailable; audio is silent");
+  }
+#else
   ledcSetup(hw::BUZZER_LEDC_CHANNEL, 2000, hw::BUZZER_LEDC_RESOLUTION);
   ledcAttachPin(hw::PIN_BUZZER, hw::BUZZER_LEDC_CHANNEL);
+#endif
+
+  esp_timer_create_args_t args = {};
+  args.callback = &AudioEngine::onTimer;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "audio-seq";
+  if (esp_timer_create(&args, &timer_) != ESP_OK) {
+    timer_ = nullptr;
+    LOG_WARN(kLogTagAudio, "Sequencer timer unavailable; stepping from loop()");
+  }
   stop();
 }
 
-void AudioEngine::playTone(float frequencyHz, uint16_t durationMs) {
-  stopMelody();
-  ambientMode_ = false;
-  if (frequencyHz <= 0.0f) {
-    stop();
-    return;
+SoundRequest SoundRequest::tone(uint32_t dividerQ8, uint16_t durationMs, SoundPriority priority, uint8_t coalesceKey) {
+  SoundRequest request;
+  request.kind = Kind::Tone;
+  request.priority = priority;
+  request.coalesceKey = coalesceKey;
+  request.ttlMs = kDefaultTtlMs[static_cast<uint8_t>(priority)];
+  request.durationMs = durationMs;
+  request.noteCount = 1;
+  request.dividers[0] = dividerQ8;
+  return request;
+}
+
+SoundRequest SoundRequest::chord(std::initializer_list<uint32_t> dividersQ8,
+                                 uint16_t durationMs,
+                                 uint16_t cycleMs,
+                                 SoundPriority priority,
+                                 uint8_t coalesceKey) {
+  SoundRequest request;
+  request.kind = Kind::Chord;
+  request.priority = priority;
+  request.coalesceKey = coalesceKey;
+  request.ttlMs = kDefaultTtlMs[static_cast<uint8_t>(priority)];
+  request.durationMs = durationMs;
+  request.cycleMs = cycleMs;
+  for (uint32_t divider : dividersQ8) {
+    if (request.noteCount >= kMaxNotes) {
+      break;
+    }
+    request.dividers[request.noteCount++] = divider;
   }
-  startTonePlayback(frequencyHz, durationMs);
+  return request;
 }
 
-void AudioEngine::playChord(std::initializer_list<float> frequenciesHz, uint16_t durationMs, uint16_t cycleMs) {
-  stopMelody();
-  ambientMode_ = false;
-  chordNoteCount_ = std::min(frequenciesHz.size(), chordFrequencies_.size());
-  if (chordNoteCount_ == 0) {
-    stop();
-    return;
+SoundRequest SoundRequest::melody(const MelodyStep* steps, size_t count, SoundPriority priority, uint8_t coalesceKey) {
+  SoundRequest request;
+  request.kind = Kind::Melody;
+  request.priority = priority;
+  request.coalesceKey = coalesceKey;
+  request.ttlMs = kDefaultTtlMs[static_cast<uint8_t>(priority)];
+  request.steps = steps;
+  request.stepCount = count;
+  return request;
+}
+
+bool AudioEngine::submit(const SoundRequest& request) {
+  uint32_t now = millis();
+  ++queueStats_.submitted;
+
+  // Feedback retriggers itself (the newest press matters); anything else merges
+  // into an identical sound that is already playing.
+  if (request.coalesceKey != 0 && foreground_ && isPlaying() && request.coalesceKey == activeKey_ &&
+      request.priority != SoundPriority::Feedback) {
+    ++queueStats_.merged;
+    return false;
   }
-  size_t index = 0;
-  for (float freq : frequenciesHz) {
-    if (index >= chordNoteCount_) {
-      break;
+
+  QueuedSound* slot = nullptr;
+  for (QueuedSound& queued : queue_) {
+    if (queued.used && request.coalesceKey != 0 && queued.request.coalesceKey == request.coalesceKey) {
+      SoundPriority priority = std::max(queued.request.priority, request.priority);
+      queued.request = request;
+      queued.request.priority = priority;
+      queued.enqueuedMs = now;
+      ++queueStats_.merged;
+      serviceQueue(now);
+      return false;
+    }
+    if (!queued.used && slot == nullptr) {
+      slot = &queued;
     }
-    chordFrequencies_[index++] = freq;
   }
-  playbackDurationMs_ = durationMs;
-  chordCycleMs_ = std::max<uint16_t>(cycleMs, 4);
-  chordMode_ = true;
-  currentChordIndex_ = 0;
-  startPlayback();
-  applyFrequency(chordFrequencies_[currentChordIndex_]);
-  lastChordSwitchMs_ = millis();
+
+  if (slot == nullptr) {
+    // Full: evict the oldest of the lowest priority entries if the newcomer outranks it.
+    QueuedSound* victim = &queue_[0];
+    for (QueuedSound& queued : queue_) {
+      if (queued.request.priority < victim->request.priority ||
+          (queued.request.priority == victim->request.priority &&
+           static_cast<int32_t>(queued.enqueuedMs - victim->enqueuedMs) < 0)) {
+        victim = &queued;
+      }
+    }
+    if (victim->request.priority >= request.priority) {
+      ++queueStats_.dropped;
+      return false;
+    }
+    ++queueStats_.evicted;
+    slot = victim;
+  }
+
+  slot->request = request;
+  slot->enqueuedMs = now;
+  slot->used = true;
+  serviceQueue(now);
+  return true;
 }
 
-void AudioEngine::playMelody(const MelodyStep* steps, size_t count, bool loop, bool ambient) {
-  stopMelody();
-  ambientMode_ = ambient;
-  if (steps == nullptr || count == 0) {
+void AudioEngine::setAmbientEnabled(bool enabled) {
+  if (enabled == ambientEnabled_) {
     return;
   }
-  melody_ = steps;
-  melodyCount_ = count;
-  melodyLoop_ = loop;
-  melodyIndex_ = 0;
-  activeMelodyIndex_ = 0;
-  melodyActive_ = true;
-  melodyInPause_ = false;
-  melodyCurrentPauseMs_ = 0;
-  handleMelody(millis());
+  ambientEnabled_ = enabled;
+  ambientResumeAtMs_ = millis() + kAmbientResumeDelayMs;
+  if (!enabled) {
+    stopAmbient();
+  }
+}
+
+void AudioEngine::playTone(uint32_t dividerQ8, uint16_t durationMs) {
+  foreground_ = true;
+  activePriority_ = SoundPriority::Cue;
+  activeKey_ = 0;
+  startTone(dividerQ8, durationMs);
+}
+
+void AudioEngine::playChord(std::initializer_list<uint32_t> dividersQ8, uint16_t durationMs, uint16_t cycleMs) {
+  SoundRequest request = SoundRequest::chord(dividersQ8, durationMs, cycleMs, SoundPriority::Cue);
+  foreground_ = true;
+  activePriority_ = request.priority;
+  activeKey_ = 0;
+  startChord(request.dividers.data(), request.noteCount, durationMs, cycleMs);
+}
+
+void AudioEngine::playMelody(const MelodyStep* steps, size_t count, bool loop, bool ambient) {
+  foreground_ = !ambient;
+  activePriority_ = ambient ? SoundPriority::Ambient : SoundPriority::Cue;
+  activeKey_ = 0;
+  startMelody(steps, count, loop, ambient);
 }
 
 void AudioEngine::playBootSequence() {
-  playMelody(kBootMelody, sizeof(kBootMelody) / sizeof(MelodyStep), false, false);
+  submit(SoundRequest::melody(kBootMelody.data(), kBootMelody.size(), SoundPriority::Cue));
 }
 
 void AudioEngine::playAmbientLoop() {
   if (!ambientMode_) {
-    playMelody(kAmbientMelody, sizeof(kAmbientMelody) / sizeof(MelodyStep), true, true);
+    playMelody(kAmbientMelody.data(), kAmbientMelody.size(), true, true);
   }
 }
 
 void AudioEngine::stopAmbient() {
   if (ambientMode_) {
     stop();
-    ambientMode_ = false;
   }
 }
 
 void AudioEngine::update() {
-  uint32_t now = millis();
+  if (timer_ == nullptr) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    fireDue(now);
+    portEXIT_CRITICAL(&lock_);
+  }
+  serviceQueue(millis());
+}
+
+void AudioEngine::serviceQueue(uint32_t nowMs) {
+  if (foreground_ && !isPlaying()) {
+    foreground_ = false;
+    activePriority_ = SoundPriority::Ambient;
+    activeKey_ = 0;
+    ambientResumeAtMs_ = nowMs + kAmbientResumeDelayMs;
+  }
 
+  for (QueuedSound& queued : queue_) {
+    if (queued.used && nowMs - queued.enqueuedMs > queued.request.ttlMs) {
+      queued.used = false;
+      ++queueStats_.expired;
+    }
+  }
+
+  int8_t next = nextQueued();
+  if (next >= 0 && outranksCurrent(queue_[next].request)) {
+    if (foreground_ && isPlaying()) {
+      ++queueStats_.preempted;
+    }
+    queue_[next].used = false;
+    startRequest(queue_[next].request);
+    return;
+  }
+
+  if (ambientEnabled_ && !ambientMode_ && !foreground_ && next < 0 &&
+      static_cast<int32_t>(nowMs - ambientResumeAtMs_) >= 0) {
+    playAmbientLoop();
+  }
+}
+
+int8_t AudioEngine::nextQueued() const {
+  int8_t best = -1;
+  for (uint8_t i = 0; i < kQueueSize; ++i) {
+    if (!queue_[i].used) {
+      continue;
+    }
+    if (best < 0 || queue_[i].request.priority > queue_[best].request.priority ||
+        (queue_[i].request.priority == queue_[best].request.priority &&
+         static_cast<int32_t>(queue_[i].enqueuedMs - queue_[best].enqueuedMs) < 0)) {
+      best = static_cast<int8_t>(i);
+    }
+  }
+  return best;
+}
+
+bool AudioEngine::outranksCurrent(const SoundRequest& request) const {
+  if (!foreground_ || !isPlaying()) {
+    return true;  // idle or only ambient
+  }
+  if (request.priority > activePriority_) {
+    return true;
+  }
+  return request.priority == SoundPriority::Feedback && activePriority_ == SoundPriority::Feedback;
+}
+
+void AudioEngine::startRequest(const SoundRequest& request) {
+  foreground_ = true;
+  activePriority_ = request.priority;
+  activeKey_ = request.coalesceKey;
+  switch (request.kind) {
+    case SoundRequest::Kind::Tone:
+      startTone(request.dividers[0], request.durationMs);
+      break;
+    case SoundRequest::Kind::Chord:
+      startChord(request.dividers.data(), request.noteCount, request.durationMs, request.cycleMs);
+      break;
+    case SoundRequest::Kind::Melody:
+      startMelody(request.steps, request.stepCount, false, false);
+      break;
+  }
+}
+
+void AudioEngine::startTone(uint32_t dividerQ8, uint16_t durationMs) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&lock_);
+  stopMelody();
+  ambientMode_ = false;
+  if (dividerQ8 == 0) {
+    stopLocked();
+  } else {
+    startTonePlayback(dividerQ8, durationMs, now);
+  }
+  arm(now);
+  portEXIT_CRITICAL(&lock_);
+}
+
+void AudioEngine::startChord(const uint32_t* dividers, size_t count, uint16_t durationMs, uint16_t cycleMs) {
+  count = std::min(count, kMaxChordNotes);
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&lock_);
+  stopMelody();
+  ambientMode_ = false;
+  if (count == 0) {
+    stopLocked();
+  } else {
+    std::copy(dividers, dividers + count, chordDividers_.begin());
+    chordNoteCount_ = count;
+    playbackDurationUs_ = static_cast<uint32_t>(durationMs) * 1000UL;
+    chordCycleUs_ = static_cast<uint32_t>(std::max<uint16_t>(cycleMs, 4)) * 1000UL;
+    chordMode_ = true;
+    currentChordIndex_ = 0;
+    startPlayback(now);
+    applyChord();
+    lastChordSwitchUs_ = now;
+  }
+  arm(now);
+  portEXIT_CRITICAL(&lock_);
+}
+
+void AudioEngine::startMelody(const MelodyStep* steps, size_t count, bool loop, bool ambient) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&lock_);
+  stopMelody();
+  ambientMode_ = ambient;
+  if (steps != nullptr && count > 0) {
+    melody_ = steps;
+    melodyCount_ = count;
+    melodyLoop_ = loop;
+    melodyIndex_ = 0;
+    activeMelodyIndex_ = 0;
+    melodyActive_ = true;
+    melodyInPause_ = false;
+    melodyCurrentPauseUs_ = 0;
+    handleMelody(now);
+  }
+  arm(now);
+  portEXIT_CRITICAL(&lock_);
+}
+
+void AudioEngine::stop() {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&lock_);
+  stopLocked();
+  arm(now);
+  portEXIT_CRITICAL(&lock_);
+}
+
+SequencerStats AudioEngine::timingStats() const {
+  SequencerStats stats;
+  portENTER_CRITICAL(&lock_);
+  stats.hardwareTimer = timer_ != nullptr;
+  stats.events = lateEvents_;
+  stats.maxLatenessUs = maxLatenessUs_;
+  stats.meanLatenessUs = lateEvents_ > 0 ? static_cast<uint32_t>(totalLatenessUs_ / lateEvents_) : 0;
+  portEXIT_CRITICAL(&lock_);
+  return stats;
+}
+
+void AudioEngine::resetTimingStats() {
+  portENTER_CRITICAL(&lock_);
+  lateEvents_ = 0;
+  maxLatenessUs_ = 0;
+  totalLatenessUs_ = 0;
+  portEXIT_CRITICAL(&lock_);
+}
+
+void AudioEngine::startTrace(TraceTarget target) {
+  stop();
+  portENTER_CRITICAL(&lock_);
+  traceTarget_ = target;
+  trace_.start(traceReference(target, nullptr, SequenceTrace::kCapacity));
+  portEXIT_CRITICAL(&lock_);
+
+  switch (target) {
+    case TraceTarget::Boot:
+      playMelody(kBootMelody.data(), kBootMelody.size());
+      break;
+    case TraceTarget::Ambient:
+      playMelody(kAmbientMelody.data(), kAmbientMelody.size(), true, true);
+      break;
+    case TraceTarget::Chord:
+      playChord({kDemoChord[0], kDemoChord[1], kDemoChord[2]}, kDemoChordMs, kDemoChordCycleMs);
+      break;
+  }
+}
+
+TraceReport AudioEngine::traceReport() const {
+  TraceEvent reference[SequenceTrace::kCapacity];
+  size_t count = traceReference(traceTarget_, reference, SequenceTrace::kCapacity);
+  portENTER_CRITICAL(&lock_);
+  TraceReport report = trace_.compare(reference, count);
+  portEXIT_CRITICAL(&lock_);
+  return report;
+}
+
+// The nominal transitions for one pass of target, as the sequencer should
+// write them. With out == nullptr only the count is returned.
+size_t AudioEngine::traceReference(TraceTarget target, TraceEvent* out, size_t capacity) const {
+  size_t count = 0;
+  uint32_t lastDivider = 0;
+  auto push = [&](uint32_t atMs, uint32_t dividerQ8) {
+    if (dividerQ8 == lastDivider || count >= capacity) {
+      return;
+    }
+    if (out != nullptr) {
+      out[count] = {static_cast<uint32_t>(atMs * 1000UL), dividerQ8};
+    }
+    ++count;
+    lastDivider = dividerQ8;
+  };
+
+  if (target == TraceTarget::Chord) {
+    constexpr size_t kNotes = sizeof(kDemoChord) / sizeof(kDemoChord[0]);
+    if (kPolyphonic) {
+      push(0, kDemoChord[0]);
+    } else {
+      for (uint32_t t = 0, i = 0; t < kDemoChordMs; t += kDemoChordCycleMs, ++i) {
+        push(t, kDemoChord[i % kNotes]);
+      }
+    }
+    push(kDemoChordMs, 0);
+    return count;
+  }
+
+  const MelodyStep* steps = target == TraceTarget::Boot ? kBootMelody.data() : kAmbientMelody.data();
+  size_t stepCount = target == TraceTarget::Boot ? kBootMelody.size() : kAmbientMelody.size();
+  uint32_t t = 0;
+  for (size_t i = 0; i < stepCount; ++i) {
+    const MelodyStep& step = steps[i];
+    if (step.dividerQ8 != 0 && step.durationMs != 0) {
+      push(t, step.dividerQ8);
+      push(t + step.durationMs, 0);
+      t += step.durationMs;
+    }
+    t += step.pauseMs;
+  }
+  return count;
+}
+
+void AudioEngine::onTimer(void* arg) {
+  auto* engine = static_cast<AudioEngine*>(arg);
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&engine->lock_);
+  engine->fireDue(now);
+  portEXIT_CRITICAL(&engine->lock_);
+}
+
+void AudioEngine::fireDue(int64_t nowUs) {
+  if (deadlineUs_ == 0 || nowUs < deadlineUs_) {
+    return;
+  }
+  uint32_t lateness = static_cast<uint32_t>(nowUs - deadlineUs_);
+  ++lateEvents_;
+  totalLatenessUs_ += lateness;
+  maxLatenessUs_ = std::max(maxLatenessUs_, lateness);
+  service(nowUs);
+  arm(nowUs);
+}
+
+void AudioEngine::service(int64_t nowUs) {
   if (playing_) {
-    if (playbackDurationMs_ > 0 && (now - playbackStartMs_) >= playbackDurationMs_) {
+    int64_t toneEnd = playbackStartUs_ + playbackDurationUs_;
+    if (playbackDurationUs_ > 0 && nowUs >= toneEnd) {
       finishPlayback();
-      if (melodyActive_) {
-        melodyInPause_ = true;
-        melodyPauseStartMs_ = now;
-      } else {
+      if (!melodyActive_) {
         return;
       }
+      melodyInPause_ = true;
+      melodyPauseStartUs_ = onSchedule(toneEnd, nowUs);
     }
 
-    if (chordMode_ && chordNoteCount_ > 1 && (now - lastChordSwitchMs_) >= chordCycleMs_) {
+    if (arpeggiated() && nowUs - lastChordSwitchUs_ >= chordCycleUs_) {
       currentChordIndex_ = (currentChordIndex_ + 1) % chordNoteCount_;
-      applyFrequency(chordFrequencies_[currentChordIndex_]);
-      lastChordSwitchMs_ = now;
+      applyChord();
+      lastChordSwitchUs_ = onSchedule(lastChordSwitchUs_ + chordCycleUs_, nowUs);
     }
   }
 
   if (melodyActive_) {
-    handleMelody(now);
+    handleMelody(nowUs);
   }
 }
 
-void AudioEngine::stop() {
-  finishPlayback();
-  stopMelody();
-  ambientMode_ = false;
+void AudioEngine::arm(int64_t nowUs) {
+  int64_t next = 0;
+  auto consider = [&next](int64_t at) {
+    if (next == 0 || at < next) {
+      next = at;
+    }
+  };
+  if (playing_) {
+    if (playbackDurationUs_ > 0) {
+      consider(playbackStartUs_ + playbackDurationUs_);
+    }
+    if (arpeggiated()) {
+      consider(lastChordSwitchUs_ + chordCycleUs_);
+    }
+  }
+  if (melodyActive_ && melodyInPause_) {
+    consider(melodyPauseStartUs_ + melodyCurrentPauseUs_);
+  }
+  deadlineUs_ = next;
+
+  if (timer_ == nullptr) {
+    return;
+  }
+  esp_timer_stop(timer_);
+  if (next != 0) {
+    esp_timer_start_once(timer_, static_cast<uint64_t>(std::max<int64_t>(next - nowUs, kMinTimerPeriodUs)));
+  }
 }
 
-void AudioEngine::startTonePlayback(float frequencyHz, uint16_t durationMs) {
-  playbackDurationMs_ = durationMs;
+void AudioEngine::startTonePlayback(uint32_t dividerQ8, uint16_t durationMs, int64_t atUs) {
+  playbackDurationUs_ = static_cast<uint32_t>(durationMs) * 1000UL;
   chordMode_ = false;
   chordNoteCount_ = 1;
   melodyInPause_ = false;
-  startPlayback();
-  applyFrequency(frequencyHz);
+  startPlayback(atUs);
+  applyDivider(dividerQ8);
 }
 
-void AudioEngine::applyFrequency(float frequencyHz) {
-  if (frequencyHz <= 0.0f) {
-    ledcWrite(hw::BUZZER_LEDC_CHANNEL, 0);
-    currentFrequency_ = 0.0f;
+// Register writes only: safe from the timer task and inside the critical section.
+void AudioEngine::applyDivider(uint32_t dividerQ8) {
+  trace_.record(esp_timer_get_time(), dividerQ8);
+#if PLANTEY_AUDIO_SYNTH
+  synth_.releaseAll();
+  synth_.noteOn(0, dividerQ8);
+  currentDividerQ8_ = dividerQ8;
+#else
+  if (dividerQ8 == 0) {
+    ledc_set_duty(kBuzzerMode, kBuzzerChannel, 0);
+    ledc_update_duty(kBuzzerMode, kBuzzerChannel);
+    currentDividerQ8_ = 0;
     return;
   }
-  ledcWriteTone(hw::BUZZER_LEDC_CHANNEL, frequencyHz);
-  ledcWrite(hw::BUZZER_LEDC_CHANNEL, (1 << hw::BUZZER_LEDC_RESOLUTION) / 2);
-  currentFrequency_ = frequencyHz;
+  if (dividerQ8 != currentDividerQ8_) {
+    ledc_timer_set(kBuzzerMode, kBuzzerTimer, dividerQ8, hw::BUZZER_LEDC_RESOLUTION, LEDC_APB_CLK);
+  }
+  ledc_set_duty(kBuzzerMode, kBuzzerChannel, kHalfDuty);
+  ledc_update_duty(kBuzzerMode, kBuzzerChannel);
+  currentDividerQ8_ = dividerQ8;
+#endif
+}
+
+// The synth sounds every chord note at once; the LEDC output cycles through them.
+void AudioEngine::applyChord() {
+#if PLANTEY_AUDIO_SYNTH
+  trace_.record(esp_timer_get_time(), chordDividers_[0]);
+  for (size_t i = 0; i < chordNoteCount_; ++i) {
+    synth_.noteOn(static_cast<uint8_t>(i), chordDividers_[i]);
+  }
+  // Voices a larger previous chord used would otherwise keep sounding.
+  for (size_t i = chordNoteCount_; i < WavetableSynth::kVoices; ++i) {
+    synth_.noteOff(static_cast<uint8_t>(i));
+  }
+  currentDividerQ8_ = chordDividers_[0];
+#else
+  applyDivider(chordDividers_[currentChordIndex_]);
+#endif
 }
 
-void AudioEngine::startPlayback() {
-  playbackStartMs_ = millis();
+void AudioEngine::startPlayback(int64_t atUs) {
+  playbackStartUs_ = atUs;
   playing_ = true;
 }
 
 void AudioEngine::finishPlayback() {
-  ledcWrite(hw::BUZZER_LEDC_CHANNEL, 0);
+  applyDivider(0);
   playing_ = false;
   chordMode_ = false;
   chordNoteCount_ = 0;
   currentChordIndex_ = 0;
-  currentFrequency_ = 0.0f;
-  playbackDurationMs_ = 0;
+  playbackDurationUs_ = 0;
+}
+
+void AudioEngine::stopLocked() {
+  finishPlayback();
+  stopMelody();
+  ambientMode_ = false;
 }
 
 void AudioEngine::stopMelody() {
@@ -173,11 +595,11 @@ void AudioEngine::stopMelody() {
   activeMelodyIndex_ = 0;
   melodyLoop_ = false;
   melodyInPause_ = false;
-  melodyCurrentPauseMs_ = 0;
+  melodyCurrentPauseUs_ = 0;
   ambientMode_ = false;
 }
 
-void AudioEngine::startMelodyStep(size_t index) {
+void AudioEngine::startMelodyStep(size_t index, int64_t atUs) {
   if (melody_ == nullptr || index >= melodyCount_) {
     stopMelody();
     return;
@@ -185,44 +607,44 @@ void AudioEngine::startMelodyStep(size_t index) {
   const MelodyStep& step = melody_[index];
   activeMelodyIndex_ = index;
   melodyIndex_ = index + 1;
-  melodyCurrentPauseMs_ = step.pauseMs;
-  if (step.frequencyHz <= 0.0f || step.durationMs == 0) {
+  melodyCurrentPauseUs_ = static_cast<uint32_t>(step.pauseMs) * 1000UL;
+  if (step.dividerQ8 == 0 || step.durationMs == 0) {
     melodyInPause_ = true;
-    melodyPauseStartMs_ = millis();
+    melodyPauseStartUs_ = atUs;
     return;
   }
-  startTonePlayback(step.frequencyHz, step.durationMs);
+  startTonePlayback(step.dividerQ8, step.durationMs, atUs);
 }
 
-void AudioEngine::handleMelody(uint32_t now) {
+void AudioEngine::handleMelody(int64_t nowUs) {
   if (!melodyActive_ || melody_ == nullptr) {
     return;
   }
 
-  if (melodyInPause_) {
-    if (melodyCurrentPauseMs_ == 0 || (now - melodyPauseStartMs_) >= melodyCurrentPauseMs_) {
+  // Rests and zero-length pauses chain without waiting for another timer tick;
+  // the bound stops a melody made only of zero-length rests from spinning.
+  int64_t stepStart = nowUs;
+  for (size_t guard = 0; melodyActive_ && !playing_ && guard <= melodyCount_; ++guard) {
+    if (melodyInPause_) {
+      int64_t pauseEnd = melodyPauseStartUs_ + melodyCurrentPauseUs_;
+      if (melodyCurrentPauseUs_ != 0 && nowUs < pauseEnd) {
+        return;
+      }
       melodyInPause_ = false;
-    } else {
-      return;
+      stepStart = onSchedule(pauseEnd, nowUs);
     }
-  }
 
-  if (playing_) {
-    return;
-  }
-
-  if (melodyIndex_ >= melodyCount_) {
-    if (melodyLoop_) {
+    if (melodyIndex_ >= melodyCount_) {
+      if (!melodyLoop_) {
+        stopMelody();
+        return;
+      }
       melodyIndex_ = 0;
       activeMelodyIndex_ = 0;
-    } else {
-      stopMelody();
-      return;
     }
-  }
 
-  startMelodyStep(melodyIndex_);
+    startMelodyStep(melodyIndex_, stepStart);
+  }
 }
 
 }  // namespace audio
-
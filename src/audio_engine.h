@@ -2,66 +2,229 @@
 
 #include <Arduino.h>
 #include <array>
+#include <esp_timer.h>
 #include <initializer_list>
 
+#include "audio_trace.h"
 #include "hardware_config.h"
 
+// 0: square wave from the LEDC timer (chords are arpeggiated).
+// 1: sigma-delta wavetable synth (chords are mixed polyphonically).
+#ifndef PLANTEY_AUDIO_SYNTH
+#define PLANTEY_AUDIO_SYNTH 0
+#endif
+
+#if PLANTEY_AUDIO_SYNTH
+#include "wavetable_synth.h"
+#endif
+
 namespace audio {
 
+// LEDC timer divider (Q10.8, as written to the timer register) that makes the
+// buzzer channel run at frequencyHz. 0 means silence.
+constexpr uint32_t ledcDividerQ8(float frequencyHz) {
+  if (frequencyHz <= 0.0f) {
+    return 0;
+  }
+  float divider = (static_cast<float>(hw::BUZZER_LEDC_CLOCK_HZ) * 256.0f) /
+                  (static_cast<float>(1UL << hw::BUZZER_LEDC_RESOLUTION) * frequencyHz);
+  if (divider < 256.0f) {
+    return 256;
+  }
+  if (divider > 262143.0f) {
+    return 262143;  // 18-bit register: ~76 Hz is the lowest pitch at 10-bit resolution
+  }
+  return static_cast<uint32_t>(divider + 0.5f);
+}
+
 struct MelodyStep {
+  constexpr MelodyStep() : MelodyStep(0.0f, 0, 0) {}
+  constexpr MelodyStep(float frequency, uint16_t duration, uint16_t pause)
+      : frequencyHz(frequency), durationMs(duration), pauseMs(pause), dividerQ8(ledcDividerQ8(frequency)) {}
+
   float frequencyHz;
   uint16_t durationMs;
   uint16_t pauseMs;
+  uint32_t dividerQ8;
+};
+
+// How late sequencer steps ran relative to their scheduled time.
+struct SequencerStats {
+  bool hardwareTimer = false;  // false when stepping fell back to update()
+  uint32_t events = 0;
+  uint32_t maxLatenessUs = 0;
+  uint32_t meanLatenessUs = 0;
+};
+
+// Higher priorities preempt lower ones; equal priorities wait their turn.
+enum class SoundPriority : uint8_t { Ambient = 0, Feedback = 1, Cue = 2, Alert = 3 };
+
+// A sound waiting in the AudioEngine queue. Requests sharing a non-zero
+// coalesceKey merge instead of stacking up; ttlMs bounds how long one may wait.
+struct SoundRequest {
+  enum class Kind : uint8_t { Tone, Chord, Melody };
+  static constexpr size_t kMaxNotes = 4;
+
+  // Pitches are LEDC dividers (see ledcDividerQ8 and the note:: constants in
+  // melody_dsl.h), so building a request never touches floating point.
+  static SoundRequest tone(uint32_t dividerQ8, uint16_t durationMs, SoundPriority priority, uint8_t coalesceKey = 0);
+  static SoundRequest tone(float, uint16_t, SoundPriority, uint8_t = 0) = delete;
+  static SoundRequest chord(std::initializer_list<uint32_t> dividersQ8,
+                            uint16_t durationMs,
+                            uint16_t cycleMs,
+                            SoundPriority priority,
+                            uint8_t coalesceKey = 0);
+  static SoundRequest melody(const MelodyStep* steps, size_t count, SoundPriority priority, uint8_t coalesceKey = 0);
+
+  Kind kind = Kind::Tone;
+  SoundPriority priority = SoundPriority::Cue;
+  uint8_t coalesceKey = 0;
+  uint16_t ttlMs = 0;
+  uint16_t durationMs = 0;
+  uint16_t cycleMs = 12;
+  uint8_t noteCount = 0;
+  std::array<uint32_t, kMaxNotes> dividers{};
+  const MelodyStep* steps = nullptr;
+  size_t stepCount = 0;
+};
+
+struct SoundQueueStats {
+  uint32_t submitted = 0;
+  uint32_t merged = 0;     // folded into a queued or playing request with the same key
+  uint32_t expired = 0;    // waited longer than their TTL
+  uint32_t dropped = 0;    // queue full of equal or higher priority requests
+  uint32_t evicted = 0;    // queued sounds pushed out by a higher priority newcomer
+  uint32_t preempted = 0;  // sounds cut short by a higher priority request
 };
 
+// Reference sounds that can be played with transition tracing on.
+enum class TraceTarget : uint8_t { Boot, Ambient, Chord };
+
+// Tone, chord and melody stepping runs from a one-shot esp_timer armed for the
+// next note or chord boundary, so timing does not depend on loop() latency.
+// State shared with the timer task is guarded by lock_.
 class AudioEngine {
  public:
   void begin();
+  // Runs the request queue and the ambient loop; also steps the sequencer
+  // when its timer could not be created.
   void update();
 
-  void playTone(float frequencyHz, uint16_t durationMs);
-  void playChord(std::initializer_list<float> frequenciesHz, uint16_t durationMs, uint16_t cycleMs = 12);
+  // Queues a request and starts it right away if it outranks what is playing.
+  // Returns false when it was merged, dropped or already expired.
+  bool submit(const SoundRequest& request);
+  // Ambient resumes by itself a few seconds after foreground sounds finish.
+  void setAmbientEnabled(bool enabled);
+  const SoundQueueStats& queueStats() const { return queueStats_; }
+
+  // Immediate playback that bypasses the queue.
+  void playTone(uint32_t dividerQ8, uint16_t durationMs);
+  void playTone(float, uint16_t) = delete;
+  void playChord(std::initializer_list<uint32_t> dividersQ8, uint16_t durationMs, uint16_t cycleMs = 12);
   void playMelody(const MelodyStep* steps, size_t count, bool loop = false, bool ambient = false);
   void playBootSequence();
   void playAmbientLoop();
   void stopAmbient();
   void stop();
 
-  bool isPlaying() const { return playing_; }
+  // True for the whole of a melody, including the pauses between notes.
+  bool isPlaying() const { return playing_ || melodyActive_; }
   bool isAmbientActive() const { return ambientMode_; }
 
+  SequencerStats timingStats() const;
+  void resetTimingStats();
+
+  // Plays target while recording every output transition; the capture stops
+  // after one pass. Compare and dump once traceActive() turns false.
+  void startTrace(TraceTarget target);
+  bool traceActive() const { return trace_.active(); }
+  TraceReport traceReport() const;
+  void dumpTrace(Print& out) const { trace_.dump(out); }
+
+#if PLANTEY_AUDIO_SYNTH
+  SynthLoadStats synthLoad() const { return synth_.loadStats(); }
+#endif
+
  private:
-  void startTonePlayback(float frequencyHz, uint16_t durationMs);
-  void applyFrequency(float frequencyHz);
-  void startPlayback();
+  static void onTimer(void* arg);
+  void fireDue(int64_t nowUs);
+  void service(int64_t nowUs);
+  void arm(int64_t nowUs);
+
+  struct QueuedSound {
+    SoundRequest request;
+    uint32_t enqueuedMs = 0;
+    bool used = false;
+  };
+
+  void serviceQueue(uint32_t nowMs);
+  int8_t nextQueued() const;
+  bool outranksCurrent(const SoundRequest& request) const;
+  void startRequest(const SoundRequest& request);
+  void startTone(uint32_t dividerQ8, uint16_t durationMs);
+  void startChord(const uint32_t* dividers, size_t count, uint16_t durationMs, uint16_t cycleMs);
+  void startMelody(const MelodyStep* steps, size_t count, bool loop, bool ambient);
+
+  size_t traceReference(TraceTarget target, TraceEvent* out, size_t capacity) const;
+
+  void startTonePlayback(uint32_t dividerQ8, uint16_t durationMs, int64_t atUs);
+  void applyDivider(uint32_t dividerQ8);
+  void applyChord();
+  bool arpeggiated() const { return chordMode_ && chordNoteCount_ > 1 && !kPolyphonic; }
+  void startPlayback(int64_t atUs);
   void finishPlayback();
+  void stopLocked();
   void stopMelody();
-  void startMelodyStep(size_t index);
-  void handleMelody(uint32_t now);
+  void startMelodyStep(size_t index, int64_t atUs);
+  void handleMelody(int64_t nowUs);
 
   static constexpr size_t kMaxChordNotes = 4;
-  std::array<float, kMaxChordNotes> chordFrequencies_{};
+  static constexpr bool kPolyphonic = PLANTEY_AUDIO_SYNTH != 0;
+  std::array<uint32_t, kMaxChordNotes> chordDividers_{};
   size_t chordNoteCount_ = 0;
   size_t currentChordIndex_ = 0;
 
-  bool playing_ = false;
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  esp_timer_handle_t timer_ = nullptr;
+  int64_t deadlineUs_ = 0;  // next scheduled step; 0 when nothing is pending
+
+  volatile bool playing_ = false;
   bool chordMode_ = false;
-  uint32_t playbackStartMs_ = 0;
-  uint32_t playbackDurationMs_ = 0;
-  uint16_t chordCycleMs_ = 12;
-  uint32_t lastChordSwitchMs_ = 0;
-  float currentFrequency_ = 0.0f;
+  int64_t playbackStartUs_ = 0;
+  uint32_t playbackDurationUs_ = 0;
+  uint32_t chordCycleUs_ = 12000;
+  int64_t lastChordSwitchUs_ = 0;
+  uint32_t currentDividerQ8_ = 0;
+#if PLANTEY_AUDIO_SYNTH
+  WavetableSynth synth_;
+#endif
 
   const MelodyStep* melody_ = nullptr;
   size_t melodyCount_ = 0;
   size_t melodyIndex_ = 0;
   size_t activeMelodyIndex_ = 0;
   bool melodyLoop_ = false;
-  bool melodyActive_ = false;
+  volatile bool melodyActive_ = false;
   bool melodyInPause_ = false;
-  uint16_t melodyCurrentPauseMs_ = 0;
-  uint32_t melodyPauseStartMs_ = 0;
-  bool ambientMode_ = false;
+  uint32_t melodyCurrentPauseUs_ = 0;
+  int64_t melodyPauseStartUs_ = 0;
+  volatile bool ambientMode_ = false;
+
+  static constexpr uint8_t kQueueSize = 6;
+  QueuedSound queue_[kQueueSize];
+  SoundQueueStats queueStats_;
+  bool foreground_ = false;  // a non-ambient sound started and has not finished yet
+  SoundPriority activePriority_ = SoundPriority::Ambient;
+  uint8_t activeKey_ = 0;
+  bool ambientEnabled_ = false;
+  uint32_t ambientResumeAtMs_ = 0;
+
+  SequenceTrace trace_;
+  TraceTarget traceTarget_ = TraceTarget::Boot;
+
+  uint32_t lateEvents_ = 0;
+  uint32_t maxLatenessUs_ = 0;
+  uint64_t totalLatenessUs_ = 0;
 };
 
 }  // namespace audio
@@ -0,0 +1,84 @@
+#include "audio_trace.h"
+
+#include <algorithm>
+
+#include "hardware_config.h"
+
+namespace audio {
+namespace {
+
+uint32_t absDiff(uint32_t a, uint32_t b) {
+  return a > b ? a - b : b - a;
+}
+
+uint32_t dividerHz(uint32_t dividerQ8) {
+  if (dividerQ8 == 0) {
+    return 0;
+  }
+  uint64_t clockQ8 = static_cast<uint64_t>(hw::BUZZER_LEDC_CLOCK_HZ) * 256ULL;
+  return static_cast<uint32_t>(clockQ8 / ((1ULL << hw::BUZZER_LEDC_RESOLUTION) * dividerQ8));
+}
+
+}  // namespace
+
+void SequenceTrace::start(size_t limit) {
+  active_ = false;
+  count_ = 0;
+  limit_ = std::min(limit, kCapacity);
+  originUs_ = 0;
+  lastDividerQ8_ = 0;
+  active_ = limit_ > 0;
+}
+
+void SequenceTrace::record(int64_t nowUs, uint32_t dividerQ8) {
+  if (!active_ || dividerQ8 == lastDividerQ8_) {
+    return;
+  }
+  if (count_ == 0) {
+    originUs_ = nowUs;
+  }
+  events_[count_].atUs = static_cast<uint32_t>(nowUs - originUs_);
+  events_[count_].dividerQ8 = dividerQ8;
+  lastDividerQ8_ = dividerQ8;
+  if (++count_ >= limit_) {
+    active_ = false;
+  }
+}
+
+TraceReport SequenceTrace::compare(const TraceEvent* expected, size_t count) const {
+  TraceReport report;
+  report.expected = count;
+  report.captured = count_;
+  size_t pairs = std::min(count, count_);
+  uint64_t totalOnsetUs = 0;
+  for (size_t i = 0; i < pairs; ++i) {
+    if (events_[i].dividerQ8 != expected[i].dividerQ8) {
+      ++report.mismatched;
+    }
+    uint32_t onsetError = absDiff(events_[i].atUs, expected[i].atUs);
+    totalOnsetUs += onsetError;
+    report.maxOnsetErrorUs = std::max(report.maxOnsetErrorUs, onsetError);
+    if (i > 0) {
+      uint32_t actualSpan = events_[i].atUs - events_[i - 1].atUs;
+      uint32_t expectedSpan = expected[i].atUs - expected[i - 1].atUs;
+      report.maxDurationErrorUs = std::max(report.maxDurationErrorUs, absDiff(actualSpan, expectedSpan));
+    }
+  }
+  report.meanOnsetErrorUs = pairs > 0 ? static_cast<uint32_t>(totalOnsetUs / pairs) : 0;
+  return report;
+}
+
+void SequenceTrace::dump(Print& out) const {
+  for (size_t i = 0; i < count_; ++i) {
+    const TraceEvent& event = events_[i];
+    if (event.dividerQ8 == 0) {
+      out.printf("  %8lu us  off\n", static_cast<unsigned long>(event.atUs));
+    } else {
+      out.printf("  %8lu us  %4lu Hz (div %lu)\n", static_cast<unsigned long>(event.atUs),
+                 static_cast<unsigned long>(dividerHz(event.dividerQ8)),
+                 static_cast<unsigned long>(event.dividerQ8));
+    }
+  }
+}
+
+}  // namespace audio
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace audio {
+
+// One buzzer transition: the divider written at atUs (0 = silence).
+struct TraceEvent {
+  uint32_t atUs;
+  uint32_t dividerQ8;
+};
+
+// A trace passes when every transition was captured at the right pitch and
+// none started, or lasted, further than this from its nominal schedule.
+constexpr uint32_t kTraceOnsetToleranceUs = 2000;
+constexpr uint32_t kTraceDurationToleranceUs = 2000;
+
+// How far a captured sequence strayed from its nominal schedule.
+struct TraceReport {
+  size_t expected = 0;
+  size_t captured = 0;
+  size_t mismatched = 0;  // events that wrote a different pitch than the reference
+  uint32_t maxOnsetErrorUs = 0;
+  uint32_t meanOnsetErrorUs = 0;
+  uint32_t maxDurationErrorUs = 0;  // note/rest lengths, i.e. gaps between events
+
+  bool passed() const {
+    return captured == expected && mismatched == 0 && maxOnsetErrorUs <= kTraceOnsetToleranceUs &&
+           maxDurationErrorUs <= kTraceDurationToleranceUs;
+  }
+};
+
+// Fixed-size capture of buzzer transitions. Timestamps are relative to the
+// first recorded event, so they line up with a reference schedule starting at 0.
+class SequenceTrace {
+ public:
+  static constexpr size_t kCapacity = 128;
+
+  // Clears the buffer and records until `limit` events have been captured.
+  void start(size_t limit);
+  void cancel() { active_ = false; }
+  // Called with the engine lock held; repeats of the current divider are ignored.
+  void record(int64_t nowUs, uint32_t dividerQ8);
+
+  bool active() const { return active_; }
+  size_t size() const { return count_; }
+
+  TraceReport compare(const TraceEvent* expected, size_t count) const;
+  // One line per event: time, divider and the pitch it produces.
+  void dump(Print& out) const;
+
+ private:
+  TraceEvent events_[kCapacity] = {};
+  size_t count_ = 0;
+  size_t limit_ = 0;
+  int64_t originUs_ = 0;
+  uint32_t lastDividerQ8_ = 0;
+  volatile bool active_ = false;
+};
+
+}  // namespace audio
@@ -0,0 +1,193 @@
+#include "button_gestures.h"
+
+#include <algorithm>
+
+namespace input {
+
+namespace {
+constexpr uint8_t kBoth = static_cast<uint8_t>(ButtonId::Both);
+
+bool isDue(uint32_t deadlineUs, uint32_t atUs) {
+  return static_cast<int32_t>(atUs - deadlineUs) >= 0;
+}
+}  // namespace
+
+// Unlisted (state, input) pairs are ignored.
+const GestureRecognizer::Transition GestureRecognizer::kTransitions[] = {
+    {State::Idle, Input::Press, State::Pressed, Emit::None, Arm::Hold, false},
+    {State::Released, Input::Press, State::Pressed, Emit::None, Arm::Hold, false},
+    {State::Pressed, Input::Release, State::Released, Emit::None, Arm::MultiClick, true},
+    {State::Pressed, Input::Timeout, State::Holding, Emit::HoldStart, Arm::RepeatFirst, false},
+    {State::Released, Input::Timeout, State::Idle, Emit::Clicks, Arm::Clear, false},
+    {State::Holding, Input::Timeout, State::Holding, Emit::Repeat, Arm::RepeatNext, false},
+    {State::Holding, Input::Release, State::Idle, Emit::HoldEnd, Arm::Clear, false},
+};
+const uint8_t GestureRecognizer::kTransitionCount = sizeof(kTransitions) / sizeof(kTransitions[0]);
+
+GestureEvent GestureRecognizer::poll() {
+  uint32_t now = micros();
+  while (queueCount_ == 0) {
+    if (!hasPending_) {
+      pending_ = buttons_.poll();
+      hasPending_ = pending_.type != ButtonEventType::None;
+    }
+    // Deadlines that fell due before the next button event happened first.
+    // Without one, an edge up to a debounce window old may still be on its
+    // way, so only deadlines before that can be trusted to have passed.
+    if (expireNext(hasPending_ ? pending_.atUs : now - buttons_.debounceUs())) {
+      continue;
+    }
+    if (!hasPending_) {
+      break;
+    }
+    apply(pending_);
+    hasPending_ = false;
+  }
+
+  if (queueCount_ == 0) {
+    return {};
+  }
+  GestureEvent event = queue_[queueHead_];
+  queueHead_ = static_cast<uint8_t>((queueHead_ + 1) % kQueueSize);
+  --queueCount_;
+  return event;
+}
+
+void GestureRecognizer::apply(const ButtonEvent& event) {
+  uint8_t track = static_cast<uint8_t>(event.id);
+  if (track >= kTracks) {
+    return;
+  }
+  if (track == kBoth) {
+    // ButtonInput reports the chord as Click when it forms and Released when both are up.
+    if (event.type == ButtonEventType::Click) {
+      // The singles that formed the chord are not gestures of their own.
+      tracks_[0] = Track();
+      tracks_[1] = Track();
+      feed(kBoth, Input::Press, event.atUs);
+    } else if (event.type == ButtonEventType::Released) {
+      feed(kBoth, Input::Release, event.atUs);
+    }
+    return;
+  }
+  switch (event.type) {
+    case ButtonEventType::Pressed:
+      feed(track, Input::Press, event.atUs);
+      break;
+    case ButtonEventType::Click:
+    case ButtonEventType::Released:
+      feed(track, Input::Release, event.atUs);
+      break;
+    default:
+      break;  // holds are timed here, not by ButtonInput's LongPress
+  }
+}
+
+void GestureRecognizer::feed(uint8_t track, Input input, uint32_t atUs) {
+  Track& t = tracks_[track];
+  const Transition* row = nullptr;
+  for (uint8_t i = 0; i < kTransitionCount; ++i) {
+    if (kTransitions[i].from == t.state && kTransitions[i].input == input) {
+      row = &kTransitions[i];
+      break;
+    }
+  }
+  if (row == nullptr) {
+    return;
+  }
+
+  t.state = row->to;
+  switch (row->emit) {
+    case Emit::Clicks:
+      emitClicks(track, atUs);
+      break;
+    case Emit::HoldStart:
+      emitClicks(track, atUs);  // a click followed by a hold reports both
+      t.repeats = 0;
+      emit(track, Gesture::HoldStart, atUs);
+      break;
+    case Emit::Repeat:
+      ++t.repeats;
+      emit(track, Gesture::HoldRepeat, atUs);
+      break;
+    case Emit::HoldEnd:
+      emit(track, Gesture::HoldEnd, atUs);
+      break;
+    case Emit::None:
+      break;
+  }
+
+  switch (row->arm) {
+    case Arm::Clear:
+      t.armed = false;
+      break;
+    case Arm::Hold:
+      t.armed = true;
+      t.deadlineUs = atUs + static_cast<uint32_t>(track == kBoth ? timing_.bothHoldMs : timing_.holdMs) * 1000UL;
+      break;
+    case Arm::MultiClick:
+      t.armed = true;
+      t.deadlineUs = atUs + static_cast<uint32_t>(timing_.multiClickMs) * 1000UL;
+      break;
+    case Arm::RepeatFirst:
+      // The chord has no repeat.
+      t.armed = track != kBoth;
+      t.intervalUs = static_cast<uint32_t>(timing_.repeatStartMs) * 1000UL;
+      t.deadlineUs = atUs + t.intervalUs;
+      break;
+    case Arm::RepeatNext: {
+      uint32_t minUs = static_cast<uint32_t>(timing_.repeatMinMs) * 1000UL;
+      t.intervalUs = std::max(minUs, (t.intervalUs * timing_.repeatAccelQ8) >> 8);
+      t.deadlineUs += t.intervalUs;  // from the nominal time, so repeats do not drift
+      break;
+    }
+  }
+
+  // The chord never becomes a double click, and three clicks need no wait.
+  uint8_t maxClicks = track == kBoth ? 1 : 3;
+  if (row->countsClick && ++t.clicks >= maxClicks) {
+    emitClicks(track, atUs);
+    t.state = State::Idle;
+    t.armed = false;
+  }
+}
+
+// Fires the earliest deadline at or before limitUs, if any.
+bool GestureRecognizer::expireNext(uint32_t limitUs) {
+  int8_t next = -1;
+  for (uint8_t i = 0; i < kTracks; ++i) {
+    const Track& t = tracks_[i];
+    if (t.armed && isDue(t.deadlineUs, limitUs) &&
+        (next < 0 || static_cast<int32_t>(t.deadlineUs - tracks_[next].deadlineUs) < 0)) {
+      next = static_cast<int8_t>(i);
+    }
+  }
+  if (next < 0) {
+    return false;
+  }
+  feed(static_cast<uint8_t>(next), Input::Timeout, tracks_[next].deadlineUs);
+  return true;
+}
+
+void GestureRecognizer::emitClicks(uint8_t track, uint32_t atUs) {
+  uint8_t clicks = tracks_[track].clicks;
+  tracks_[track].clicks = 0;
+  if (clicks == 0) {
+    return;
+  }
+  emit(track, clicks == 1 ? Gesture::Click : clicks == 2 ? Gesture::DoubleClick : Gesture::TripleClick, atUs);
+}
+
+void GestureRecognizer::emit(uint8_t track, Gesture gesture, uint32_t atUs) {
+  if (queueCount_ >= kQueueSize) {
+    return;
+  }
+  GestureEvent& event = queue_[(queueHead_ + queueCount_) % kQueueSize];
+  event.gesture = gesture;
+  event.id = static_cast<ButtonId>(track);
+  event.repeat = tracks_[track].repeats;
+  event.atUs = atUs;
+  ++queueCount_;
+}
+
+}  // namespace input
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "buttons.h"
+#include "hardware_config.h"
+
+namespace input {
+
+// Hold* on ButtonId::Both is the long two-button hold.
+enum class Gesture : uint8_t {
+  None = 0,
+  Click,
+  DoubleClick,
+  TripleClick,
+  HoldStart,
+  HoldRepeat,  // while held; the interval shortens with every repeat
+  HoldEnd,
+};
+
+struct GestureEvent {
+  Gesture gesture = Gesture::None;
+  ButtonId id = ButtonId::Left;
+  uint16_t repeat = 0;  // HoldRepeat count, starting at 1
+  uint32_t atUs = 0;
+};
+
+struct GestureTiming {
+  uint16_t multiClickMs = hw::BUTTON_MULTI_CLICK_MS;  // gap that still joins clicks
+  uint16_t holdMs = hw::BUTTON_LONG_PRESS_MS;
+  uint16_t repeatStartMs = hw::BUTTON_REPEAT_START_MS;
+  uint16_t repeatMinMs = hw::BUTTON_REPEAT_MIN_MS;
+  uint8_t repeatAccelQ8 = 192;  // each repeat interval is this fraction of the previous one
+  uint16_t bothHoldMs = hw::BUTTON_BOTH_HOLD_MS;
+};
+
+// Turns ButtonInput's debounced events into gestures with a small transition
+// table per button (left, right and the two-button chord). Timing comes from
+// the event timestamps, so a slow loop() does not change what was recognized.
+// A single click is reported once the multi-click window has closed. Holds
+// and clicks are decided one debounce window late, once no earlier edge can
+// still arrive.
+class GestureRecognizer {
+ public:
+  explicit GestureRecognizer(ButtonInput& buttons) : buttons_(buttons) {}
+
+  void setTiming(const GestureTiming& timing) { timing_ = timing; }
+  const GestureTiming& timing() const { return timing_; }
+
+  // Call until it returns Gesture::None.
+  GestureEvent poll();
+
+ private:
+  enum class State : uint8_t { Idle, Pressed, Released, Holding };
+  enum class Input : uint8_t { Press, Release, Timeout };
+
+  enum class Emit : uint8_t { None, Clicks, HoldStart, Repeat, HoldEnd };
+  enum class Arm : uint8_t { Clear, Hold, MultiClick, RepeatFirst, RepeatNext };
+
+  struct Transition {
+    State from;
+    Input input;
+    State to;
+    Emit emit;
+    Arm arm;
+    bool countsClick;
+  };
+  static const Transition kTransitions[];
+  static const uint8_t kTransitionCount;
+
+  struct Track {
+    State state = State::Idle;
+    uint8_t clicks = 0;
+    uint16_t repeats = 0;
+    bool armed = false;
+    uint32_t deadlineUs = 0;
+    uint32_t intervalUs = 0;
+  };
+
+  void apply(const ButtonEvent& event);
+  void feed(uint8_t track, Input input, uint32_t atUs);
+  bool expireNext(uint32_t limitUs);
+  void emit(uint8_t track, Gesture gesture, uint32_t atUs);
+  void emitClicks(uint8_t track, uint32_t atUs);
+
+  static constexpr uint8_t kTracks = 3;  // indexed by ButtonId
+  static constexpr uint8_t kQueueSize = 8;
+
+  ButtonInput& buttons_;
+  GestureTiming timing_;
+  Track tracks_[kTracks];
+
+  ButtonEvent pending_;  // pulled from buttons_ but not applied until earlier deadlines ran
+  bool hasPending_ = false;
+
+  GestureEvent queue_[kQueueSize];
+  uint8_t queueHead_ = 0;
+  uint8_t queueCount_ = 0;
+};
+
+}  // namespace input
@@ -2,62 +2,78 @@
 
 namespace input {
 
+namespace {
+bool isDue(uint32_t deadlineUs, uint32_t atUs) {
+  return static_cast<int32_t>(atUs - deadlineUs) >= 0;
+}
+}  // namespace
+
 Button::Button(uint8_t pin, ButtonId id, bool activeLow, uint16_t debounceMs, uint16_t longPressMs)
     : pin_(pin),
       id_(id),
       activeLow_(activeLow),
-      debounceMs_(debounceMs),
-      longPressMs_(longPressMs) {}
+      debounceUs_(static_cast<uint32_t>(debounceMs) * 1000UL),
+      longPressUs_(static_cast<uint32_t>(longPressMs) * 1000UL) {}
 
-void Button::begin() {
+void Button::begin(uint32_t nowUs) {
   pinMode(pin_, activeLow_ ? INPUT_PULLUP : INPUT);
   stableState_ = activeLow_ ? (digitalRead(pin_) == LOW) : (digitalRead(pin_) == HIGH);
-  lastReading_ = stableState_;
-  lastDebounceMs_ = millis();
-  pressedAtMs_ = 0;
+  rawState_ = stableState_;
+  rawSinceUs_ = nowUs;
+  pressedAtUs_ = 0;
   longPressSent_ = false;
 }
 
-ButtonEvent Button::update(uint32_t nowMs) {
-  bool reading = digitalRead(pin_);
-  if (activeLow_) {
-    reading = !reading;
-  }
+void Button::onEdge(bool pinHigh, uint32_t atUs) {
+  onLevel(pinPressed(pinHigh), atUs);
+}
 
-  if (reading != lastReading_) {
-    lastDebounceMs_ = nowMs;
-    lastReading_ = reading;
+void Button::onLevel(bool pressed, uint32_t atUs) {
+  if (pressed != rawState_) {
+    rawState_ = pressed;
+    rawSinceUs_ = atUs;
   }
+}
 
-  if ((nowMs - lastDebounceMs_) < debounceMs_) {
-    return {};
+bool Button::nextDeadline(uint32_t* atUs) const {
+  if (rawState_ != stableState_) {
+    *atUs = rawSinceUs_ + debounceUs_;
+    return true;
+  }
+  if (stableState_ && !longPressSent_ && pressedAtUs_ != 0) {
+    *atUs = pressedAtUs_ + longPressUs_;
+    return true;
   }
+  return false;
+}
 
+ButtonEvent Button::advance(uint32_t atUs) {
   ButtonEvent event;
   event.id = id_;
 
-  if (reading != stableState_) {
-    stableState_ = reading;
+  if (rawState_ != stableState_ && isDue(rawSinceUs_ + debounceUs_, atUs)) {
+    // The level held for the whole debounce window: it changed at rawSinceUs_.
+    stableState_ = rawState_;
+    event.atUs = rawSinceUs_;
     if (stableState_) {
-      // Button pressed.
-      pressedAtMs_ = nowMs;
+      pressedAtUs_ = rawSinceUs_ != 0 ? rawSinceUs_ : 1;
       longPressSent_ = false;
       event.type = ButtonEventType::Pressed;
       return event;
     }
-    // Button released.
     event.type = ButtonEventType::Released;
-    if (!longPressSent_ && pressedAtMs_ != 0 && (nowMs - pressedAtMs_) >= debounceMs_) {
+    if (!longPressSent_ && pressedAtUs_ != 0 && (rawSinceUs_ - pressedAtUs_) >= debounceUs_) {
       event.type = ButtonEventType::Click;
     }
-    pressedAtMs_ = 0;
+    pressedAtUs_ = 0;
     longPressSent_ = false;
     return event;
   }
 
-  if (stableState_ && !longPressSent_ && pressedAtMs_ != 0 && (nowMs - pressedAtMs_) >= longPressMs_) {
+  if (stableState_ && !longPressSent_ && pressedAtUs_ != 0 && isDue(pressedAtUs_ + longPressUs_, atUs)) {
     longPressSent_ = true;
     event.type = ButtonEventType::LongPress;
+    event.atUs = pressedAtUs_ + longPressUs_;
     return event;
   }
 
@@ -65,21 +81,134 @@ ButtonEvent Button::update(uint32_t nowMs) {
 }
 
 ButtonInput::ButtonInput(uint8_t leftPin, uint8_t rightPin, bool activeLow, uint16_t debounceMs, uint16_t longPressMs)
-    : left_(leftPin, ButtonId::Left, activeLow, debounceMs, longPressMs),
-      right_(rightPin, ButtonId::Right, activeLow, debounceMs, longPressMs) {}
+    : buttons_{Button(leftPin, ButtonId::Left, activeLow, debounceMs, longPressMs),
+               Button(rightPin, ButtonId::Right, activeLow, debounceMs, longPressMs)},
+      sources_{{this, 0, leftPin}, {this, 1, rightPin}} {}
 
 void ButtonInput::begin() {
-  left_.begin();
-  right_.begin();
+  uint32_t now = micros();
+  for (uint8_t i = 0; i < 2; ++i) {
+    buttons_[i].begin(now);
+    lastQueuedHigh_[i] = digitalRead(buttons_[i].pin()) == HIGH;
+    attachInterruptArg(buttons_[i].pin(), &ButtonInput::onEdgeIsr, &sources_[i], CHANGE);
+  }
+}
+
+void IRAM_ATTR ButtonInput::onEdgeIsr(void* arg) {
+  auto* source = static_cast<EdgeSource*>(arg);
+  source->input->pushEdge(source->button, digitalRead(source->pin) == HIGH);
+}
+
+void IRAM_ATTR ButtonInput::pushEdge(uint8_t button, bool pinHigh) {
+  if (pinHigh == lastQueuedHigh_[button]) {
+    return;  // a bounce the pin had already settled back from
+  }
+  lastQueuedHigh_[button] = pinHigh;
+  uint32_t now = micros();
+  uint8_t head = edgeHead_.load(std::memory_order_relaxed);
+  // Once one edge is lost, the rest wait for poll() too, so nothing newer
+  // overtakes the replay.
+  if (edgesLost_[button].load(std::memory_order_relaxed) ||
+      static_cast<uint8_t>(head - edgeTail_.load(std::memory_order_acquire)) >= kEdgeCapacity) {
+    // Full: poll() replays this button's lost edges as a press/release.
+    if (!edgesLost_[button].load(std::memory_order_relaxed)) {
+      lostSinceUs_[button] = now;
+      edgesLost_[button].store(true, std::memory_order_release);
+    }
+    droppedEdges_ = droppedEdges_ + 1;
+    return;
+  }
+  Edge& edge = edges_[head % kEdgeCapacity];
+  edge.atUs = now;
+  edge.button = button;
+  edge.pinHigh = pinHigh;
+  edgeHead_.store(static_cast<uint8_t>(head + 1), std::memory_order_release);
 }
 
 ButtonEvent ButtonInput::poll() {
-  uint32_t now = millis();
-  ButtonEvent leftEvt = left_.update(now);
-  ButtonEvent rightEvt = right_.update(now);
+  drain(micros());
+  if (eventCount_ == 0) {
+    return {};
+  }
+  ButtonEvent event = events_[eventHead_];
+  eventHead_ = static_cast<uint8_t>((eventHead_ + 1) % kEventCapacity);
+  --eventCount_;
+  return event;
+}
 
-  bool leftDown = left_.isPressed();
-  bool rightDown = right_.isPressed();
+void ButtonInput::drain(uint32_t nowUs) {
+  uint8_t tail = edgeTail_.load(std::memory_order_relaxed);
+  uint8_t head = edgeHead_.load(std::memory_order_acquire);
+  while (tail != head) {
+    if (kEventCapacity - eventCount_ < kEventHeadroom) {
+      return;  // the rest wait in order for the next poll(), nothing is dropped
+    }
+    const Edge& edge = edges_[tail % kEdgeCapacity];
+    // Anything that fell due before this edge happened first.
+    settleUntil(edge.atUs);
+    buttons_[edge.button].onEdge(edge.pinHigh, edge.atUs);
+    ++tail;
+    edgeTail_.store(tail, std::memory_order_release);
+  }
+  for (uint8_t i = 0; i < 2; ++i) {
+    if (edgesLost_[i].load(std::memory_order_acquire)) {
+      replayLostEdges(i);
+    }
+  }
+  settleUntil(nowUs);
+}
+
+// The ring was full, so some of this button's edges are gone; they came
+// after everything queued. Whatever they were, the button went down, so a
+// press is replayed, held just long enough to count, then a release if the
+// pin reads up now. This keeps the press a stalled loop would have lost.
+void ButtonInput::replayLostEdges(uint8_t button) {
+  Button& target = buttons_[button];
+  uint32_t pressAtUs = lostSinceUs_[button];
+  uint32_t releaseAtUs = pressAtUs + 2 * target.debounceUs();
+  // Edges from here on are queued again; the pin is read after, so one
+  // landing in between is at worst seen twice, never missed.
+  edgesLost_[button].store(false, std::memory_order_release);
+  bool pressedNow = target.pinPressed(digitalRead(target.pin()) == HIGH);
+
+  settleUntil(pressAtUs);
+  if (!target.rawPressed()) {
+    target.onLevel(true, pressAtUs);
+  }
+  if (!pressedNow) {
+    settleUntil(releaseAtUs);
+    target.onLevel(false, releaseAtUs);
+  }
+}
+
+// Runs due debounce and long-press deadlines of both buttons in time order.
+void ButtonInput::settleUntil(uint32_t atUs) {
+  while (true) {
+    int8_t next = -1;
+    uint32_t nextUs = 0;
+    for (uint8_t i = 0; i < 2; ++i) {
+      uint32_t deadline = 0;
+      if (buttons_[i].nextDeadline(&deadline) && isDue(deadline, atUs) &&
+          (next < 0 || static_cast<int32_t>(deadline - nextUs) < 0)) {
+        next = static_cast<int8_t>(i);
+        nextUs = deadline;
+      }
+    }
+    if (next < 0) {
+      return;
+    }
+    ButtonEvent event = filterCombo(buttons_[next].advance(nextUs));
+    if (event.type != ButtonEventType::None) {
+      pushEvent(event);
+    }
+  }
+}
+
+// Pressing both buttons yields one Both click (and a Both release once both
+// are up); single-button events are swallowed until then.
+ButtonEvent ButtonInput::filterCombo(const ButtonEvent& event) {
+  bool leftDown = buttons_[0].isPressed();
+  bool rightDown = buttons_[1].isPressed();
 
   if (leftDown && rightDown) {
     if (!comboActive_) {
@@ -95,6 +224,11 @@ ButtonEvent ButtonInput::poll() {
     if (!leftDown && !rightDown) {
       pendingComboRelease_ = false;
       suppressSingles_ = false;
+      ButtonEvent released;
+      released.id = ButtonId::Both;
+      released.type = ButtonEventType::Released;
+      released.atUs = event.atUs;
+      return released;
     }
     return {};
   }
@@ -106,20 +240,23 @@ ButtonEvent ButtonInput::poll() {
     ButtonEvent combo;
     combo.id = ButtonId::Both;
     combo.type = ButtonEventType::Click;
+    combo.atUs = event.atUs;
     return combo;
   }
 
   if (comboActive_ || suppressSingles_) {
     return {};
   }
+  return event;
+}
 
-  if (leftEvt.type != ButtonEventType::None) {
-    return leftEvt;
+void ButtonInput::pushEvent(const ButtonEvent& event) {
+  if (eventCount_ >= kEventCapacity) {
+    ++droppedEvents_;
+    return;
   }
-  if (rightEvt.type != ButtonEventType::None) {
-    return rightEvt;
-  }
-  return {};
+  events_[(eventHead_ + eventCount_) % kEventCapacity] = event;
+  ++eventCount_;
 }
 
 }  // namespace input
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 
 namespace input {
 
@@ -17,38 +18,100 @@ enum class ButtonEventType : uint8_t {
 struct ButtonEvent {
   ButtonEventType type = ButtonEventType::None;
   ButtonId id = ButtonId::Left;
+  uint32_t atUs = 0;  // micros() of the edge that caused it, not of poll()
 };
 
+// Debounce, click and long-press detection over a stream of timestamped edges.
 class Button {
  public:
   Button(uint8_t pin, ButtonId id, bool activeLow, uint16_t debounceMs, uint16_t longPressMs);
-  void begin();
-  ButtonEvent update(uint32_t nowMs);
+  void begin(uint32_t nowUs);
+  // Takes the level the edge ISR sampled on the pin.
+  void onEdge(bool pinHigh, uint32_t atUs);
+  // The same, as pressed or released rather than a pin level.
+  void onLevel(bool pressed, uint32_t atUs);
+  bool pinPressed(bool pinHigh) const { return activeLow_ ? !pinHigh : pinHigh; }
+  // When a pending debounce or long press falls due; false if nothing is pending.
+  bool nextDeadline(uint32_t* atUs) const;
+  // Settles whatever is due at atUs.
+  ButtonEvent advance(uint32_t atUs);
+
   bool isPressed() const { return stableState_; }
+  bool rawPressed() const { return rawState_; }
+  uint8_t pin() const { return pin_; }
+  uint32_t debounceUs() const { return debounceUs_; }
 
  private:
   uint8_t pin_;
   ButtonId id_;
   bool activeLow_;
-  uint16_t debounceMs_;
-  uint16_t longPressMs_;
+  uint32_t debounceUs_;
+  uint32_t longPressUs_;
 
-  bool lastReading_ = false;
+  bool rawState_ = false;
+  uint32_t rawSinceUs_ = 0;
   bool stableState_ = false;
-  uint32_t lastDebounceMs_ = 0;
-  uint32_t pressedAtMs_ = 0;
+  uint32_t pressedAtUs_ = 0;
   bool longPressSent_ = false;
 };
 
+// Both buttons interrupt on every edge; the ISR only timestamps the edge into
+// a single-producer/single-consumer ring, skipping bounces that repeat the
+// level it queued last. poll() replays the edges in order, so events keep
+// their real timing even when loop() stalls, and every event is delivered
+// (call poll() until it returns None). If the ring overflows anyway, the lost
+// edges are replayed as one press and, if the button is up by then, a release.
 class ButtonInput {
  public:
   ButtonInput(uint8_t leftPin, uint8_t rightPin, bool activeLow, uint16_t debounceMs, uint16_t longPressMs);
   void begin();
   ButtonEvent poll();
 
+  // An edge is reported this long after it happened, stamped with its own time.
+  uint32_t debounceUs() const { return buttons_[0].debounceUs(); }
+  uint32_t droppedEdges() const { return droppedEdges_; }
+  uint32_t droppedEvents() const { return droppedEvents_; }
+
  private:
-  Button left_;
-  Button right_;
+  struct Edge {
+    uint32_t atUs;
+    uint8_t button;
+    bool pinHigh;
+  };
+  struct EdgeSource {
+    ButtonInput* input;
+    uint8_t button;
+    uint8_t pin;
+  };
+
+  static void onEdgeIsr(void* arg);
+  void pushEdge(uint8_t button, bool pinHigh);
+  void drain(uint32_t nowUs);
+  void replayLostEdges(uint8_t button);
+  void settleUntil(uint32_t atUs);
+  ButtonEvent filterCombo(const ButtonEvent& event);
+  void pushEvent(const ButtonEvent& event);
+
+  static constexpr uint8_t kEdgeCapacity = 64;  // power of two; indices wrap at 256
+  static constexpr uint8_t kEventCapacity = 16;
+  static constexpr uint8_t kEventHeadroom = 4;  // most events one edge can settle
+
+  Button buttons_[2];
+  EdgeSource sources_[2];
+
+  Edge edges_[kEdgeCapacity] = {};
+  std::atomic<uint8_t> edgeHead_{0};  // written by the ISR only
+  std::atomic<uint8_t> edgeTail_{0};  // written by poll() only
+  volatile bool lastQueuedHigh_[2] = {};  // last level the ISR saw; ISR only after begin()
+  std::atomic<bool> edgesLost_[2] = {};
+  volatile uint32_t lostSinceUs_[2] = {};  // first lost edge, valid while edgesLost_
+  volatile uint32_t droppedEdges_ = 0;
+
+  ButtonEvent events_[kEventCapacity];
+  uint8_t eventHead_ = 0;
+  uint8_t eventCount_ = 0;
+  uint32_t droppedEvents_ = 0;
+
   bool comboActive_ = false;
   bool comboLatched_ = false;
   bool suppressSingles_ = false;
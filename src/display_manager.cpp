@@ -5,12 +5,30 @@
 #include <cstdio>
 #include <cstring>
 
+#include "input_digest.h"
+#include "logging.h"
+
 namespace display {
 namespace {
 
 constexpr const char* kPageTitles[] = {"Face", "Info", "Debug"};
 constexpr size_t kPageTitleCount = sizeof(kPageTitles) / sizeof(const char*);
-constexpr float kTwoPi = 6.28318530718f;
+constexpr int32_t kBlinkOpenQ8 = 20;   // ~0.08, eyelids nearly shut
+// Eyelid travel is snapped to quarters so a blink touches only a few sprites.
+constexpr int32_t kEyelidStepQ8 = 64;
+constexpr int32_t kEyeClosedQ8 = 30;   // at or below this the eye is drawn as a line
+constexpr uint16_t kFaceStatsWindow = 128;
+constexpr const char* kLogTagDisplay = "display";
+// Rows reserved above an eye or mouth tile for the frown strokes.
+constexpr int16_t kSpritePadTop = 2;
+constexpr int16_t kTextLeft = 4;
+constexpr uint16_t kTextWidth = 120;
+// Menu labels start here and stop short of the scroll markers.
+constexpr int16_t kMenuLabelLeft = 6;
+constexpr uint16_t kMenuLabelWidth = 114;
+// Info page dots run down the right edge between these rows.
+constexpr int16_t kPageDotTop = 31;
+constexpr int16_t kPageDotSpan = 21;
 
 int clampInt(int value, int minValue, int maxValue) {
   if (value < minValue) return minValue;
@@ -21,16 +39,19 @@ int clampInt(int value, int minValue, int maxValue) {
 }  // namespace
 
 constexpr uint8_t MenuListView::kMaxVisible;
+constexpr uint8_t MenuListView::kLabelLength;
 
 void DisplayManager::begin() {
   if (started_) {
     return;
   }
   display_.begin();
+  smallGlyphs_.build(display_, u8g2_font_5x8_tf);
+  mediumGlyphs_.build(display_, u8g2_font_6x12_tf);
   started_ = true;
 }
 
-void DisplayManager::render(const FaceExpressionView& face,
+bool DisplayManager::render(const FaceExpressionView& face,
                             const sensing::EnvironmentReadings& environment,
                             const SystemStatusView& status,
                             const MenuListView* menu,
@@ -38,36 +59,192 @@ void DisplayManager::render(const FaceExpressionView& face,
                             PageId page,
                             uint8_t pageIndex,
                             uint8_t pageCount,
-                            bool blinkFrame) {
+                            const FacePose& pose) {
   if (!started_) {
     begin();
   }
 
-  display_.clearBuffer();
+  if (page == PageId::Info) {
+    prepareInfoView(status, clock_());
+  } else if (page == PageId::Menu && menu != nullptr) {
+    prepareMenuView(*menu, clock_());
+  }
+
+  if (page == PageId::Mood) {
+    lastPageDigestValid_ = false;
+  } else {
+    uint32_t digest = pageInputs(environment, status, menu, page, pageIndex, pageCount);
+    if (lastPageDigestValid_ && digest == lastPageDigest_) {
+      ++renderStats_.framesSkipped;
+      return false;
+    }
+    lastPageDigest_ = digest;
+    lastPageDigestValid_ = true;
+  }
+
+  const uint8_t* background = chromeFor(page, pageIndex, pageCount, menu);
   switch (page) {
     case PageId::Menu:
+      restoreChrome(background);
       if (menu != nullptr) {
         drawMenuLayer(*menu);
       }
       break;
-    case PageId::Mood:
-      drawFaceLayer(face, blinkFrame, timeText);
+    case PageId::Mood: {
+      // The face restores the background itself, after its sprite lookups.
+      uint32_t startCycles = ESP.getCycleCount();
+      drawFaceLayer(face, pose, timeText, background);
+      recordFaceCycles(ESP.getCycleCount() - startCycles);
       break;
+    }
     case PageId::Info:
+      restoreChrome(background);
       drawInfoLayer(environment, status);
       break;
     case PageId::Debug:
+      restoreChrome(background);
       drawDebugLayer(environment, status);
       break;
   }
-  drawFooter(page, pageIndex, pageCount, page == PageId::Menu);
   display_.sendBuffer();
+  ++renderStats_.framesRendered;
+  return true;
+}
+
+void DisplayManager::drawSleepFrame() {
+  if (!started_) {
+    begin();
+  }
+  lastPageDigestValid_ = false;
+  display_.clearBuffer();
+  display_.drawHLine(64 - 36 - 10, 34, 20);
+  display_.drawHLine(64 + 36 - 10, 34, 20);
+  display_.drawHLine(58, 50, 12);
+  uint8_t step = static_cast<uint8_t>((clock_() / hw::DISPLAY_SLEEP_FRAME_INTERVAL_MS) % 4);
+  display_.setFont(u8g2_font_5x8_tf);
+  display_.drawStr(96 + step * 3, 24 - step * 4, "z");
+  display_.sendBuffer();
+}
+
+void DisplayManager::applyPowerState(PowerState state) {
+  if (!started_) {
+    begin();
+  }
+  lastPageDigestValid_ = false;
+  display_.setPowerSave(state == PowerState::Off ? 1 : 0);
+  display_.setContrast(state == PowerState::Active ? hw::DISPLAY_CONTRAST_ACTIVE : hw::DISPLAY_CONTRAST_DIM);
+}
+
+const uint8_t* DisplayManager::chromeFor(PageId page, uint8_t pageIndex, uint8_t pageCount,
+                                        const MenuListView* menu) {
+  const char* menuTitle = (page == PageId::Menu && menu != nullptr) ? menu->title : nullptr;
+  InputDigest digest;
+  digest.add(static_cast<uint32_t>(page) | (static_cast<uint32_t>(pageIndex) << 8) |
+             (static_cast<uint32_t>(pageCount) << 16));
+  digest.add(menuTitle != nullptr ? menuTitle : "");
+  if (const uint8_t* cached = chrome_.find(digest.value())) {
+    return cached;
+  }
+  uint8_t* background = chrome_.allocate(digest.value());
+  display_.clearBuffer();
+  drawChrome(page, pageIndex, pageCount, menuTitle);
+  std::memcpy(background, display_.getBufferPtr(), ChromePool::kBytes);
+  ++renderStats_.chromeBuilds;
+  return background;
+}
+
+void DisplayManager::drawChrome(PageId page, uint8_t pageIndex, uint8_t pageCount, const char* menuTitle) {
+  switch (page) {
+    case PageId::Menu:
+      display_.setFont(u8g2_font_6x12_tf);
+      if (menuTitle != nullptr) {
+        int16_t width = mediumGlyphs_.width(menuTitle);
+        display_.drawStr((128 - width) / 2, 12, menuTitle);
+      }
+      display_.drawLine(0, 16, 128, 16);
+      break;
+    case PageId::Info:
+      display_.setFont(u8g2_font_6x12_tf);
+      display_.drawStr(kTextLeft, 12, "Plant insights");
+      display_.drawLine(0, 16, 128, 16);
+      break;
+    case PageId::Debug:
+      display_.setFont(u8g2_font_5x8_tf);
+      display_.drawStr(4, 12, "Debug raw values");
+      display_.drawLine(0, 16, 128, 16);
+      break;
+    case PageId::Mood:
+      break;
+  }
+  drawFooter(page, pageIndex, pageCount, page == PageId::Menu);
+}
+
+void DisplayManager::restoreChrome(const uint8_t* background) {
+  std::memcpy(display_.getBufferPtr(), background, ChromePool::kBytes);
+}
+
+uint32_t DisplayManager::pageInputs(const sensing::EnvironmentReadings& environment,
+                                    const SystemStatusView& status,
+                                    const MenuListView* menu,
+                                    PageId page,
+                                    uint8_t pageIndex,
+                                    uint8_t pageCount) const {
+  InputDigest digest;
+  digest.add(static_cast<uint32_t>(page) | (static_cast<uint32_t>(pageIndex) << 8) |
+             (static_cast<uint32_t>(pageCount) << 16));
+
+  switch (page) {
+    case PageId::Info:
+      digest.add(static_cast<uint32_t>(infoView_.page) | (static_cast<uint32_t>(infoView_.marquee) << 8));
+      digest.add(static_cast<uint32_t>(status.fetchInProgress) | (environment.soilValid << 1) |
+                 (environment.lightValid << 2) | (environment.climateValid << 3));
+      digest.add(status.profileStatus);
+      digest.add(status.wifiStatus);
+      digest.add(environment.soilMoisturePct, 1.0f);
+      digest.add(environment.lightPct, 1.0f);
+      digest.add(environment.temperatureC, 10.0f);
+      digest.add(environment.humidityPct, 1.0f);
+      if (status.profile != nullptr && status.profile->valid) {
+        const plant::PlantProfile& profile = *status.profile;
+        digest.add(profile.speciesCommonName);
+        digest.add(profile.summary);
+        digest.add(profile.soilTargetMinPct, 1.0f);
+        digest.add(profile.soilTargetMaxPct, 1.0f);
+        digest.add(profile.lightTargetMinPct, 1.0f);
+        digest.add(profile.lightTargetMaxPct, 1.0f);
+        for (const String& tip : profile.tips) {
+          digest.add(tip);
+        }
+      }
+      break;
+    case PageId::Debug:
+      digest.add(static_cast<uint32_t>(environment.soilRaw) | (static_cast<uint32_t>(environment.lightRaw) << 16));
+      digest.add(static_cast<uint32_t>(environment.climateValid));
+      digest.add(status.wifiStatus);
+      break;
+    case PageId::Menu:
+      if (menu != nullptr) {
+        digest.add(menu->title);
+        digest.add(static_cast<uint32_t>(menu->entryCount) | (static_cast<uint32_t>(menu->selectedIndex) << 8) |
+                   (static_cast<uint32_t>(menu->topIndex) << 16) | (static_cast<uint32_t>(menu->totalCount) << 24));
+        digest.add(static_cast<uint32_t>(menuMarquee_));
+        for (uint8_t i = 0; i < menu->entryCount && i < MenuListView::kMaxVisible; ++i) {
+          digest.add(menu->items[i]);
+        }
+      }
+      break;
+    case PageId::Mood:
+    default:
+      break;
+  }
+  return digest.value();
 }
 
 void DisplayManager::drawSplash(const char* line1, const char* line2) {
   if (!started_) {
     begin();
   }
+  lastPageDigestValid_ = false;
   display_.clearBuffer();
   display_.setFont(u8g2_font_fub14_tf);
   const char* logo = (line1 != nullptr && line1[0] != '\0') ? line1 : "Plantey";
@@ -89,91 +266,94 @@ void DisplayManager::drawSplash(const char* line1, const char* line2) {
   display_.sendBuffer();
 }
 
-void DisplayManager::drawFaceLayer(const FaceExpressionView& face, bool blinkFrame, const char* timeText) {
+void DisplayManager::drawFaceLayer(const FaceExpressionView& face,
+                                   const FacePose& pose,
+                                   const char* timeText,
+                                   const uint8_t* background) {
   (void)timeText;  // default face screen stays wordless
 
-  auto clampFloat = [](float value, float minValue, float maxValue) {
-    if (value < minValue) return minValue;
-    if (value > maxValue) return maxValue;
-    return value;
+  // All animation maths is Q8 fixed point (256 == 1.0); the C3 has no FPU.
+  uint32_t now = clock_();
+  uint32_t elapsed = now - lastFaceFrameMs_;
+  lastFaceFrameMs_ = now;
+  breathPhase_.advance(elapsed);
+  swayPhase_.advance(elapsed);
+  int32_t breath = motion::sinQ8(breathPhase_.phase);
+  int32_t sway = motion::sinQ8(swayPhase_.phase);
+
+  int32_t interaction = clampInt(pose.interaction, 0, motion::kUnitQ8);
+
+  int32_t baseOpen = clampInt((clampInt(face.eyeOpenness, -4, 4) + 4) * 32, 13, 320);
+  int32_t openFactor = 218 + (breath * 20) / motion::kUnitQ8 + (interaction * 64) / motion::kUnitQ8;
+  int32_t openValue = clampInt((baseOpen * openFactor) / motion::kUnitQ8, 13, 358);
+
+  int eyeSmile = clampInt(face.eyeSmile, -4, 4);
+  int16_t gazeOffsetX = clampInt(face.gazeX + pose.gazeX, -6, 6);
+  int16_t gazeOffsetY = clampInt(face.gazeY + pose.gazeY, -4, 4);
+
+  // Blinks and winks both come from the animator's eyelid channels.
+  auto eyelidOpen = [&](int32_t lid) {
+    lid = clampInt(lid, 0, motion::kUnitQ8);
+    lid = ((lid + kEyelidStepQ8 / 2) / kEyelidStepQ8) * kEyelidStepQ8;
+    return openValue - ((openValue - kBlinkOpenQ8) * lid) / motion::kUnitQ8;
   };
 
-  uint32_t now = millis();
-  float breath = std::sin((now % 5200UL) * kTwoPi / 5200.0f);
-  float sway = std::sin((now % 8700UL) * kTwoPi / 8700.0f);
-
-  float interaction = 0.0f;
-  if (face.interactionPulseMs != 0xFFFF) {
-    float t = clampFloat(static_cast<float>(face.interactionPulseMs) / 900.0f, 0.0f, 1.0f);
-    interaction = 1.0f - t;
-  }
-
-  float baseOpen = clampFloat((static_cast<float>(clampInt(face.eyeOpenness, -4, 4)) + 4.0f) / 8.0f, 0.05f, 1.25f);
-  float blinkScale = blinkFrame ? 0.08f : 1.0f;
-  float openValue = clampFloat(baseOpen * (0.85f + breath * 0.08f + interaction * 0.25f) * blinkScale, 0.05f, 1.4f);
-
-  float eyeSmileFactor = clampFloat(static_cast<float>(clampInt(face.eyeSmile, -4, 4)) / 4.0f, -1.0f, 1.0f);
-
-  bool interactionAnimation = (face.interactionPulseMs != 0xFFFF) && (face.interactionPulseMs < 320);
-  bool interactionHalf = interactionAnimation && ((face.interactionPulseMs / 80U) % 2U == 0U);
-
-  bool winkLeft = face.winkLeft || (interactionAnimation && interactionHalf);
-  bool winkRight = face.winkRight || (interactionAnimation && !interactionHalf);
-
-  int16_t centerX = 64 + clampInt(face.gazeX, -6, 6) / 2 + static_cast<int16_t>(sway * 1.5f);
-  int16_t centerY = 34 + static_cast<int16_t>(breath * 2.0f) - static_cast<int16_t>(interaction * 3.0f);
+  int16_t centerX = 64 + gazeOffsetX / 2 + (sway * 3) / (2 * motion::kUnitQ8);
+  int16_t centerY = 34 + motion::scaleQ8(breath, 2) - motion::scaleQ8(interaction, 3);
 
   int16_t eyeSpacing = 36;
-  int16_t eyeWidth = 28 + static_cast<int16_t>(interaction * 4.0f);
+  int16_t eyeWidth = 28 + motion::scaleQ8(interaction, 4);
   int16_t eyeBaseHeight = 12;
-  int16_t gazeOffsetX = clampInt(face.gazeX, -6, 6);
-  int16_t gazeOffsetY = clampInt(face.gazeY, -4, 4);
-
-  auto drawEye = [&](int16_t cx, float openness, bool winkFlag) {
-    float localOpen = winkFlag ? 0.08f : openness;
-    int16_t height = std::max<int16_t>(3, static_cast<int16_t>(std::round(6.0f + localOpen * eyeBaseHeight)));
-    int16_t top = centerY - 18 + gazeOffsetY;
-    int16_t left = cx - eyeWidth / 2;
-
-    if (localOpen <= 0.12f) {
-      int16_t y = top + height / 2;
-      display_.setDrawColor(1);
-      display_.drawLine(left + 2, y, left + eyeWidth - 2, y);
-      if (eyeSmileFactor > 0.25f) {
-        display_.drawLine(left + 2, y + 1, left + 8, y + 2);
-        display_.drawLine(left + eyeWidth - 2, y + 1, left + eyeWidth - 8, y + 2);
-      } else if (eyeSmileFactor < -0.25f) {
-        display_.drawLine(left + 3, y - 1, left + eyeWidth - 3, y - 3);
-      }
-      return;
-    }
-
-    display_.setDrawColor(1);
-    display_.drawRBox(left, top, eyeWidth, height, 4);
-
-    display_.setDrawColor(0);
-    int16_t pupilW = 8 + static_cast<int16_t>(interaction * 4.0f);
-    int16_t pupilH = std::max<int16_t>(3, height - 4);
-    int16_t pupilLeft = cx - pupilW / 2 + (gazeOffsetX * 2) / 3;
-    int16_t pupilTop = top + (height - pupilH) / 2 + gazeOffsetY / 2;
-    display_.drawRBox(pupilLeft, pupilTop, pupilW, pupilH, 3);
-
-    display_.setDrawColor(1);
-    display_.drawRFrame(left, top, eyeWidth, height, 4);
-
-    if (eyeSmileFactor > 0.25f) {
-      display_.drawLine(left + 2, top + height, left + 8, top + height + 1);
-      display_.drawLine(left + eyeWidth - 2, top + height, left + eyeWidth - 8, top + height + 1);
-    } else if (eyeSmileFactor < -0.25f) {
-      display_.drawLine(left + 2, top + 1, left + 10, top - 2);
-      display_.drawLine(left + eyeWidth - 2, top + 1, left + eyeWidth - 10, top - 2);
+  int8_t smileClass = eyeSmile > 1 ? 1 : (eyeSmile < -1 ? -1 : 0);
+
+  auto eyeSpec = [&](int32_t localOpen) {
+    EyeSprite eye;
+    eye.width = static_cast<uint8_t>(eyeWidth);
+    eye.height = static_cast<uint8_t>(std::max<int32_t>(
+        3, (6 * motion::kUnitQ8 + localOpen * eyeBaseHeight + motion::kUnitQ8 / 2) / motion::kUnitQ8));
+    eye.smile = smileClass;
+    eye.closed = localOpen <= kEyeClosedQ8;
+    if (!eye.closed) {
+      eye.pupilWidth = static_cast<uint8_t>(8 + motion::scaleQ8(interaction, 4));
+      eye.pupilDx = static_cast<int8_t>((gazeOffsetX * 2) / 3);
+      eye.pupilDy = static_cast<int8_t>(gazeOffsetY / 2);
     }
+    return eye;
   };
 
-  drawEye(centerX - eyeSpacing, openValue, winkLeft);
-  drawEye(centerX + eyeSpacing, openValue, winkRight);
-
-  if (face.blush || interaction > 0.4f) {
+  int32_t mouthCurve = clampInt(face.mouthCurve, -4, 4);
+  int32_t mouthOpen = clampInt(face.mouthOpen, 0, 4) * (motion::kUnitQ8 / 4);
+  mouthOpen = clampInt(mouthOpen + (interaction * 77) / motion::kUnitQ8, 0, 333);
+
+  MouthSprite mouth;
+  mouth.width = static_cast<uint8_t>(54 + motion::scaleQ8(interaction, 6));
+  mouth.height = static_cast<uint8_t>(
+      std::max<int32_t>(3, (5 * motion::kUnitQ8 + mouthOpen * 10 + motion::kUnitQ8 / 2) / motion::kUnitQ8));
+  mouth.curve = mouthCurve > 1 ? 1 : (mouthCurve < -1 ? -1 : 0);
+
+  EyeSprite leftEye = eyeSpec(eyelidOpen(pose.eyelidLeft));
+  EyeSprite rightEye = eyeSpec(eyelidOpen(pose.eyelidRight));
+
+  // Resolve every tile before compositing: a cache miss rasterizes into the
+  // frame buffer and wipes it again afterwards.
+  const uint8_t* leftTile = eyeTile(leftEye);
+  const uint8_t* rightTile = eyeTile(rightEye);
+  const uint8_t* mouthBits = mouthTile(mouth);
+  restoreChrome(background);
+
+  int16_t eyeTop = centerY - 18 + gazeOffsetY;
+  uint8_t* frame = display_.getBufferPtr();
+  blitXbm(frame, centerX - eyeSpacing - eyeWidth / 2, eyeTop - kSpritePadTop, EyePool::kWidth, EyePool::kHeight,
+          leftTile);
+  blitXbm(frame, centerX + eyeSpacing - eyeWidth / 2, eyeTop - kSpritePadTop, EyePool::kWidth, EyePool::kHeight,
+          rightTile);
+
+  int16_t mouthCenterY = centerY + 18 - mouthCurve;
+  int16_t mouthTop = mouthCenterY - mouth.height / 2;
+  int16_t mouthLeft = centerX - mouth.width / 2;
+  blitXbm(frame, mouthLeft, mouthTop - kSpritePadTop, MouthPool::kWidth, MouthPool::kHeight, mouthBits);
+
+  if (face.blush || interaction > 102) {
     int16_t blushY = centerY + 4;
     for (int dx = -12; dx <= 12; dx += 4) {
       display_.drawPixel(centerX - eyeSpacing + dx, blushY);
@@ -181,50 +361,125 @@ void DisplayManager::drawFaceLayer(const FaceExpressionView& face, bool blinkFra
     }
   }
 
-  float mouthCurve = clampFloat(static_cast<float>(clampInt(face.mouthCurve, -4, 4)) / 4.0f, -1.0f, 1.0f);
-  float mouthOpen = clampFloat(static_cast<float>(clampInt(face.mouthOpen, 0, 4)) / 4.0f, 0.0f, 1.0f);
-  mouthOpen = clampFloat(mouthOpen + interaction * 0.3f, 0.0f, 1.3f);
+  if (interaction > 153) {
+    int16_t sparkY = centerY - 26;
+    display_.drawPixel(centerX - eyeSpacing - 6, sparkY);
+    display_.drawPixel(centerX + eyeSpacing + 6, sparkY + 1);
+    display_.drawPixel(centerX - 2, sparkY + 4);
+  }
+}
+
+uint32_t DisplayManager::EyeSprite::key() const {
+  return static_cast<uint32_t>(closed) | (static_cast<uint32_t>(width) << 1) |
+         (static_cast<uint32_t>(height) << 7) | (static_cast<uint32_t>(pupilWidth) << 12) |
+         (static_cast<uint32_t>(pupilDx + 8) << 17) | (static_cast<uint32_t>(pupilDy + 4) << 21) |
+         (static_cast<uint32_t>(smile + 1) << 24);
+}
+
+uint32_t DisplayManager::MouthSprite::key() const {
+  return static_cast<uint32_t>(width) | (static_cast<uint32_t>(height) << 7) |
+         (static_cast<uint32_t>(curve + 1) << 12);
+}
+
+const uint8_t* DisplayManager::eyeTile(const EyeSprite& eye) {
+  uint32_t key = eye.key();
+  if (const uint8_t* cached = eyeSprites_.find(key)) {
+    return cached;
+  }
+  uint8_t* tile = eyeSprites_.allocate(key);
+  drawEyePrimitives(eye, 0, kSpritePadTop);
+  captureXbm(display_.getBufferPtr(), 0, 0, EyePool::kWidth, EyePool::kHeight, tile);
+  display_.clearBuffer();
+  return tile;
+}
+
+const uint8_t* DisplayManager::mouthTile(const MouthSprite& mouth) {
+  uint32_t key = mouth.key();
+  if (const uint8_t* cached = mouthSprites_.find(key)) {
+    return cached;
+  }
+  uint8_t* tile = mouthSprites_.allocate(key);
+  drawMouthPrimitives(mouth, 0, kSpritePadTop);
+  captureXbm(display_.getBufferPtr(), 0, 0, MouthPool::kWidth, MouthPool::kHeight, tile);
+  display_.clearBuffer();
+  return tile;
+}
+
+void DisplayManager::drawEyePrimitives(const EyeSprite& eye, int16_t left, int16_t top) {
+  int16_t width = eye.width;
+  int16_t height = eye.height;
+  display_.setDrawColor(1);
+  if (eye.closed) {
+    int16_t y = top + height / 2;
+    display_.drawLine(left + 2, y, left + width - 2, y);
+    if (eye.smile > 0) {
+      display_.drawLine(left + 2, y + 1, left + 8, y + 2);
+      display_.drawLine(left + width - 2, y + 1, left + width - 8, y + 2);
+    } else if (eye.smile < 0) {
+      display_.drawLine(left + 3, y - 1, left + width - 3, y - 3);
+    }
+    return;
+  }
+
+  display_.drawRBox(left, top, width, height, 4);
 
-  int16_t mouthWidth = 54 + static_cast<int16_t>(interaction * 6.0f);
-  int16_t mouthHeight = std::max<int16_t>(3, static_cast<int16_t>(std::round(5.0f + mouthOpen * 10.0f)));
-  int16_t mouthOffsetY = static_cast<int16_t>(-mouthCurve * 4.0f);
-  int16_t mouthCenterY = centerY + 18 + mouthOffsetY;
-  int16_t mouthTop = mouthCenterY - mouthHeight / 2;
-  int16_t mouthLeft = centerX - mouthWidth / 2;
+  display_.setDrawColor(0);
+  int16_t pupilW = eye.pupilWidth;
+  int16_t pupilH = std::max<int16_t>(3, height - 4);
+  int16_t pupilLeft = left + width / 2 - pupilW / 2 + eye.pupilDx;
+  int16_t pupilTop = top + (height - pupilH) / 2 + eye.pupilDy;
+  display_.drawRBox(pupilLeft, pupilTop, pupilW, pupilH, 3);
 
   display_.setDrawColor(1);
-  display_.drawRBox(mouthLeft, mouthTop, mouthWidth, mouthHeight, 6);
+  display_.drawRFrame(left, top, width, height, 4);
+
+  if (eye.smile > 0) {
+    display_.drawLine(left + 2, top + height, left + 8, top + height + 1);
+    display_.drawLine(left + width - 2, top + height, left + width - 8, top + height + 1);
+  } else if (eye.smile < 0) {
+    display_.drawLine(left + 2, top + 1, left + 10, top - 2);
+    display_.drawLine(left + width - 2, top + 1, left + width - 10, top - 2);
+  }
+}
+
+void DisplayManager::drawMouthPrimitives(const MouthSprite& mouth, int16_t left, int16_t top) {
+  int16_t width = mouth.width;
+  int16_t height = mouth.height;
+  display_.setDrawColor(1);
+  display_.drawRBox(left, top, width, height, 6);
 
   display_.setDrawColor(0);
-  int16_t innerHeight = std::max<int16_t>(2, mouthHeight - 4);
-  display_.drawRBox(mouthLeft + 2, mouthTop + 2, mouthWidth - 4, innerHeight, 4);
+  int16_t innerHeight = std::max<int16_t>(2, height - 4);
+  display_.drawRBox(left + 2, top + 2, width - 4, innerHeight, 4);
 
   display_.setDrawColor(1);
-  if (mouthCurve > 0.25f) {
-    display_.drawLine(mouthLeft, mouthTop + mouthHeight - 1, mouthLeft + 6, mouthTop + mouthHeight + 1);
-    display_.drawLine(mouthLeft + mouthWidth - 1, mouthTop + mouthHeight - 1, mouthLeft + mouthWidth - 6,
-                      mouthTop + mouthHeight + 1);
-  } else if (mouthCurve < -0.25f) {
-    display_.drawLine(mouthLeft, mouthTop + 1, mouthLeft + 6, mouthTop - 2);
-    display_.drawLine(mouthLeft + mouthWidth - 1, mouthTop + 1, mouthLeft + mouthWidth - 6, mouthTop - 2);
+  if (mouth.curve > 0) {
+    display_.drawLine(left, top + height - 1, left + 6, top + height + 1);
+    display_.drawLine(left + width - 1, top + height - 1, left + width - 6, top + height + 1);
+  } else if (mouth.curve < 0) {
+    display_.drawLine(left, top + 1, left + 6, top - 2);
+    display_.drawLine(left + width - 1, top + 1, left + width - 6, top - 2);
   } else {
-    display_.drawLine(mouthLeft, mouthTop + mouthHeight, mouthLeft + mouthWidth, mouthTop + mouthHeight);
+    display_.drawLine(left, top + height, left + width, top + height);
   }
+}
 
-  if (interaction > 0.6f) {
-    int16_t sparkY = centerY - 26;
-    display_.drawPixel(centerX - eyeSpacing - 6, sparkY);
-    display_.drawPixel(centerX + eyeSpacing + 6, sparkY + 1);
-    display_.drawPixel(centerX - 2, sparkY + 4);
+void DisplayManager::recordFaceCycles(uint32_t cycles) {
+  faceCyclesWindow_ += cycles;
+  if (++faceFramesWindow_ < kFaceStatsWindow) {
+    return;
   }
+  averageFaceCycles_ = faceCyclesWindow_ / faceFramesWindow_;
+  LOG_DEBUG(kLogTagDisplay, "Face layer avg %lu cycles/frame over %u frames (sprites eye %lu/%lu mouth %lu/%lu hit/miss)",
+            static_cast<unsigned long>(averageFaceCycles_), faceFramesWindow_,
+            static_cast<unsigned long>(eyeSprites_.hits()), static_cast<unsigned long>(eyeSprites_.misses()),
+            static_cast<unsigned long>(mouthSprites_.hits()), static_cast<unsigned long>(mouthSprites_.misses()));
+  faceCyclesWindow_ = 0;
+  faceFramesWindow_ = 0;
 }
+
 void DisplayManager::drawMenuLayer(const MenuListView& menu) {
   display_.setFont(u8g2_font_6x12_tf);
-  if (menu.title != nullptr) {
-    int16_t width = display_.getStrWidth(menu.title);
-    display_.drawStr((128 - width) / 2, 12, menu.title);
-  }
-  display_.drawLine(0, 16, 128, 16);
 
   uint8_t visible = std::min<uint8_t>(menu.entryCount, MenuListView::kMaxVisible);
   for (uint8_t i = 0; i < visible; ++i) {
@@ -236,12 +491,15 @@ void DisplayManager::drawMenuLayer(const MenuListView& menu) {
     bool selected = (index == menu.selectedIndex);
     int16_t y = 30 + i * 12;
     if (selected) {
+      // The selected label scrolls as a marquee when it does not fit.
       display_.drawBox(0, y - 11, 128, 12);
       display_.setDrawColor(0);
-    }
-    display_.drawStr(6, y - 1, label);
-    if (selected) {
+      display_.setClipWindow(kMenuLabelLeft, y - 11, kMenuLabelLeft + kMenuLabelWidth, y + 1);
+      display_.drawStr(kMenuLabelLeft - static_cast<int16_t>(menuMarquee_), y - 1, label);
+      display_.setMaxClipWindow();
       display_.setDrawColor(1);
+    } else {
+      display_.drawStr(kMenuLabelLeft, y - 1, label);
     }
   }
 
@@ -253,80 +511,99 @@ void DisplayManager::drawMenuLayer(const MenuListView& menu) {
   }
 }
 
-void DisplayManager::drawInfoLayer(const sensing::EnvironmentReadings& environment, const SystemStatusView& status) {
-  display_.setFont(u8g2_font_6x12_tf);
-  display_.drawStr(4, 12, "Plant insights");
-  display_.drawLine(0, 16, 128, 16);
+void DisplayManager::prepareMenuView(const MenuListView& menu, uint32_t nowMs) {
+  const char* label = "";
+  if (menu.selectedIndex >= menu.topIndex && menu.selectedIndex - menu.topIndex < MenuListView::kMaxVisible) {
+    const char* item = menu.items[menu.selectedIndex - menu.topIndex];
+    label = item != nullptr ? item : "";
+  }
+  menuMarquee_ = marqueeOffset(mediumGlyphs_.width(label), kMenuLabelWidth, nowMs);
+}
 
-  display_.setFont(u8g2_font_5x8_tf);
-  int16_t y = 26;
-  char buffer[32];
+void DisplayManager::prepareInfoView(const SystemStatusView& status, uint32_t nowMs) {
+  bool hasProfile = status.profile != nullptr && status.profile->valid;
+  const char* notes[TextLayout::kMaxParagraphs] = {};
+  uint8_t noteCount = 0;
 
   if (status.fetchInProgress) {
-    display_.drawStr(4, y, "Fetching profile...");
-    y += 10;
-    if (status.profileStatus.length() > 0) {
-      display_.drawStr(4, y, status.profileStatus.c_str());
-      y += 10;
-    }
-  } else if (status.profile != nullptr && status.profile->valid) {
+    infoView_.header = "Fetching profile...";
+    notes[noteCount++] = status.profileStatus.c_str();
+  } else if (hasProfile) {
     const plant::PlantProfile& profile = *status.profile;
-    display_.drawStr(4, y, profile.speciesCommonName.length() ? profile.speciesCommonName.c_str() : "Unnamed companion");
-    y += 10;
-    if (profile.summary.length() > 0) {
-      display_.drawStr(4, y, profile.summary.c_str());
-      y += 10;
+    infoView_.header = profile.speciesCommonName.length() ? profile.speciesCommonName.c_str() : "Unnamed companion";
+    notes[noteCount++] = profile.summary.c_str();
+    for (const String& tip : profile.tips) {
+      notes[noteCount++] = tip.c_str();
     }
-    std::snprintf(buffer, sizeof(buffer), "Soil %2.0f-%2.0f%%", profile.soilTargetMinPct, profile.soilTargetMaxPct);
-    display_.drawStr(4, y, buffer);
-    y += 10;
-    std::snprintf(buffer, sizeof(buffer), "Light %2.0f-%2.0f%%", profile.lightTargetMinPct, profile.lightTargetMaxPct);
-    display_.drawStr(4, y, buffer);
-    y += 10;
   } else {
-    display_.drawStr(4, y, "No profile yet. Use menu or app.");
-    y += 10;
-    if (status.wifiStatus.length() > 0) {
-      display_.drawStr(4, y, status.wifiStatus.c_str());
-      y += 10;
-    }
+    infoView_.header = "No profile yet. Use menu or app.";
+    notes[noteCount++] = status.wifiStatus.c_str();
+    notes[noteCount++] = status.profileStatus.c_str();
   }
 
-  y = std::max<int16_t>(y, 38);
-  display_.drawLine(0, y, 128, y);
-  y += 10;
-
-  std::snprintf(buffer, sizeof(buffer), "Soil %s %2.0f%%",
-                environment.soilValid ? "" : "(?)", environment.soilMoisturePct);
-  display_.drawStr(4, y, buffer);
-  std::snprintf(buffer, sizeof(buffer), "Light %s %2.0f%%",
-                environment.lightValid ? "" : "(?)", environment.lightPct);
-  display_.drawStr(4, y + 10, buffer);
-  if (environment.climateValid) {
-    std::snprintf(buffer, sizeof(buffer), "Temp %2.1fC  Hum %2.0f%%", environment.temperatureC, environment.humidityPct);
+  infoNotes_.update(notes, noteCount, smallGlyphs_, kTextWidth);
+  infoView_.fixedPages = hasProfile ? 2 : 1;
+  infoView_.pageCount = infoView_.fixedPages + (infoNotes_.lineCount() + kInfoBodyRows - 1) / kInfoBodyRows;
+  infoView_.page = pageForTime(infoView_.pageCount, nowMs);
+  infoView_.headerWidth = smallGlyphs_.width(infoView_.header);
+  infoView_.marquee = marqueeOffset(infoView_.headerWidth, kTextWidth, nowMs);
+}
+
+void DisplayManager::drawInfoLayer(const sensing::EnvironmentReadings& environment, const SystemStatusView& status) {
+  display_.setFont(u8g2_font_5x8_tf);
+
+  // Header row; scrolls as a marquee when it does not fit.
+  display_.setClipWindow(kTextLeft, 17, kTextLeft + kTextWidth, 28);
+  display_.drawStr(kTextLeft - static_cast<int16_t>(infoView_.marquee), 26, infoView_.header);
+  display_.setMaxClipWindow();
+
+  char buffer[40];
+  const int16_t rowY[kInfoBodyRows] = {37, 47};
+  if (infoView_.page == 0) {
+    std::snprintf(buffer, sizeof(buffer), "Soil%s %2.0f%%  Light%s %2.0f%%", environment.soilValid ? "" : "?",
+                  environment.soilMoisturePct, environment.lightValid ? "" : "?", environment.lightPct);
+    display_.drawStr(kTextLeft, rowY[0], buffer);
+    if (environment.climateValid) {
+      std::snprintf(buffer, sizeof(buffer), "Temp %2.1fC  Hum %2.0f%%", environment.temperatureC,
+                    environment.humidityPct);
+    } else {
+      std::snprintf(buffer, sizeof(buffer), "Temp --.-C  Hum --.-%%");
+    }
+    display_.drawStr(kTextLeft, rowY[1], buffer);
+  } else if (infoView_.page == 1 && infoView_.fixedPages > 1 && status.profile != nullptr) {
+    const plant::PlantProfile& profile = *status.profile;
+    std::snprintf(buffer, sizeof(buffer), "Target soil %2.0f-%2.0f%%", profile.soilTargetMinPct,
+                  profile.soilTargetMaxPct);
+    display_.drawStr(kTextLeft, rowY[0], buffer);
+    std::snprintf(buffer, sizeof(buffer), "Target light %2.0f-%2.0f%%", profile.lightTargetMinPct,
+                  profile.lightTargetMaxPct);
+    display_.drawStr(kTextLeft, rowY[1], buffer);
   } else {
-    std::snprintf(buffer, sizeof(buffer), "Temp --.-C  Hum --.-%%");
+    uint8_t firstLine = (infoView_.page - infoView_.fixedPages) * kInfoBodyRows;
+    for (uint8_t row = 0; row < kInfoBodyRows; ++row) {
+      infoNotes_.copyLine(firstLine + row, buffer, sizeof(buffer));
+      if (buffer[0] != '\0') {
+        display_.drawStr(kTextLeft, rowY[row], buffer);
+      }
+    }
   }
-  display_.drawStr(4, y + 20, buffer);
 
-  if (status.profile != nullptr && status.profile->valid) {
-    const plant::PlantProfile& profile = *status.profile;
-    int16_t tipY = y + 32;
-    for (uint8_t i = 0; i < 3; ++i) {
-      if (profile.tips[i].length() == 0) continue;
-      display_.drawStr(4, tipY, profile.tips[i].c_str());
-      tipY += 10;
-      if (tipY > 62) break;
+  if (infoView_.pageCount > 1) {
+    // Page dots down the right edge of the body, packed closer when many.
+    int16_t spacing = std::min<int16_t>(3, kPageDotSpan / (infoView_.pageCount - 1));
+    for (uint8_t i = 0; i < infoView_.pageCount; ++i) {
+      int16_t y = kPageDotTop + i * spacing;
+      if (i == infoView_.page) {
+        display_.drawBox(126, y, 2, 2);
+      } else {
+        display_.drawPixel(127, y);
+      }
     }
-  } else if (status.profileStatus.length() > 0) {
-    display_.drawStr(4, y + 32, status.profileStatus.c_str());
   }
 }
 
 void DisplayManager::drawDebugLayer(const sensing::EnvironmentReadings& environment, const SystemStatusView& status) {
   display_.setFont(u8g2_font_5x8_tf);
-  display_.drawStr(4, 12, "Debug raw values");
-  display_.drawLine(0, 16, 128, 16);
 
   char buffer[24];
   std::snprintf(buffer, sizeof(buffer), "Soil raw : %4u", environment.soilRaw);
@@ -362,7 +639,7 @@ void DisplayManager::drawFooter(PageId page, uint8_t pageIndex, uint8_t pageCoun
   }
 
   const char* hint = "OK=Menu";
-  int16_t hintWidth = display_.getStrWidth(hint);
+  int16_t hintWidth = smallGlyphs_.width(hint);
   display_.drawStr((128 - hintWidth) / 2, 62, hint);
 
   if (pageCount == 0) {
@@ -371,7 +648,7 @@ void DisplayManager::drawFooter(PageId page, uint8_t pageIndex, uint8_t pageCoun
 
   char counter[12];
   std::snprintf(counter, sizeof(counter), "%u/%u", static_cast<unsigned>(pageIdx + 1), static_cast<unsigned>(pageCount));
-  int16_t width = display_.getStrWidth(counter);
+  int16_t width = smallGlyphs_.width(counter);
   display_.drawStr(128 - width - 2, 62, counter);
 }
 
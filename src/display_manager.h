@@ -3,9 +3,13 @@
 #include <Arduino.h>
 #include <U8g2lib.h>
 
+#include "display_power.h"
 #include "hardware_config.h"
+#include "motion_tables.h"
 #include "plant_profile.h"
 #include "sensors.h"
+#include "sprite_cache.h"
+#include "text_layout.h"
 
 namespace display {
 
@@ -15,8 +19,12 @@ enum class MenuEntryKind : uint8_t { Screen, Submenu, Action, Back };
 
 struct MenuListView {
   static constexpr uint8_t kMaxVisible = 5;
+  static constexpr uint8_t kLabelLength = 22;  // one 6x12 row plus the terminator
   const char* title = nullptr;
   const char* items[kMaxVisible] = {};
+  // Backing storage for labels and titles the menu generates on the fly.
+  char text[kMaxVisible][kLabelLength] = {};
+  char titleText[kLabelLength] = {};
   MenuEntryKind kinds[kMaxVisible] = {};
   uint8_t entryCount = 0;
   uint8_t selectedIndex = 0;
@@ -32,9 +40,15 @@ struct FaceExpressionView {
   int8_t mouthCurve = 0;       // -4 .. +4 (negative=frown, positive=smile)
   int8_t mouthOpen = 0;        // 0 .. +4 (jaw drop)
   bool blush = false;
-  bool winkLeft = false;
-  bool winkRight = false;
-  uint16_t interactionPulseMs = 0xFFFF;  // values < ~900ms signal a recent interaction gesture
+};
+
+// Transient animation state sampled from anim::FaceAnimator each frame.
+struct FacePose {
+  int16_t eyelidLeft = 0;   // 0 open .. 256 shut (Q8)
+  int16_t eyelidRight = 0;
+  int16_t interaction = 0;  // 0 .. 256 (Q8) strength of the interaction pulse
+  int8_t gazeX = 0;         // added to the mood gaze
+  int8_t gazeY = 0;
 };
 
 struct SystemStatusView {
@@ -46,11 +60,25 @@ struct SystemStatusView {
   uint32_t profileAgeSeconds = 0;
 };
 
+struct RenderStats {
+  uint32_t framesRendered = 0;
+  uint32_t framesSkipped = 0;  // static page frames whose inputs had not changed
+  uint32_t chromeBuilds = 0;   // page backgrounds rasterized because they were not cached
+};
+
+// Renders the UI into any full-buffer 128x64 U8g2 device: the SH1106 panel on
+// the pot, or a FramebufferDevice for off-screen snapshots and timing.
 class DisplayManager {
  public:
+  using ClockFn = unsigned long (*)();
+
+  explicit DisplayManager(U8G2& device) : display_(device) {}
+
   void begin();
 
-  void render(const FaceExpressionView& face,
+  // Returns false when a static page (Info, Debug, Menu) was skipped because
+  // none of its inputs changed since the last frame. Mood always renders.
+  bool render(const FaceExpressionView& face,
               const sensing::EnvironmentReadings& environment,
               const SystemStatusView& status,
               const MenuListView* menu,
@@ -58,19 +86,117 @@ class DisplayManager {
               PageId page,
               uint8_t pageIndex,
               uint8_t pageCount,
-              bool blinkFrame);
+              const FacePose& pose);
 
   void drawSplash(const char* line1, const char* line2 = nullptr);
+  // Minimal frame shown while the display idles: closed eyes and a drifting "z".
+  void drawSleepFrame();
+  // Panel contrast and power-save for an idle policy state.
+  void applyPowerState(PowerState state);
+
+  // Time source for the face animation; snapshots pin it for repeatable frames.
+  void setClock(ClockFn clock) { clock_ = clock != nullptr ? clock : millis; }
+  U8G2& device() { return display_; }
+
+  // Forces the next render() to draw even if the page inputs look unchanged.
+  void invalidate() { lastPageDigestValid_ = false; }
+  const RenderStats& renderStats() const { return renderStats_; }
+
+  // Mean CPU cycles spent in the face layer over the last stats window.
+  uint32_t averageFaceCycles() const { return averageFaceCycles_; }
 
  private:
-  void drawFaceLayer(const FaceExpressionView& face, bool blinkFrame, const char* timeText);
+  uint32_t pageInputs(const sensing::EnvironmentReadings& environment,
+                      const SystemStatusView& status,
+                      const MenuListView* menu,
+                      PageId page,
+                      uint8_t pageIndex,
+                      uint8_t pageCount) const;
+  // Static titles, rules and footer for a page, rasterized once per distinct
+  // (page, index, count, menu title) and copied under every later frame.
+  const uint8_t* chromeFor(PageId page, uint8_t pageIndex, uint8_t pageCount, const MenuListView* menu);
+  void drawChrome(PageId page, uint8_t pageIndex, uint8_t pageCount, const char* menuTitle);
+  void restoreChrome(const uint8_t* background);
+  void drawFaceLayer(const FaceExpressionView& face,
+                     const FacePose& pose,
+                     const char* timeText,
+                     const uint8_t* background);
   void drawMenuLayer(const MenuListView& menu);
+  void prepareMenuView(const MenuListView& menu, uint32_t nowMs);
+  void prepareInfoView(const SystemStatusView& status, uint32_t nowMs);
   void drawInfoLayer(const sensing::EnvironmentReadings& environment, const SystemStatusView& status);
   void drawDebugLayer(const sensing::EnvironmentReadings& environment, const SystemStatusView& status);
   void drawFooter(PageId page, uint8_t pageIndex, uint8_t pageCount, bool menuVisible);
+  void recordFaceCycles(uint32_t cycles);
+
+  // Quantized eye and mouth parameters; each distinct tuple is rasterized once.
+  struct EyeSprite {
+    uint8_t width = 0;
+    uint8_t height = 0;
+    uint8_t pupilWidth = 0;
+    int8_t pupilDx = 0;
+    int8_t pupilDy = 0;
+    int8_t smile = 0;  // -1 frown, 0 neutral, +1 smile
+    bool closed = false;
+    uint32_t key() const;
+  };
 
-  U8G2_SH1106_128X64_NONAME_F_HW_I2C display_{U8G2_R0, /* reset=*/U8X8_PIN_NONE, hw::PIN_I2C_SCL, hw::PIN_I2C_SDA};
+  struct MouthSprite {
+    uint8_t width = 0;
+    uint8_t height = 0;
+    int8_t curve = 0;  // -1 frown, 0 flat, +1 smile
+    uint32_t key() const;
+  };
+
+  // Eye tiles cover width <= 32 and height + strokes <= 28 rows; mouth tiles
+  // cover width + 1 <= 64 and height + strokes <= 24 rows.
+  using EyePool = SpritePool<32, 28, 8>;
+  using MouthPool = SpritePool<64, 24, 4>;
+  // Whole 1 KB frames in U8g2 page layout rather than XBM tiles.
+  using ChromePool = SpritePool<kFrameWidth, kFrameHeight, 4>;
+  static_assert(ChromePool::kBytes == kFrameWidth * kFrameHeight / 8, "chrome slots hold one full frame");
+
+  const uint8_t* eyeTile(const EyeSprite& eye);
+  const uint8_t* mouthTile(const MouthSprite& mouth);
+  void drawEyePrimitives(const EyeSprite& eye, int16_t left, int16_t top);
+  void drawMouthPrimitives(const MouthSprite& mouth, int16_t left, int16_t top);
+
+  U8G2& display_;
+  ClockFn clock_ = millis;
   bool started_ = false;
+
+  RenderStats renderStats_;
+  uint32_t lastPageDigest_ = 0;
+  bool lastPageDigestValid_ = false;
+
+  motion::PhaseAccumulator breathPhase_{hw::FACE_BREATH_PERIOD_MS};
+  motion::PhaseAccumulator swayPhase_{hw::FACE_SWAY_PERIOD_MS};
+  uint32_t lastFaceFrameMs_ = 0;
+  uint32_t faceCyclesWindow_ = 0;
+  uint16_t faceFramesWindow_ = 0;
+  uint32_t averageFaceCycles_ = 0;
+
+  static constexpr uint8_t kInfoBodyRows = 2;
+
+  // Per-frame state of the Info page, derived from the status and the clock.
+  struct InfoViewState {
+    const char* header = "";
+    uint16_t headerWidth = 0;
+    uint16_t marquee = 0;
+    uint8_t page = 0;
+    uint8_t pageCount = 1;
+    uint8_t fixedPages = 1;
+  };
+
+  GlyphMetrics smallGlyphs_;
+  GlyphMetrics mediumGlyphs_;
+  TextLayout infoNotes_;
+  InfoViewState infoView_;
+  uint16_t menuMarquee_ = 0;  // scroll offset of the selected menu row
+
+  EyePool eyeSprites_;
+  MouthPool mouthSprites_;
+  ChromePool chrome_;
 };
 
 }  // namespace display
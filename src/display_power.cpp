@@ -0,0 +1,95 @@
+#include "display_power.h"
+
+#include "hardware_config.h"
+#include "logging.h"
+
+namespace display {
+namespace {
+
+constexpr const char* kLogTagPower = "display-power";
+constexpr const char* kStateNames[] = {"active", "dimmed", "sleeping", "off"};
+
+struct IdleSchedule {
+  uint32_t dimMs;
+  uint32_t sleepMs;
+  uint32_t offMs;
+};
+
+constexpr IdleSchedule kIdleSchedule = {hw::DISPLAY_IDLE_DIM_MS, hw::DISPLAY_IDLE_SLEEP_MS, hw::DISPLAY_IDLE_OFF_MS};
+constexpr IdleSchedule kSleepySchedule = {hw::DISPLAY_SLEEPY_DIM_MS, hw::DISPLAY_SLEEPY_SLEEP_MS,
+                                          hw::DISPLAY_SLEEPY_OFF_MS};
+
+}  // namespace
+
+constexpr uint8_t DisplayPowerPolicy::kStateCount;
+
+void DisplayPowerPolicy::begin(uint32_t nowMs) {
+  state_ = PowerState::Active;
+  stateSinceMs_ = nowMs;
+  lastActivityMs_ = nowMs;
+}
+
+bool DisplayPowerPolicy::wake(uint32_t nowMs) {
+  lastActivityMs_ = nowMs;
+  if (state_ == PowerState::Active) {
+    return false;
+  }
+  enter(PowerState::Active, nowMs);
+  return true;
+}
+
+bool DisplayPowerPolicy::update(uint32_t nowMs, bool sleepyMood) {
+  const IdleSchedule& schedule = sleepyMood ? kSleepySchedule : kIdleSchedule;
+  uint32_t idleMs = nowMs - lastActivityMs_;
+  PowerState target = PowerState::Active;
+  if (idleMs >= schedule.offMs) {
+    target = PowerState::Off;
+  } else if (idleMs >= schedule.sleepMs) {
+    target = PowerState::Sleeping;
+  } else if (idleMs >= schedule.dimMs) {
+    target = PowerState::Dimmed;
+  }
+  // Only ever step down here; waking goes through wake().
+  if (static_cast<uint8_t>(target) <= static_cast<uint8_t>(state_)) {
+    return false;
+  }
+  enter(target, nowMs);
+  return true;
+}
+
+uint32_t DisplayPowerPolicy::frameIntervalMs() const {
+  switch (state_) {
+    case PowerState::Active:
+      return hw::FACE_FRAME_INTERVAL_MS;
+    case PowerState::Dimmed:
+      return hw::DISPLAY_DIM_FRAME_INTERVAL_MS;
+    case PowerState::Sleeping:
+      return hw::DISPLAY_SLEEP_FRAME_INTERVAL_MS;
+    case PowerState::Off:
+      break;
+  }
+  return 0;
+}
+
+uint32_t DisplayPowerPolicy::residencyMs(PowerState state, uint32_t nowMs) const {
+  uint32_t total = residencyMs_[static_cast<uint8_t>(state)];
+  if (state == state_) {
+    total += nowMs - stateSinceMs_;
+  }
+  return total;
+}
+
+const char* DisplayPowerPolicy::name(PowerState state) {
+  return kStateNames[static_cast<uint8_t>(state)];
+}
+
+void DisplayPowerPolicy::enter(PowerState next, uint32_t nowMs) {
+  residencyMs_[static_cast<uint8_t>(state_)] += nowMs - stateSinceMs_;
+  LOG_INFO(kLogTagPower, "Display %s -> %s after %lu ms idle", name(state_), name(next),
+           static_cast<unsigned long>(nowMs - lastActivityMs_));
+  state_ = next;
+  stateSinceMs_ = nowMs;
+  ++transitions_;
+}
+
+}  // namespace display
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace display {
+
+enum class PowerState : uint8_t { Active = 0, Dimmed = 1, Sleeping = 2, Off = 3 };
+
+// Idle policy for the OLED. Without interaction the display steps down to a
+// reduced frame rate, then a minimal sleeping frame, then panel power-save;
+// a Sleepy mood shortens every step. Time spent in each state is accumulated
+// so the saving can be read back over serial.
+class DisplayPowerPolicy {
+ public:
+  static constexpr uint8_t kStateCount = 4;
+
+  void begin(uint32_t nowMs);
+
+  // Button presses and significant sensor events. Returns true when the
+  // display was not Active, so the caller can swallow the waking press.
+  bool wake(uint32_t nowMs);
+  // Returns true when the state changed.
+  bool update(uint32_t nowMs, bool sleepyMood);
+
+  PowerState state() const { return state_; }
+  // Minimum time between frames in the current state; 0 means draw nothing.
+  uint32_t frameIntervalMs() const;
+  uint32_t residencyMs(PowerState state, uint32_t nowMs) const;
+  uint32_t transitions() const { return transitions_; }
+
+  static const char* name(PowerState state);
+
+ private:
+  void enter(PowerState next, uint32_t nowMs);
+
+  PowerState state_ = PowerState::Active;
+  uint32_t stateSinceMs_ = 0;
+  uint32_t lastActivityMs_ = 0;
+  uint32_t residencyMs_[kStateCount] = {};
+  uint32_t transitions_ = 0;
+};
+
+}  // namespace display
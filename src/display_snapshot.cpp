@@ -0,0 +1,220 @@
+#include "display_snapshot.h"
+
+#include <new>
+
+namespace display {
+namespace {
+
+struct PoseDef {
+  const char* name;
+  int8_t gazeX;
+  int8_t gazeY;
+  int8_t eyeOpenness;
+  int8_t eyeSmile;
+  int8_t mouthCurve;
+  int8_t mouthOpen;
+  bool blush;
+  int16_t eyelidLeft;   // animator eyelid closure, Q8
+  int16_t eyelidRight;
+  int16_t interaction;  // animator interaction pulse, Q8
+};
+
+// Reference poses covering the extremes of the face parameter space.
+constexpr PoseDef kReferencePoses[] = {
+    {"pose-joyful", 0, 0, 2, 3, 3, 1, true, 0, 0, 0},
+    {"pose-thirsty", 0, 1, -2, -1, -3, 0, false, 0, 0, 0},
+    {"pose-sleepy", 0, 2, -4, 1, -1, 0, false, 0, 0, 0},
+    {"pose-too-bright", -2, 0, -1, -3, -2, 1, false, 0, 0, 0},
+    {"pose-curious-wink", 0, 0, 1, 1, 1, 1, false, 0, 256, 0},
+    {"pose-blink", 0, 0, 0, 0, 0, 0, false, 256, 256, 0},
+    {"pose-interaction", 0, 0, 0, 0, 2, 0, false, 0, 0, 230},
+};
+constexpr uint8_t kPoseCount = sizeof(kReferencePoses) / sizeof(PoseDef);
+
+enum class SceneKind : uint8_t { Page, Splash, Pose };
+
+struct SceneDef {
+  const char* name;
+  SceneKind kind;
+  PageId page;
+  uint8_t pageIndex;
+};
+
+constexpr SceneDef kScenes[] = {
+    {"page-mood", SceneKind::Page, PageId::Mood, 0},
+    {"page-info", SceneKind::Page, PageId::Info, 1},
+    {"page-debug", SceneKind::Page, PageId::Debug, 2},
+    {"page-menu", SceneKind::Page, PageId::Menu, 0},
+    {"splash", SceneKind::Splash, PageId::Mood, 0},
+};
+constexpr uint8_t kSceneCount = sizeof(kScenes) / sizeof(SceneDef);
+
+unsigned long pinnedClock() {
+  return 0;
+}
+
+// Off-screen panel and renderer, built only while snapshots are taken.
+struct SnapshotRig {
+  FramebufferDevice panel;
+  DisplayManager display{panel};
+};
+
+// Fixed inputs, so the same build always renders the same frames.
+struct SnapshotInputs {
+  sensing::EnvironmentReadings environment;
+  SystemStatusView status;
+  MenuListView menu;
+  uint8_t pageCount = 0;
+};
+
+void fillFixture(SnapshotInputs& inputs, uint8_t pageCount) {
+  sensing::EnvironmentReadings& env = inputs.environment;
+  env.temperatureC = 22.5f;
+  env.humidityPct = 48.0f;
+  env.climateValid = true;
+  env.soilRaw = 2100;
+  env.soilMoisturePct = 41.0f;
+  env.soilValid = true;
+  env.lightRaw = 1800;
+  env.lightPct = 63.0f;
+  env.lightValid = true;
+  env.batteryVolts = 3.92f;
+  env.batteryValid = true;
+
+  SystemStatusView& status = inputs.status;
+  status.profileStatus = "Monstera deliciosa";
+  status.wifiStatus = "Connected 192.168.1.42";
+  status.wifiConnected = true;
+  status.profileAgeSeconds = 3600;
+
+  static const char* const kItems[] = {"Plant presets", "Calibrate", "Display", "Wi-Fi info", "Back"};
+  static const MenuEntryKind kKinds[] = {MenuEntryKind::Submenu, MenuEntryKind::Submenu, MenuEntryKind::Submenu,
+                                         MenuEntryKind::Action, MenuEntryKind::Back};
+  MenuListView& menu = inputs.menu;
+  menu.title = "Settings";
+  for (uint8_t i = 0; i < MenuListView::kMaxVisible; ++i) {
+    menu.items[i] = kItems[i];
+    menu.kinds[i] = kKinds[i];
+  }
+  menu.entryCount = MenuListView::kMaxVisible;
+  menu.totalCount = MenuListView::kMaxVisible + 1;  // shows the scroll marker
+  menu.selectedIndex = 1;
+  menu.topIndex = 0;
+
+  inputs.pageCount = pageCount;
+}
+
+// Allocates the rig and fixture, or says why it could not.
+template <typename Fn>
+void withRig(uint8_t pageCount, Print& out, Fn fn) {
+  SnapshotRig* rig = new (std::nothrow) SnapshotRig;
+  SnapshotInputs* inputs = new (std::nothrow) SnapshotInputs;
+  if (rig == nullptr || inputs == nullptr) {
+    out.println("# snapshot error: not enough heap for the off-screen display");
+  } else {
+    fillFixture(*inputs, pageCount);
+    rig->display.setClock(pinnedClock);
+    fn(rig->display, *inputs);
+  }
+  delete inputs;
+  delete rig;
+}
+
+FaceExpressionView faceFor(const PoseDef& pose) {
+  FaceExpressionView face;
+  face.gazeX = pose.gazeX;
+  face.gazeY = pose.gazeY;
+  face.eyeOpenness = pose.eyeOpenness;
+  face.eyeSmile = pose.eyeSmile;
+  face.mouthCurve = pose.mouthCurve;
+  face.mouthOpen = pose.mouthOpen;
+  face.blush = pose.blush;
+  return face;
+}
+
+FacePose animationFor(const PoseDef& pose) {
+  FacePose sampled;
+  sampled.eyelidLeft = pose.eyelidLeft;
+  sampled.eyelidRight = pose.eyelidRight;
+  sampled.interaction = pose.interaction;
+  return sampled;
+}
+
+// Scene indices run over kScenes first, then kReferencePoses.
+const char* renderScene(DisplayManager& scratch, const SnapshotInputs& inputs, uint8_t index) {
+  const sensing::EnvironmentReadings& environment = inputs.environment;
+  const SystemStatusView& status = inputs.status;
+
+  scratch.invalidate();
+  if (index < kSceneCount) {
+    const SceneDef& scene = kScenes[index];
+    if (scene.kind == SceneKind::Splash) {
+      scratch.drawSplash("Plantey", "breathing in...");
+    } else {
+      FaceExpressionView face;
+      scratch.render(face, environment, status, &inputs.menu, "", scene.page, scene.pageIndex, inputs.pageCount,
+                     FacePose());
+    }
+    return scene.name;
+  }
+
+  const PoseDef& pose = kReferencePoses[index - kSceneCount];
+  scratch.render(faceFor(pose), environment, status, nullptr, "", PageId::Mood, 0, inputs.pageCount,
+                 animationFor(pose));
+  return pose.name;
+}
+
+}  // namespace
+
+FramebufferDevice::FramebufferDevice() : U8G2() {
+  u8g2_Setup_sh1106_128x64_noname_f(&u8g2, U8G2_R0, u8x8_byte_empty, u8x8_dummy_cb);
+}
+
+void writePbm(U8G2& device, Print& out) {
+  const uint8_t* frame = device.getBufferPtr();
+  out.printf("P1\n%d %d\n", kFrameWidth, kFrameHeight);
+  char line[kFrameWidth / 2 + 2];
+  for (int16_t y = 0; y < kFrameHeight; ++y) {
+    const uint8_t* page = frame + (y >> 3) * kFrameWidth;
+    uint8_t mask = static_cast<uint8_t>(1u << (y & 7));
+    // Plain PBM caps lines at 70 characters, so each row is split in two.
+    for (int16_t half = 0; half < 2; ++half) {
+      for (int16_t i = 0; i < kFrameWidth / 2; ++i) {
+        line[i] = (page[half * (kFrameWidth / 2) + i] & mask) ? '1' : '0';
+      }
+      line[kFrameWidth / 2] = '\n';
+      line[kFrameWidth / 2 + 1] = '\0';
+      out.print(line);
+    }
+  }
+}
+
+void dumpSnapshots(uint8_t pageCount, Print& out) {
+  withRig(pageCount, out, [&out](DisplayManager& scratch, const SnapshotInputs& inputs) {
+    for (uint8_t i = 0; i < kSceneCount + kPoseCount; ++i) {
+      const char* name = renderScene(scratch, inputs, i);
+      out.printf("# snapshot %s\n", name);
+      writePbm(scratch.device(), out);
+    }
+  });
+  out.println("# snapshot end");
+}
+
+void benchmarkSnapshots(uint8_t pageCount, uint16_t iterations, Print& out) {
+  if (iterations == 0) {
+    iterations = 1;
+  }
+  withRig(pageCount, out, [&out, iterations](DisplayManager& scratch, const SnapshotInputs& inputs) {
+    for (uint8_t i = 0; i < kSceneCount + kPoseCount; ++i) {
+      const char* name = nullptr;
+      uint32_t start = micros();
+      for (uint16_t n = 0; n < iterations; ++n) {
+        name = renderScene(scratch, inputs, i);
+      }
+      uint32_t elapsed = micros() - start;
+      out.printf("[bench] %-18s %6lu us/render\n", name, static_cast<unsigned long>(elapsed / iterations));
+    }
+  });
+}
+
+}  // namespace display
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+#include "display_manager.h"
+
+namespace display {
+
+// SH1106-shaped U8g2 device whose bus callbacks do nothing: frames are only
+// rendered into the 1 KB RAM buffer, never sent anywhere.
+class FramebufferDevice : public U8G2 {
+ public:
+  FramebufferDevice();
+};
+
+// Writes the device frame buffer as a plain (P1) PBM image.
+void writePbm(U8G2& device, Print& out);
+
+// Renders every page, the splash screen and the reference face poses from
+// fixed fixture readings, status and menu, and prints each frame as a named
+// PBM block, ready to diff against golden images off-device. The off-screen
+// display is allocated for the call only.
+void dumpSnapshots(uint8_t pageCount, Print& out);
+
+// Renders each snapshot `iterations` times and prints microseconds per render.
+void benchmarkSnapshots(uint8_t pageCount, uint16_t iterations, Print& out);
+
+}  // namespace display
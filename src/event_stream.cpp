@@ -0,0 +1,151 @@
+#include "event_stream.h"
+
+#include "logging.h"
+
+namespace web {
+namespace {
+constexpr const char* kLogTagEvents = "events";
+// Comment line sent to idle clients: keeps proxies from timing out and finds dead clients.
+constexpr char kPing[] = ": ping\n\n";
+}  // namespace
+
+bool EventStream::subscribe(uint8_t* id) {
+  uint32_t nowMs = millis();
+  portENTER_CRITICAL(&lock_);
+  for (uint8_t i = 0; i < kMaxSubscribers; ++i) {
+    Subscriber& subscriber = subscribers_[i];
+    if (subscriber.active) {
+      continue;
+    }
+    subscriber.active = true;
+    subscriber.greeted = false;
+    subscriber.head = 0;
+    subscriber.count = 0;
+    subscriber.missed = 0;
+    subscriber.lastSendMs = nowMs;  // the previous holder's clock would trigger an early ping
+    ++subscriberCount_;
+    portEXIT_CRITICAL(&lock_);
+    *id = i;
+    LOG_INFO(kLogTagEvents, "Subscriber %u joined (%u/%u)", i, subscriberCount_, kMaxSubscribers);
+    return true;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return false;
+}
+
+void EventStream::unsubscribe(uint8_t id) {
+  if (id >= kMaxSubscribers) {
+    return;
+  }
+  portENTER_CRITICAL(&lock_);
+  if (subscribers_[id].active) {
+    subscribers_[id].active = false;
+    --subscriberCount_;
+  }
+  portEXIT_CRITICAL(&lock_);
+  LOG_INFO(kLogTagEvents, "Subscriber %u left", id);
+}
+
+HttpStream EventStream::streamFor(uint8_t id) {
+  HttpStream stream;
+  stream.poll = &EventStream::pollStream;
+  stream.close = &EventStream::closeStream;
+  stream.context = this;
+  stream.id = id;
+  return stream;
+}
+
+void EventStream::publish(const char* type, const char* data) {
+  if (subscriberCount_ == 0) {
+    return;
+  }
+  char event[kEventBytes];
+  int length = snprintf(event, sizeof(event), "event: %s\ndata: %s\n\n", type, data);
+  if (length < 0 || length >= static_cast<int>(sizeof(event))) {
+    LOG_WARN(kLogTagEvents, "Event '%s' exceeds %u bytes, not sent", type, kEventBytes);
+    return;
+  }
+
+  portENTER_CRITICAL(&lock_);
+  ++published_;
+  for (Subscriber& subscriber : subscribers_) {
+    if (!subscriber.active) {
+      continue;
+    }
+    if (subscriber.count == kQueueDepth) {
+      // Drop-oldest: a client that falls behind sees the newest state.
+      subscriber.head = static_cast<uint8_t>((subscriber.head + 1) % kQueueDepth);
+      --subscriber.count;
+      ++subscriber.missed;
+      ++dropped_;
+    }
+    uint8_t slot = static_cast<uint8_t>((subscriber.head + subscriber.count) % kQueueDepth);
+    memcpy(subscriber.events[slot], event, static_cast<size_t>(length));
+    subscriber.lengths[slot] = static_cast<uint8_t>(length);
+    ++subscriber.count;
+  }
+  portEXIT_CRITICAL(&lock_);
+}
+
+size_t EventStream::poll(uint8_t id, char* buffer, size_t capacity, uint32_t nowMs) {
+  if (id >= kMaxSubscribers) {
+    return 0;
+  }
+  Subscriber& subscriber = subscribers_[id];
+  portENTER_CRITICAL(&lock_);
+  bool active = subscriber.active;
+  bool greet = active && !subscriber.greeted;
+  uint16_t missed = active ? subscriber.missed : 0;
+  if (active) {
+    subscriber.greeted = true;
+    subscriber.missed = 0;
+  }
+  portEXIT_CRITICAL(&lock_);
+  if (!active) {
+    return 0;
+  }
+
+  // Notices are formatted outside the lock; publish() may be waiting on it.
+  size_t used = 0;
+  auto append = [&](const char* format, auto... args) {
+    int written = snprintf(buffer + used, capacity - used, format, args...);
+    if (written > 0 && used + static_cast<size_t>(written) < capacity) {
+      used += static_cast<size_t>(written);
+    }
+  };
+  if (greet) {
+    append("retry: %u\nevent: hello\ndata: {\"maxSubscribers\":%u,\"queueDepth\":%u,\"eventBytes\":%u,\"memoryBytes\":%u}\n\n",
+           kRetryMs, kMaxSubscribers, kQueueDepth, kEventBytes, static_cast<unsigned>(memoryBytes()));
+  }
+  if (missed > 0) {
+    append("event: dropped\ndata: {\"count\":%u}\n\n", missed);
+  }
+
+  // Queued events are already formatted, so the lock only covers copying them.
+  portENTER_CRITICAL(&lock_);
+  while (subscriber.count > 0 && used + subscriber.lengths[subscriber.head] < capacity) {
+    memcpy(buffer + used, subscriber.events[subscriber.head], subscriber.lengths[subscriber.head]);
+    used += subscriber.lengths[subscriber.head];
+    subscriber.head = static_cast<uint8_t>((subscriber.head + 1) % kQueueDepth);
+    --subscriber.count;
+  }
+  if (used == 0 && nowMs - subscriber.lastSendMs >= kHeartbeatMs && sizeof(kPing) <= capacity) {
+    memcpy(buffer, kPing, sizeof(kPing) - 1);
+    used = sizeof(kPing) - 1;
+  }
+  if (used > 0) {
+    subscriber.lastSendMs = nowMs;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return used;
+}
+
+size_t EventStream::pollStream(void* context, uint8_t id, char* buffer, size_t capacity) {
+  return static_cast<EventStream*>(context)->poll(id, buffer, capacity, millis());
+}
+
+void EventStream::closeStream(void* context, uint8_t id) {
+  static_cast<EventStream*>(context)->unsubscribe(id);
+}
+
+}  // namespace web
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "http_server.h"
+
+namespace web {
+
+// Fan-out of server-sent events to a fixed number of subscribers. Each one
+// has its own ring of preformatted events; when a slow client's ring is full
+// the oldest event is dropped and the client is told how many it missed.
+// Memory is fixed: kMaxSubscribers * kQueueDepth * kEventBytes plus counters.
+class EventStream {
+ public:
+  static constexpr uint8_t kMaxSubscribers = 2;
+  static constexpr uint8_t kQueueDepth = 8;
+  static constexpr uint8_t kEventBytes = 128;  // one "event:" + "data:" record
+  static constexpr uint32_t kHeartbeatMs = 15000;
+  static constexpr uint16_t kRetryMs = 3000;
+
+  // Claims a subscriber slot; false when all are taken.
+  bool subscribe(uint8_t* id);
+  void unsubscribe(uint8_t id);
+  // Hands the slot to the HTTP server, which polls it for bytes to send.
+  HttpStream streamFor(uint8_t id);
+
+  // Queues one event for every subscriber. Safe to call from any task.
+  void publish(const char* type, const char* data);
+  // Copies whatever is pending for the subscriber into buffer.
+  size_t poll(uint8_t id, char* buffer, size_t capacity, uint32_t nowMs);
+
+  bool hasSubscribers() const { return subscriberCount_ > 0; }
+  uint8_t subscriberCount() const { return subscriberCount_; }
+  uint32_t published() const { return published_; }
+  uint32_t dropped() const { return dropped_; }
+  static constexpr size_t memoryBytes() { return sizeof(Subscriber) * kMaxSubscribers; }
+
+ private:
+  struct Subscriber {
+    bool active = false;
+    bool greeted = false;
+    uint8_t head = 0;
+    uint8_t count = 0;
+    uint16_t missed = 0;  // dropped since the client was last told
+    uint32_t lastSendMs = 0;
+    uint8_t lengths[kQueueDepth] = {};
+    char events[kQueueDepth][kEventBytes] = {};
+  };
+
+  static size_t pollStream(void* context, uint8_t id, char* buffer, size_t capacity);
+  static void closeStream(void* context, uint8_t id);
+
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  Subscriber subscribers_[kMaxSubscribers];
+  volatile uint8_t subscriberCount_ = 0;
+  uint32_t published_ = 0;
+  uint32_t dropped_ = 0;
+};
+
+}  // namespace web
@@ -19,6 +19,55 @@ bool isValid(float v) {
 }
 }  // namespace
 
+const char* moodName(MoodKind mood) {
+  static constexpr const char* kNames[] = {"joyful",       "content",   "thirsty", "overwatered", "sleepy",
+                                           "seekingLight", "tooBright", "tooHot",  "tooCold",     "curious"};
+  uint8_t index = static_cast<uint8_t>(mood);
+  return index < sizeof(kNames) / sizeof(kNames[0]) ? kNames[index] : "unknown";
+}
+
+float ExpressionLogic::threshold(Threshold which) const {
+  switch (which) {
+    case Threshold::SoilDry:
+      return soilDryThreshold_;
+    case Threshold::SoilSoggy:
+      return soilSoggyThreshold_;
+    case Threshold::LightLow:
+      return lightLowThreshold_;
+    case Threshold::LightHigh:
+      return lightHighThreshold_;
+    case Threshold::TempMin:
+      return comfortTempMinC_;
+    case Threshold::TempMax:
+    default:
+      return comfortTempMaxC_;
+  }
+}
+
+void ExpressionLogic::setThreshold(Threshold which, float value) {
+  switch (which) {
+    case Threshold::SoilDry:
+      soilDryThreshold_ = value;
+      break;
+    case Threshold::SoilSoggy:
+      soilSoggyThreshold_ = value;
+      break;
+    case Threshold::LightLow:
+      lightLowThreshold_ = value;
+      break;
+    case Threshold::LightHigh:
+      lightHighThreshold_ = value;
+      break;
+    case Threshold::TempMin:
+      comfortTempMinC_ = value;
+      break;
+    case Threshold::TempMax:
+    default:
+      comfortTempMaxC_ = value;
+      break;
+  }
+}
+
 MoodResult ExpressionLogic::evaluate(const sensing::EnvironmentReadings& env) {
   bool soilValid = env.soilValid && isValid(env.soilMoisturePct);
   bool lightValid = env.lightValid && isValid(env.lightPct);
@@ -170,7 +219,7 @@ MoodResult ExpressionLogic::makeCurious(const sensing::EnvironmentReadings& env)
   mood.face.eyeSmile = 1;
   mood.face.mouthCurve = 1;
   mood.face.mouthOpen = 1;
-  mood.face.winkRight = true;
+  mood.playful = true;
   mood.tip = kTipCurious;
   return mood;
 }
@@ -20,12 +20,19 @@ enum class MoodKind : uint8_t {
   Curious,
 };
 
+// Stable lower-camel name for the web API.
+const char* moodName(MoodKind mood);
+
+// Tunable limits, editable from the menu.
+enum class Threshold : uint8_t { SoilDry, SoilSoggy, LightLow, LightHigh, TempMin, TempMax };
+
 struct MoodResult {
   MoodKind mood = MoodKind::Content;
   display::FaceExpressionView face;
   const char* tip = nullptr;
   bool playHydrationCue = false;
   bool playCelebrationCue = false;
+  bool playful = false;  // the face winks now and then (anim::FaceAnimator::setPlayful)
 };
 
 class ExpressionLogic {
@@ -47,6 +54,9 @@ class ExpressionLogic {
     comfortTempMaxC_ = maxComfort;
   }
 
+  float threshold(Threshold which) const;
+  void setThreshold(Threshold which, float value);
+
  private:
   MoodResult makeJoyful(const sensing::EnvironmentReadings& env);
   MoodResult makeThirsty(const sensing::EnvironmentReadings& env);
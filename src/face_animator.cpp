@@ -0,0 +1,261 @@
+#include "face_animator.h"
+
+#include "hardware_config.h"
+
+namespace anim {
+namespace {
+
+using motion::Ease;
+
+constexpr int16_t kShut = motion::kUnitQ8;
+
+template <size_t N>
+constexpr Track track(Channel channel, const Keyframe (&keys)[N]) {
+  return {channel, keys, static_cast<uint8_t>(N)};
+}
+
+template <size_t N>
+constexpr Clip clip(const Track (&tracks)[N]) {
+  uint16_t duration = 0;
+  for (size_t i = 0; i < N; ++i) {
+    uint16_t end = tracks[i].keys[tracks[i].keyCount - 1].timeMs;
+    if (end > duration) {
+      duration = end;
+    }
+  }
+  return {tracks, static_cast<uint8_t>(N), duration};
+}
+
+constexpr Keyframe kBlinkLid[] = {
+    {0, 0, Ease::Linear},
+    {60, kShut, Ease::InQuad},
+    {100, kShut, Ease::Linear},
+    {hw::BLINK_DURATION_MS, 0, Ease::OutQuad},
+};
+constexpr Track kBlinkTracks[] = {track(Channel::EyelidLeft, kBlinkLid), track(Channel::EyelidRight, kBlinkLid)};
+
+constexpr Keyframe kWinkLid[] = {
+    {0, 0, Ease::Linear},
+    {80, kShut, Ease::InQuad},
+    {240, kShut, Ease::Linear},
+    {320, 0, Ease::OutQuad},
+};
+constexpr Track kWinkLeftTracks[] = {track(Channel::EyelidLeft, kWinkLid)};
+constexpr Track kWinkRightTracks[] = {track(Channel::EyelidRight, kWinkLid)};
+
+// A button press: a playful left/right flutter on top of a decaying pulse.
+constexpr Keyframe kInteractionPulse[] = {
+    {0, kShut, Ease::Linear},
+    {900, 0, Ease::Linear},
+};
+constexpr Keyframe kFlutterLeft[] = {
+    {0, kShut, Ease::Linear},  {79, kShut, Ease::Linear},  {80, 0, Ease::Linear},
+    {159, 0, Ease::Linear},    {160, kShut, Ease::Linear}, {239, kShut, Ease::Linear},
+    {240, 0, Ease::Linear},
+};
+constexpr Keyframe kFlutterRight[] = {
+    {0, 0, Ease::Linear},      {79, 0, Ease::Linear},      {80, kShut, Ease::Linear},
+    {159, kShut, Ease::Linear}, {160, 0, Ease::Linear},    {239, 0, Ease::Linear},
+    {240, kShut, Ease::Linear}, {319, kShut, Ease::Linear}, {320, 0, Ease::Linear},
+};
+constexpr Track kInteractionTracks[] = {
+    track(Channel::Interaction, kInteractionPulse),
+    track(Channel::EyelidLeft, kFlutterLeft),
+    track(Channel::EyelidRight, kFlutterRight),
+};
+
+constexpr Keyframe kGlanceLeft[] = {
+    {0, 0, Ease::Linear},
+    {200, -3, Ease::OutQuad},
+    {900, -3, Ease::Linear},
+    {1100, 0, Ease::InOutSmooth},
+};
+constexpr Keyframe kGlanceRight[] = {
+    {0, 0, Ease::Linear},
+    {200, 3, Ease::OutQuad},
+    {900, 3, Ease::Linear},
+    {1100, 0, Ease::InOutSmooth},
+};
+constexpr Track kGlanceLeftTracks[] = {track(Channel::GazeX, kGlanceLeft)};
+constexpr Track kGlanceRightTracks[] = {track(Channel::GazeX, kGlanceRight)};
+
+// Played when the mood changes: a brief squint and a small perk-up.
+constexpr Keyframe kMoodShiftLid[] = {
+    {0, 0, Ease::Linear},
+    {120, 160, Ease::OutQuad},
+    {360, 0, Ease::InOutSmooth},
+};
+constexpr Keyframe kMoodShiftPulse[] = {
+    {0, 0, Ease::Linear},
+    {180, 96, Ease::OutQuad},
+    {420, 0, Ease::InOutSmooth},
+};
+constexpr Track kMoodShiftTracks[] = {
+    track(Channel::EyelidLeft, kMoodShiftLid),
+    track(Channel::EyelidRight, kMoodShiftLid),
+    track(Channel::Interaction, kMoodShiftPulse),
+};
+
+// Indexed by ClipId.
+constexpr Clip kClips[] = {
+    clip(kBlinkTracks),       clip(kWinkLeftTracks),   clip(kWinkRightTracks), clip(kInteractionTracks),
+    clip(kGlanceLeftTracks),  clip(kGlanceRightTracks), clip(kMoodShiftTracks),
+};
+
+// Idle clips fired on randomized intervals; `alternate` is picked half the time.
+struct ScheduleDef {
+  ClipId clip;
+  ClipId alternate;
+  uint16_t minIntervalMs;
+  uint16_t maxIntervalMs;
+  bool playfulOnly;
+};
+
+constexpr ScheduleDef kSchedules[] = {
+    {ClipId::Blink, ClipId::Blink, hw::BLINK_INTERVAL_MIN_MS, hw::BLINK_INTERVAL_MAX_MS, false},
+    {ClipId::GlanceLeft, ClipId::GlanceRight, 9000, 16000, false},
+    {ClipId::WinkRight, ClipId::WinkLeft, 3500, 8000, true},
+};
+constexpr uint8_t kScheduleCount = sizeof(kSchedules) / sizeof(ScheduleDef);
+
+int32_t clampChannel(int32_t value, int32_t minValue, int32_t maxValue) {
+  if (value < minValue) return minValue;
+  if (value > maxValue) return maxValue;
+  return value;
+}
+
+int16_t sampleTrack(const Track& track, uint32_t elapsedMs) {
+  const Keyframe* keys = track.keys;
+  if (elapsedMs <= keys[0].timeMs) {
+    return keys[0].value;
+  }
+  for (uint8_t i = 1; i < track.keyCount; ++i) {
+    if (elapsedMs < keys[i].timeMs) {
+      const Keyframe& from = keys[i - 1];
+      const Keyframe& to = keys[i];
+      int32_t span = to.timeMs - from.timeMs;
+      int16_t progress = static_cast<int16_t>(((elapsedMs - from.timeMs) * motion::kUnitQ8) / span);
+      int32_t eased = motion::easeQ8(to.ease, progress);
+      return static_cast<int16_t>(from.value + ((to.value - from.value) * eased) / motion::kUnitQ8);
+    }
+  }
+  return keys[track.keyCount - 1].value;
+}
+
+}  // namespace
+
+static_assert(sizeof(kClips) / sizeof(Clip) == static_cast<size_t>(ClipId::MoodShift) + 1,
+              "kClips must list every ClipId in order");
+
+void FaceAnimator::begin(uint32_t nowMs) {
+  for (Instance& instance : active_) {
+    instance.active = false;
+  }
+  for (uint8_t i = 0; i < kScheduleCount && i < kMaxSchedules; ++i) {
+    scheduleNext(i, nowMs);
+  }
+}
+
+void FaceAnimator::trigger(ClipId clip, uint32_t nowMs) {
+  Instance* slot = nullptr;
+  for (Instance& instance : active_) {
+    if (instance.active && instance.clip == clip) {
+      slot = &instance;
+      break;
+    }
+    if (!instance.active && slot == nullptr) {
+      slot = &instance;
+    }
+  }
+  if (slot == nullptr) {
+    // Every slot busy: replace the clip that started first.
+    slot = &active_[0];
+    for (Instance& instance : active_) {
+      if (static_cast<int32_t>(instance.startMs - slot->startMs) < 0) {
+        slot = &instance;
+      }
+    }
+  }
+  slot->clip = clip;
+  slot->startMs = nowMs;
+  slot->active = true;
+}
+
+void FaceAnimator::update(uint32_t nowMs) {
+  for (Instance& instance : active_) {
+    if (instance.active && nowMs - instance.startMs >= durationMs(instance.clip)) {
+      instance.active = false;
+    }
+  }
+  for (uint8_t i = 0; i < kScheduleCount && i < kMaxSchedules; ++i) {
+    const ScheduleDef& schedule = kSchedules[i];
+    if (schedule.playfulOnly && !playful_) {
+      continue;
+    }
+    if (static_cast<int32_t>(nowMs - nextFireMs_[i]) >= 0) {
+      trigger(random(2) == 0 ? schedule.clip : schedule.alternate, nowMs);
+      scheduleNext(i, nowMs);
+    }
+  }
+}
+
+display::FacePose FaceAnimator::sample(uint32_t nowMs) const {
+  int32_t channels[static_cast<uint8_t>(Channel::GazeY) + 1] = {};
+  for (const Instance& instance : active_) {
+    if (!instance.active) {
+      continue;
+    }
+    const Clip& clip = kClips[static_cast<uint8_t>(instance.clip)];
+    uint32_t elapsed = nowMs - instance.startMs;
+    for (uint8_t t = 0; t < clip.trackCount; ++t) {
+      const Track& track = clip.tracks[t];
+      int32_t value = sampleTrack(track, elapsed);
+      int32_t& channel = channels[static_cast<uint8_t>(track.channel)];
+      if (track.channel == Channel::GazeX || track.channel == Channel::GazeY) {
+        channel += value;  // offsets stack
+      } else if (value > channel) {
+        channel = value;  // intensities take the strongest clip
+      }
+    }
+  }
+
+  display::FacePose pose;
+  pose.eyelidLeft = static_cast<int16_t>(clampChannel(channels[0], 0, motion::kUnitQ8));
+  pose.eyelidRight = static_cast<int16_t>(clampChannel(channels[1], 0, motion::kUnitQ8));
+  pose.interaction = static_cast<int16_t>(clampChannel(channels[2], 0, motion::kUnitQ8));
+  pose.gazeX = static_cast<int8_t>(clampChannel(channels[3], -6, 6));
+  pose.gazeY = static_cast<int8_t>(clampChannel(channels[4], -4, 4));
+  return pose;
+}
+
+bool FaceAnimator::isPlaying(ClipId clip) const {
+  for (const Instance& instance : active_) {
+    if (instance.active && instance.clip == clip) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t FaceAnimator::durationMs(ClipId clip) {
+  return kClips[static_cast<uint8_t>(clip)].durationMs;
+}
+
+void FaceAnimator::setPlayful(bool playful, uint32_t nowMs) {
+  if (playful == playful_) {
+    return;
+  }
+  playful_ = playful;
+  for (uint8_t i = 0; i < kScheduleCount && i < kMaxSchedules; ++i) {
+    if (playful && kSchedules[i].playfulOnly) {
+      nextFireMs_[i] = nowMs + durationMs(ClipId::MoodShift);
+    }
+  }
+}
+
+void FaceAnimator::scheduleNext(uint8_t schedule, uint32_t nowMs) {
+  const ScheduleDef& def = kSchedules[schedule];
+  nextFireMs_[schedule] = nowMs + def.minIntervalMs + random(def.maxIntervalMs - def.minIntervalMs);
+}
+
+}  // namespace anim
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "display_manager.h"
+#include "motion_tables.h"
+
+namespace anim {
+
+// Animated properties of the face. Eyelids and interaction are Q8 (0 .. 256);
+// gaze channels are pixel offsets added to the mood's resting gaze.
+enum class Channel : uint8_t { EyelidLeft, EyelidRight, Interaction, GazeX, GazeY };
+
+enum class ClipId : uint8_t { Blink, WinkLeft, WinkRight, Interaction, GlanceLeft, GlanceRight, MoodShift };
+
+// The ease applies to the segment that ends at this keyframe.
+struct Keyframe {
+  uint16_t timeMs;
+  int16_t value;
+  motion::Ease ease;
+};
+
+struct Track {
+  Channel channel;
+  const Keyframe* keys;
+  uint8_t keyCount;
+};
+
+struct Clip {
+  const Track* tracks;
+  uint8_t trackCount;
+  uint16_t durationMs;
+};
+
+// Owns every transient face behaviour (blinks, winks, the interaction pulse,
+// idle glances, the mood-change squint). Clips are constexpr tables in flash;
+// the renderer only samples the timeline at the current time.
+class FaceAnimator {
+ public:
+  void begin(uint32_t nowMs);
+
+  // Starts (or restarts) a clip.
+  void trigger(ClipId clip, uint32_t nowMs);
+  // Retires finished clips and fires randomly scheduled idle clips.
+  void update(uint32_t nowMs);
+  // Playful moods add winks to the idle clips; the first follows the
+  // mood-change squint. Cheap to call every pass.
+  void setPlayful(bool playful, uint32_t nowMs);
+  display::FacePose sample(uint32_t nowMs) const;
+
+  bool isPlaying(ClipId clip) const;
+  static uint16_t durationMs(ClipId clip);
+
+ private:
+  static constexpr uint8_t kMaxActive = 4;
+  static constexpr uint8_t kMaxSchedules = 3;
+
+  struct Instance {
+    ClipId clip = ClipId::Blink;
+    uint32_t startMs = 0;
+    bool active = false;
+  };
+
+  void scheduleNext(uint8_t schedule, uint32_t nowMs);
+
+  Instance active_[kMaxActive];
+  uint32_t nextFireMs_[kMaxSchedules] = {};
+  bool playful_ = false;
+};
+
+}  // namespace anim
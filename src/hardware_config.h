@@ -22,6 +22,29 @@ constexpr uint8_t PIN_BUZZER = 2;          // LEDC tone output (post-boot safe)
 constexpr uint8_t BUZZER_LEDC_CHANNEL = 0;
 constexpr uint8_t BUZZER_LEDC_TIMER = 0;
 constexpr uint8_t BUZZER_LEDC_RESOLUTION = 10;  // bits
+constexpr uint32_t BUZZER_LEDC_CLOCK_HZ = 80000000;  // APB clock feeding the LEDC timer
+
+// Sigma-delta wavetable synth (PLANTEY_AUDIO_SYNTH=1) on the same buzzer pin.
+constexpr uint8_t SYNTH_SD_CHANNEL = 0;
+constexpr uint32_t SYNTH_SD_CARRIER_HZ = 312500;
+constexpr uint8_t SYNTH_TIMER_NUM = 0;          // general-purpose timer driving the mixer
+constexpr uint32_t SYNTH_SAMPLE_RATE_HZ = 20000;
+
+// RGB glow on its own LEDC timer; channel 1 would share timer 0 with the buzzer.
+constexpr uint8_t RGB_LEDC_CHANNEL_RED = 2;
+constexpr uint8_t RGB_LEDC_CHANNEL_GREEN = 3;
+constexpr uint8_t RGB_LEDC_CHANNEL_BLUE = 4;
+constexpr uint8_t RGB_LEDC_TIMER = 1;
+constexpr uint8_t RGB_LEDC_RESOLUTION = 10;  // bits
+constexpr uint32_t RGB_LEDC_FREQUENCY_HZ = 5000;
+constexpr bool RGB_COMMON_ANODE = true;      // pins sink the cathodes, so outputs are inverted
+
+// Battery sense divider and thresholds (single Li-ion cell).
+constexpr float BATTERY_DIVIDER_RATIO = 2.0f;  // pack voltage / ADC pin voltage
+constexpr float BATTERY_PRESENT_MIN_V = 2.8f;  // below this we are running from USB only
+constexpr float BATTERY_LOW_V = 3.5f;
+constexpr float BATTERY_CRITICAL_V = 3.3f;
+constexpr float BATTERY_ALPHA = 0.20f;
 
 // Sensor calibration defaults. These are ballpark values and should be refined
 // using the calibration helper menu.
@@ -37,11 +60,30 @@ constexpr float LIGHT_ALPHA = 0.10f;
 // Button behaviour.
 constexpr uint16_t BUTTON_DEBOUNCE_MS = 35;
 constexpr uint16_t BUTTON_LONG_PRESS_MS = 700;
+constexpr uint16_t BUTTON_MULTI_CLICK_MS = 250;   // double/triple click window
+constexpr uint16_t BUTTON_REPEAT_START_MS = 260;  // first hold-repeat interval
+constexpr uint16_t BUTTON_REPEAT_MIN_MS = 60;     // repeats accelerate down to this
+constexpr uint16_t BUTTON_BOTH_HOLD_MS = 1500;
 
 // Display refresh periods.
 constexpr uint16_t FACE_FRAME_INTERVAL_MS = 90;
 constexpr uint16_t BLINK_INTERVAL_MIN_MS = 2500;
 constexpr uint16_t BLINK_INTERVAL_MAX_MS = 6000;
 constexpr uint16_t BLINK_DURATION_MS = 160;
+constexpr uint16_t FACE_BREATH_PERIOD_MS = 5200;
+constexpr uint16_t FACE_SWAY_PERIOD_MS = 8700;
+
+// Display idle policy: reduced frame rate, then a sleeping frame, then panel off.
+constexpr uint32_t DISPLAY_IDLE_DIM_MS = 3UL * 60UL * 1000UL;
+constexpr uint32_t DISPLAY_IDLE_SLEEP_MS = 10UL * 60UL * 1000UL;
+constexpr uint32_t DISPLAY_IDLE_OFF_MS = 20UL * 60UL * 1000UL;
+// Shorter steps while the plant itself is in the Sleepy mood (dark room).
+constexpr uint32_t DISPLAY_SLEEPY_DIM_MS = 20UL * 1000UL;
+constexpr uint32_t DISPLAY_SLEEPY_SLEEP_MS = 60UL * 1000UL;
+constexpr uint32_t DISPLAY_SLEEPY_OFF_MS = 5UL * 60UL * 1000UL;
+constexpr uint16_t DISPLAY_DIM_FRAME_INTERVAL_MS = 400;
+constexpr uint16_t DISPLAY_SLEEP_FRAME_INTERVAL_MS = 2000;
+constexpr uint8_t DISPLAY_CONTRAST_ACTIVE = 0xCF;
+constexpr uint8_t DISPLAY_CONTRAST_DIM = 0x20;
 
 }  // namespace hw
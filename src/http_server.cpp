@@ -0,0 +1,816 @@
+#include "http_server.h"
+
+#include <algorithm>
+#include <lwip/sockets.h>
+#include <strings.h>
+
+#include "logging.h"
+#include "metrics.h"
+
+namespace web {
+namespace {
+
+constexpr const char* kLogTagHttp = "http";
+constexpr uint32_t kTaskStackBytes = 6144;  // handlers build their JSON documents on this stack
+constexpr UBaseType_t kTaskPriority = 1;     // same as loop(); select() sleeps when idle
+constexpr int kListenBacklog = 2;
+
+metrics::LabeledCounter httpResponses("plantey_http_responses_total", "HTTP responses by route and status", "route",
+                                      "code");
+
+const char* reasonPhrase(int code) {
+  switch (code) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 302:
+      return "Found";
+    case 304:
+      return "Not Modified";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 406:
+      return "Not Acceptable";
+    case 413:
+      return "Payload Too Large";
+    case 431:
+      return "Request Header Fields Too Large";
+    case 503:
+      return "Service Unavailable";
+    case 500:
+    default:
+      return "Internal Server Error";
+  }
+}
+
+// Length of the head including the blank line, or 0 while it is incomplete.
+size_t findHeadEnd(const char* data, size_t length) {
+  for (size_t i = 3; i < length; ++i) {
+    if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+HttpMethod parseMethod(const char* token) {
+  if (strcmp(token, "GET") == 0) return HttpMethod::Get;
+  if (strcmp(token, "POST") == 0) return HttpMethod::Post;
+  if (strcmp(token, "OPTIONS") == 0) return HttpMethod::Options;
+  return HttpMethod::Other;
+}
+
+// True when a coding's parameters (between params and end) include q=0.
+bool zeroWeight(const char* params, const char* end) {
+  for (const char* p = params; p + 1 < end; ++p) {
+    if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+      p += 2;
+      while (p < end && (*p == '0' || *p == '.')) {
+        ++p;
+      }
+      return p == end || *p < '1' || *p > '9';
+    }
+  }
+  return false;
+}
+
+// Whether an Accept-Encoding value allows gzip, by name or through "*".
+// An explicit gzip entry wins over the wildcard.
+bool allowsGzip(const char* value) {
+  int8_t named = -1;
+  int8_t wildcard = -1;
+  while (*value != '\0') {
+    while (*value == ' ' || *value == ',') {
+      ++value;
+    }
+    const char* name = value;
+    while (*value != '\0' && *value != ',' && *value != ';' && *value != ' ') {
+      ++value;
+    }
+    size_t nameLength = static_cast<size_t>(value - name);
+    const char* params = value;
+    while (*value != '\0' && *value != ',') {
+      ++value;
+    }
+    if (nameLength == 4 && strncasecmp(name, "gzip", 4) == 0) {
+      named = zeroWeight(params, value) ? 0 : 1;
+    } else if (nameLength == 1 && *name == '*') {
+      wildcard = zeroWeight(params, value) ? 0 : 1;
+    }
+  }
+  return named >= 0 ? named == 1 : wildcard == 1;
+}
+
+// Splits off the next token ending in delimiter, terminating it in place.
+char* nextToken(char** cursor, char delimiter) {
+  char* start = *cursor;
+  char* end = strchr(start, delimiter);
+  if (end == nullptr) {
+    *cursor = start + strlen(start);
+    return start;
+  }
+  *end = '\0';
+  *cursor = end + 1;
+  return start;
+}
+
+}  // namespace
+
+void HttpResponse::addHeader(const char* name, const char* value) {
+  if (headerCount_ >= kMaxHeaders) {
+    LOG_WARN(kLogTagHttp, "Dropped header %s", name);
+    return;
+  }
+  headerNames_[headerCount_] = name;
+  headerValues_[headerCount_] = value;
+  ++headerCount_;
+}
+
+void HttpResponse::send(int code, const char* contentType, const char* body) {
+  send(code, contentType, body, body != nullptr ? strlen(body) : 0);
+}
+
+void HttpResponse::send(int code, const char* contentType, const char* body, size_t length) {
+  char* out = beginBody(code, contentType, length);
+  if (out == nullptr) {
+    LOG_WARN(kLogTagHttp, "Response of %u bytes does not fit", static_cast<unsigned>(length));
+    headerCount_ = 0;
+    writeHead(500, nullptr, 0);
+    sent_ = true;
+    return;
+  }
+  if (length > 0) {
+    memcpy(out, body, length);
+  }
+}
+
+char* HttpResponse::beginBody(int code, const char* contentType, size_t length) {
+  length_ = 0;
+  sent_ = false;
+  if (!writeHead(code, contentType, length) || length_ + length + 1 > capacity_) {
+    length_ = 0;
+    return nullptr;
+  }
+  char* body = buffer_ + length_;
+  length_ += length;
+  sent_ = true;
+  return body;
+}
+
+void HttpResponse::sendStatic(int code, const char* contentType, const void* body, size_t length) {
+  length_ = 0;
+  staticBody_ = nullptr;
+  staticLength_ = 0;
+  if (!writeHead(code, contentType, length)) {
+    send(500, "application/json", "{\"error\":\"Response head too large\"}");
+    return;
+  }
+  staticBody_ = static_cast<const char*>(body);
+  staticLength_ = length;
+  sent_ = true;
+}
+
+void HttpResponse::beginStream(const char* contentType, const HttpStream& stream) {
+  length_ = 0;
+  // The body ends when the connection does.
+  keepAlive_ = false;
+  streaming_ = true;
+  if (!writeHead(200, contentType, 0)) {
+    streaming_ = false;
+    send(500, "application/json", "{\"error\":\"Stream head too large\"}");
+    return;
+  }
+  stream_ = stream;
+  sent_ = true;
+}
+
+bool HttpResponse::beginChunked(int code, const char* contentType) {
+  if (flush_ == nullptr) {
+    return false;
+  }
+  length_ = 0;
+  chunked_ = true;
+  if (!writeHead(code, contentType, 0) || length_ + kChunkHeaderSize + kChunkReserve >= capacity_) {
+    chunked_ = false;
+    length_ = 0;
+    return false;
+  }
+  length_ += kChunkHeaderSize;
+  chunkStart_ = length_;
+  chunkOpen_ = true;
+  sent_ = true;
+  return true;
+}
+
+// Fills the open chunk; a full buffer is framed and flushed before going on.
+size_t HttpResponse::write(const char* data, size_t length) {
+  if (!chunkOpen_ || broken_) {
+    return 0;
+  }
+  size_t done = 0;
+  while (done < length) {
+    size_t room = capacity_ - kChunkReserve - length_;
+    if (room == 0) {
+      closeChunk();
+      if (!flush_(flushContext_, buffer_, length_)) {
+        broken_ = true;
+        return done;
+      }
+      flushed_ += length_;
+      length_ = kChunkHeaderSize;
+      chunkStart_ = length_;
+      continue;
+    }
+    size_t count = std::min(room, length - done);
+    memcpy(buffer_ + length_, data + done, count);
+    length_ += count;
+    done += count;
+  }
+  return done;
+}
+
+// Leaves the final chunk and terminator for the server to send as usual.
+void HttpResponse::endChunked() {
+  if (!chunkOpen_ || broken_) {
+    return;
+  }
+  if (length_ > chunkStart_) {
+    closeChunk();
+  } else {
+    length_ -= kChunkHeaderSize;
+  }
+  memcpy(buffer_ + length_, "0\r\n\r\n", 5);
+  length_ += 5;
+  chunkOpen_ = false;
+}
+
+// Fills in the fixed-width size reserved in front of the chunk's data.
+void HttpResponse::closeChunk() {
+  char header[kChunkHeaderSize + 1];
+  snprintf(header, sizeof(header), "%04x\r\n", static_cast<unsigned>(length_ - chunkStart_));
+  memcpy(buffer_ + chunkStart_ - kChunkHeaderSize, header, kChunkHeaderSize);
+  memcpy(buffer_ + length_, "\r\n", 2);
+  length_ += 2;
+}
+
+bool HttpResponse::writeHead(int code, const char* contentType, size_t length) {
+  auto append = [this](const char* format, auto... args) {
+    if (length_ >= capacity_) {
+      return;
+    }
+    int written = snprintf(buffer_ + length_, capacity_ - length_, format, args...);
+    length_ = written < 0 ? capacity_ : std::min(capacity_, length_ + static_cast<size_t>(written));
+  };
+
+  status_ = code;
+  append("HTTP/1.1 %d %s\r\n", code, reasonPhrase(code));
+  if (contentType != nullptr) {
+    append("Content-Type: %s\r\n", contentType);
+  }
+  if (chunked_) {
+    append("Transfer-Encoding: chunked\r\n");
+  } else if (code != 204 && code != 304 && !streaming_) {
+    append("Content-Length: %u\r\n", static_cast<unsigned>(length));
+  }
+  append("Connection: %s\r\n", keepAlive_ ? "keep-alive" : "close");
+  append("Access-Control-Allow-Origin: *\r\n"
+         "Access-Control-Allow-Methods: GET,POST,OPTIONS\r\n"
+         "Access-Control-Allow-Headers: Content-Type\r\n");
+  for (uint8_t i = 0; i < headerCount_; ++i) {
+    append("%s: %s\r\n", headerNames_[i], headerValues_[i]);
+  }
+  append("\r\n");
+  return length_ < capacity_;
+}
+
+bool HttpServer::on(HttpMethod method, const char* path, Handler handler, void* context) {
+  if (routeCount_ >= kMaxRoutes || task_ != nullptr) {
+    LOG_ERROR(kLogTagHttp, "Cannot register route %s", path);
+    return false;
+  }
+  routes_[routeCount_++] = {method, path, handler, context};
+  return true;
+}
+
+void HttpServer::onNotFound(Handler handler, void* context) {
+  notFound_ = handler;
+  notFoundContext_ = context;
+}
+
+bool HttpServer::begin(uint16_t port) {
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) {
+    LOG_ERROR(kLogTagHttp, "socket() failed (%d)", errno);
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listenFd_, kListenBacklog) != 0) {
+    LOG_ERROR(kLogTagHttp, "Cannot listen on port %u (%d)", port, errno);
+    close(listenFd_);
+    listenFd_ = -1;
+    return false;
+  }
+  fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+
+  statsSinceMs_ = millis();
+  if (xTaskCreate(&HttpServer::taskEntry, "http", kTaskStackBytes, this, kTaskPriority, &task_) != pdPASS) {
+    LOG_ERROR(kLogTagHttp, "Cannot start server task");
+    close(listenFd_);
+    listenFd_ = -1;
+    task_ = nullptr;
+    return false;
+  }
+  LOG_INFO(kLogTagHttp, "Listening on port %u (%u connections, %u/%u byte buffers)", port, kMaxConnections,
+           static_cast<unsigned>(kRxBufferSize), static_cast<unsigned>(kTxBufferSize));
+  return true;
+}
+
+bool HttpServer::post(void (*job)(void* context), void* context) {
+  if (task_ == nullptr) {
+    return false;
+  }
+  portENTER_CRITICAL(&statsLock_);
+  bool accepted = job_ == nullptr;
+  if (accepted) {
+    jobContext_ = context;
+    job_ = job;
+  }
+  portEXIT_CRITICAL(&statsLock_);
+  return accepted;
+}
+
+void HttpServer::taskEntry(void* arg) {
+  static_cast<HttpServer*>(arg)->run();
+}
+
+void HttpServer::run() {
+  while (true) {
+    fd_set readSet;
+    fd_set writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    int maxFd = -1;
+    uint8_t open = 0;
+
+    for (Connection& conn : connections_) {
+      if (conn.fd < 0) {
+        continue;
+      }
+      ++open;
+      if (conn.streaming && conn.txLength == 0) {
+        pollStream(conn);
+      }
+      bool writing = hasPendingWrite(conn);
+      if (writing) {
+        FD_SET(conn.fd, &writeSet);
+      }
+      if (conn.streaming) {
+        FD_SET(conn.fd, &readSet);  // only to notice the client hanging up
+      } else if (!writing && conn.rxLength < kRxBufferSize) {
+        FD_SET(conn.fd, &readSet);
+      }
+      maxFd = std::max(maxFd, conn.fd);
+    }
+    // With every slot taken, new clients wait in the listen backlog.
+    if (open < kMaxConnections) {
+      FD_SET(listenFd_, &readSet);
+      maxFd = std::max(maxFd, listenFd_);
+    }
+
+    timeval timeout = {0, kSelectTimeoutMs * 1000L};
+    int ready = select(maxFd + 1, &readSet, &writeSet, nullptr, &timeout);
+    if (ready < 0) {
+      LOG_WARN(kLogTagHttp, "select() failed (%d)", errno);
+      vTaskDelay(pdMS_TO_TICKS(kSelectTimeoutMs));
+      continue;
+    }
+
+    if (job_ != nullptr) {
+      portENTER_CRITICAL(&statsLock_);
+      void (*job)(void*) = job_;
+      void* context = jobContext_;
+      job_ = nullptr;
+      portEXIT_CRITICAL(&statsLock_);
+      job(context);
+      continue;  // the job may have taken a while; poll the sockets afresh
+    }
+    if (ready > 0 && FD_ISSET(listenFd_, &readSet)) {
+      acceptClient();
+    }
+    for (Connection& conn : connections_) {
+      if (conn.fd < 0) {
+        continue;
+      }
+      bool wrote = ready > 0 && FD_ISSET(conn.fd, &writeSet);
+      if (wrote) {
+        writeClient(conn);
+      }
+      if (conn.fd < 0) {
+        continue;
+      }
+      if (ready > 0 && FD_ISSET(conn.fd, &readSet)) {
+        readClient(conn);
+      } else if (!wrote && !conn.streaming) {
+        // Read the clock here: handlers run above may have moved lastActivityMs
+        // past a timestamp taken before the loop, and the difference would wrap.
+        int32_t idleMs = static_cast<int32_t>(millis() - conn.lastActivityMs);
+        if (idleMs > static_cast<int32_t>(kIdleTimeoutMs)) {
+          closeClient(conn);
+        }
+      }
+    }
+  }
+}
+
+// Sends a full transmit buffer mid-response. This blocks the server task,
+// but for at most kFlushTimeoutMs per chunk; a client that slow is dropped.
+bool HttpServer::flushChunk(void* context, const char* data, size_t length) {
+  Connection& conn = *static_cast<Connection*>(context);
+  uint32_t startMs = millis();
+  size_t sent = 0;
+  while (sent < length) {
+    int written = send(conn.fd, data + sent, length - sent, 0);
+    if (written > 0) {
+      sent += static_cast<size_t>(written);
+      continue;
+    }
+    if ((written < 0 && errno != EWOULDBLOCK && errno != EAGAIN) || millis() - startMs > kFlushTimeoutMs) {
+      return false;
+    }
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(conn.fd, &writeSet);
+    timeval timeout = {0, kSelectTimeoutMs * 1000L};
+    select(conn.fd + 1, nullptr, &writeSet, nullptr, &timeout);
+  }
+  conn.heapLow = std::min(conn.heapLow, ESP.getFreeHeap());
+  conn.lastActivityMs = millis();
+  return true;
+}
+
+void HttpServer::acceptClient() {
+  sockaddr_in peer = {};
+  socklen_t peerLength = sizeof(peer);
+  int fd = accept(listenFd_, reinterpret_cast<sockaddr*>(&peer), &peerLength);
+  if (fd < 0) {
+    return;
+  }
+  for (Connection& conn : connections_) {
+    if (conn.fd >= 0) {
+      continue;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    conn.fd = fd;
+    conn.rxLength = 0;
+    conn.txLength = 0;
+    conn.txSent = 0;
+    conn.staticLength = 0;
+    conn.staticSent = 0;
+    conn.closeAfterSend = false;
+    conn.requestStarted = false;
+    conn.headLength = 0;
+    conn.contentLength = 0;
+    conn.streaming = false;
+    conn.lastActivityMs = millis();
+    portENTER_CRITICAL(&statsLock_);
+    ++stats_.openConnections;
+    stats_.peakConnections = std::max(stats_.peakConnections, stats_.openConnections);
+    portEXIT_CRITICAL(&statsLock_);
+    return;
+  }
+  close(fd);
+  recordRejected();
+}
+
+void HttpServer::readClient(Connection& conn) {
+  if (conn.streaming) {
+    conn.rxLength = 0;  // nothing more is parsed; leave room to notice the hang-up
+  } else if (conn.rxLength >= kRxBufferSize) {
+    // recv() into a full buffer returns 0, which reads as the peer closing.
+    if (hasPendingWrite(conn)) {
+      return;
+    }
+    if (conn.headLength > 0) {
+      reject(conn, 413, "{\"error\":\"Body too large\"}");
+    } else {
+      reject(conn, 431, "{\"error\":\"Request head too large\"}");
+    }
+    return;
+  }
+  int received = recv(conn.fd, conn.rx + conn.rxLength, kRxBufferSize - conn.rxLength, 0);
+  if (received <= 0) {
+    if (received < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+      return;
+    }
+    closeClient(conn);
+    return;
+  }
+  if (conn.streaming) {
+    return;  // a stream has no further requests; ignore whatever arrives
+  }
+  if (!conn.requestStarted) {
+    conn.requestStarted = true;
+    conn.requestStartUs = micros();
+  }
+  conn.rxLength += static_cast<size_t>(received);
+  conn.lastActivityMs = millis();
+  processRequests(conn);
+}
+
+bool HttpServer::hasPendingWrite(const Connection& conn) {
+  return conn.txSent < conn.txLength || conn.staticSent < conn.staticLength;
+}
+
+void HttpServer::writeClient(Connection& conn) {
+  bool head = conn.txSent < conn.txLength;
+  const char* data = head ? conn.tx + conn.txSent : conn.staticBody + conn.staticSent;
+  size_t length = head ? conn.txLength - conn.txSent : conn.staticLength - conn.staticSent;
+  int written = send(conn.fd, data, length, 0);
+  if (written < 0) {
+    if (errno == EWOULDBLOCK || errno == EAGAIN) {
+      return;
+    }
+    closeClient(conn);
+    return;
+  }
+  (head ? conn.txSent : conn.staticSent) += static_cast<size_t>(written);
+  conn.lastActivityMs = millis();
+  if (hasPendingWrite(conn)) {
+    return;
+  }
+  if (conn.streaming) {
+    portENTER_CRITICAL(&statsLock_);
+    stats_.bytesSent += conn.txLength;
+    portEXIT_CRITICAL(&statsLock_);
+    conn.txLength = 0;
+    conn.txSent = 0;
+    return;
+  }
+
+  recordRequest(micros() - conn.requestStartUs, conn.txLength + conn.staticLength);
+  conn.txLength = 0;
+  conn.txSent = 0;
+  conn.staticBody = nullptr;
+  conn.staticLength = 0;
+  conn.staticSent = 0;
+  if (conn.closeAfterSend) {
+    closeClient(conn);
+    return;
+  }
+  // A pipelined request may already be waiting.
+  conn.requestStarted = conn.rxLength > 0;
+  conn.requestStartUs = micros();
+  processRequests(conn);
+}
+
+void HttpServer::closeClient(Connection& conn) {
+  if (conn.streaming && conn.stream.close != nullptr) {
+    conn.stream.close(conn.stream.context, conn.stream.id);
+  }
+  conn.streaming = false;
+  close(conn.fd);
+  conn.fd = -1;
+  conn.rxLength = 0;
+  conn.txLength = 0;
+  conn.txSent = 0;
+  conn.staticLength = 0;
+  conn.staticSent = 0;
+  conn.headLength = 0;
+  portENTER_CRITICAL(&statsLock_);
+  --stats_.openConnections;
+  portEXIT_CRITICAL(&statsLock_);
+}
+
+// Parses and answers the next complete request in rx, if there is one. Only
+// one response is in flight per connection; the rest waits in rx.
+void HttpServer::processRequests(Connection& conn) {
+  if (conn.txLength > 0) {
+    return;
+  }
+  if (conn.headLength == 0 && !parseHead(conn)) {
+    return;
+  }
+  if (conn.contentLength > kRxBufferSize - conn.headLength) {
+    reject(conn, 413, "{\"error\":\"Body too large\"}");
+    return;
+  }
+  if (conn.rxLength < conn.headLength + conn.contentLength) {
+    return;  // the body is still arriving
+  }
+  conn.request.body = conn.rx + conn.headLength;
+  conn.request.bodyLength = conn.contentLength;
+
+  HttpResponse response(conn.tx, kTxBufferSize, conn.request.keepAlive);
+  if (conn.request.http11) {
+    response.setFlush(&HttpServer::flushChunk, &conn);
+  }
+  uint32_t heapBefore = ESP.getFreeHeap();
+  conn.heapLow = heapBefore;
+  const char* route = dispatch(conn.request, response);
+  response.endChunked();
+  conn.heapLow = std::min(conn.heapLow, ESP.getFreeHeap());
+  recordResponse(heapBefore - conn.heapLow, response.chunked(), response.flushedBytes());
+  if (response.broken()) {
+    LOG_WARN(kLogTagHttp, "Client stalled during a chunked response, closing");
+    recordRejected();
+    closeClient(conn);
+    return;
+  }
+  if (!response.sent()) {
+    response.send(500, "application/json", "{\"error\":\"No response\"}");
+  }
+  httpResponses.inc(route, response.status());
+  conn.txLength = response.length();
+  conn.staticBody = response.staticBody();
+  conn.staticLength = response.staticLength();
+  conn.staticSent = 0;
+  conn.closeAfterSend = !response.keepAlive();
+  if (response.streaming()) {
+    // The head counts as the request. Its bytes, like the stream's, are
+    // tallied by writeClient() once they are sent.
+    recordRequest(micros() - conn.requestStartUs, 0);
+    conn.streaming = true;
+    conn.stream = response.stream();
+    conn.closeAfterSend = false;
+  }
+
+  size_t consumed = conn.headLength + conn.contentLength;
+  memmove(conn.rx, conn.rx + consumed, conn.rxLength - consumed);
+  conn.rxLength -= consumed;
+  conn.headLength = 0;
+  conn.contentLength = 0;
+}
+
+// Refills tx from the stream; the head written by beginStream goes first.
+void HttpServer::pollStream(Connection& conn) {
+  size_t length = conn.stream.poll(conn.stream.context, conn.stream.id, conn.tx, kTxBufferSize);
+  conn.txLength = std::min(length, kTxBufferSize);
+  conn.txSent = 0;
+}
+
+// Parses the request head in place once it is complete; false until then.
+bool HttpServer::parseHead(Connection& conn) {
+  size_t headLength = findHeadEnd(conn.rx, conn.rxLength);
+  if (headLength == 0) {
+    if (conn.rxLength >= kRxBufferSize) {
+      reject(conn, 431, "{\"error\":\"Request head too large\"}");
+    }
+    return false;
+  }
+
+  // Terminate every head line so the tokens can point into rx.
+  for (size_t i = 0; i + 1 < headLength; ++i) {
+    if (conn.rx[i] == '\r' && conn.rx[i + 1] == '\n') {
+      conn.rx[i] = '\0';
+    }
+  }
+
+  HttpRequest& request = conn.request;
+  request = HttpRequest();
+  char* cursor = conn.rx;
+  char* line = cursor;
+  cursor += strlen(line) + 2;
+  request.method = parseMethod(nextToken(&line, ' '));
+  char* target = nextToken(&line, ' ');
+  request.http11 = strcmp(line, "HTTP/1.1") == 0;
+  request.keepAlive = request.http11;
+  char* query = strchr(target, '?');
+  if (query != nullptr) {
+    *query = '\0';
+    request.query = query + 1;
+  }
+  request.path = target;
+
+  size_t contentLength = 0;
+  while (cursor < conn.rx + headLength - 2 && *cursor != '\0') {
+    char* value = cursor;
+    cursor += strlen(cursor) + 2;
+    char* name = nextToken(&value, ':');
+    while (*value == ' ') {
+      ++value;
+    }
+    if (strcasecmp(name, "Content-Length") == 0) {
+      contentLength = strtoul(value, nullptr, 10);
+    } else if (strcasecmp(name, "If-None-Match") == 0) {
+      request.ifNoneMatch = value;
+    } else if (strcasecmp(name, "Accept-Encoding") == 0) {
+      request.acceptsGzip = allowsGzip(value);
+    } else if (strcasecmp(name, "Connection") == 0) {
+      if (strcasecmp(value, "close") == 0) {
+        request.keepAlive = false;
+      } else if (strcasecmp(value, "keep-alive") == 0) {
+        request.keepAlive = true;
+      }
+    }
+  }
+  conn.headLength = headLength;
+  conn.contentLength = contentLength;
+  return true;
+}
+
+// Answers with an error and drops whatever else the client sent.
+void HttpServer::reject(Connection& conn, int code, const char* body) {
+  HttpResponse response(conn.tx, kTxBufferSize, false);
+  response.send(code, "application/json", body);
+  conn.txLength = response.length();
+  conn.closeAfterSend = true;
+  conn.rxLength = 0;
+  conn.headLength = 0;
+  conn.contentLength = 0;
+  httpResponses.inc("rejected", code);
+  recordRejected();
+}
+
+const char* HttpServer::dispatch(const HttpRequest& request, HttpResponse& response) {
+  for (uint8_t i = 0; i < routeCount_; ++i) {
+    const Route& route = routes_[i];
+    if (route.method == request.method && strcmp(route.path, request.path) == 0) {
+      route.handler(route.context, request, response);
+      return route.path;
+    }
+  }
+  if (notFound_ != nullptr) {
+    notFound_(notFoundContext_, request, response);
+  } else {
+    response.send(404, "application/json", "{\"error\":\"Not found\"}");
+  }
+  return "unmatched";
+}
+
+void HttpServer::recordRequest(uint32_t latencyUs, size_t bytes) {
+  portENTER_CRITICAL(&statsLock_);
+  ++stats_.requests;
+  stats_.bytesSent += bytes;
+  stats_.latencyMaxUs = std::max(stats_.latencyMaxUs, latencyUs);
+  latencies_[latencyNext_] = latencyUs;
+  latencyNext_ = static_cast<uint8_t>((latencyNext_ + 1) % kLatencySamples);
+  if (latencyCount_ < kLatencySamples) {
+    ++latencyCount_;
+  }
+  portEXIT_CRITICAL(&statsLock_);
+}
+
+// Heap is sampled around the handler and at each chunk flush, so the peak
+// covers what the response itself holds while it is written. Free heap is
+// global, so whatever other tasks allocate in that window is included too.
+void HttpServer::recordResponse(uint32_t heapPeakBytes, bool chunked, size_t flushedBytes) {
+  portENTER_CRITICAL(&statsLock_);
+  stats_.heapLastPeakBytes = heapPeakBytes;
+  stats_.heapPeakBytes = std::max(stats_.heapPeakBytes, heapPeakBytes);
+  stats_.bytesSent += flushedBytes;
+  if (chunked) {
+    ++stats_.chunkedResponses;
+  }
+  portEXIT_CRITICAL(&statsLock_);
+}
+
+void HttpServer::recordRejected() {
+  portENTER_CRITICAL(&statsLock_);
+  ++stats_.rejected;
+  portEXIT_CRITICAL(&statsLock_);
+}
+
+// Percentiles cover the last kLatencySamples requests.
+HttpStats HttpServer::stats() const {
+  uint32_t samples[kLatencySamples];
+  portENTER_CRITICAL(&statsLock_);
+  HttpStats result = stats_;
+  uint8_t count = latencyCount_;
+  memcpy(samples, latencies_, sizeof(samples));
+  portEXIT_CRITICAL(&statsLock_);
+
+  result.windowMs = millis() - statsSinceMs_;
+  result.stackFreeMinBytes = task_ != nullptr ? uxTaskGetStackHighWaterMark(task_) : 0;
+  if (count > 0) {
+    std::sort(samples, samples + count);
+    result.latencyP50Us = samples[(count - 1) / 2];
+    result.latencyP99Us = samples[(count * 99 - 1) / 100];
+  }
+  return result;
+}
+
+void HttpServer::resetStats() {
+  portENTER_CRITICAL(&statsLock_);
+  uint8_t open = stats_.openConnections;
+  stats_ = HttpStats();
+  stats_.openConnections = open;
+  stats_.peakConnections = open;
+  latencyCount_ = 0;
+  latencyNext_ = 0;
+  statsSinceMs_ = millis();
+  portEXIT_CRITICAL(&statsLock_);
+}
+
+}  // namespace web
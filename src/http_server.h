@@ -0,0 +1,248 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace web {
+
+enum class HttpMethod : uint8_t { Get, Post, Options, Other };
+
+// Points into the connection's receive buffer; valid only inside the handler.
+struct HttpRequest {
+  HttpMethod method = HttpMethod::Other;
+  const char* path = "";
+  const char* query = "";
+  const char* body = nullptr;
+  size_t bodyLength = 0;
+  const char* ifNoneMatch = nullptr;  // If-None-Match header, if sent
+  bool acceptsGzip = false;  // Accept-Encoding allows gzip
+  bool keepAlive = true;
+  bool http11 = false;  // the client understands chunked bodies
+};
+
+// Source of an open-ended response body (server-sent events). The server
+// calls poll whenever the connection's transmit buffer is empty and close
+// once the client goes away. Both run on the server task.
+struct HttpStream {
+  size_t (*poll)(void* context, uint8_t id, char* buffer, size_t capacity) = nullptr;
+  void (*close)(void* context, uint8_t id) = nullptr;
+  void* context = nullptr;
+  uint8_t id = 0;
+};
+
+// Writes one complete response into the connection's fixed transmit buffer.
+// A response that does not fit is replaced by a 500, unless it is written as
+// a chunked body, which is flushed to the socket each time the buffer fills.
+class HttpResponse {
+ public:
+  // Sends buffered bytes while a chunked body is being written.
+  using FlushFn = bool (*)(void* context, const char* data, size_t length);
+
+  HttpResponse(char* buffer, size_t capacity, bool keepAlive)
+      : buffer_(buffer), capacity_(capacity), keepAlive_(keepAlive) {}
+
+  // Set by the server for clients that accept Transfer-Encoding: chunked.
+  void setFlush(FlushFn flush, void* context) {
+    flush_ = flush;
+    flushContext_ = context;
+  }
+
+  // The value must stay valid until the response is sent; up to kMaxHeaders.
+  void addHeader(const char* name, const char* value);
+  void send(int code, const char* contentType, const char* body, size_t length);
+  void send(int code, const char* contentType = nullptr, const char* body = "");
+  // Writes the head for a body of exactly length bytes and returns where the
+  // body goes (length + 1 bytes are writable); nullptr if it cannot fit.
+  char* beginBody(int code, const char* contentType, size_t length);
+  // Sends a body that lives for the whole program (a flash constant) from
+  // where it is, after the head; nothing is copied into the buffer.
+  void sendStatic(int code, const char* contentType, const void* body, size_t length);
+  // Writes a 200 head without Content-Length and hands the connection to
+  // stream until the client disconnects.
+  void beginStream(const char* contentType, const HttpStream& stream);
+  // A body of unknown length, written with write() and finished by
+  // endChunked(). False when the client cannot take chunked bodies.
+  bool beginChunked(int code, const char* contentType);
+  size_t write(const char* data, size_t length);
+  void endChunked();
+
+  bool sent() const { return sent_; }
+  int status() const { return status_; }
+  const char* staticBody() const { return staticBody_; }
+  size_t staticLength() const { return staticLength_; }
+  bool streaming() const { return streaming_; }
+  bool chunked() const { return chunked_; }
+  // A chunked body whose flush failed; the connection must be dropped.
+  bool broken() const { return broken_; }
+  size_t flushedBytes() const { return flushed_; }
+  const HttpStream& stream() const { return stream_; }
+  size_t length() const { return length_; }
+  bool keepAlive() const { return keepAlive_; }
+  void setKeepAlive(bool keepAlive) { keepAlive_ = keepAlive; }
+
+ private:
+  static constexpr uint8_t kMaxHeaders = 4;
+  static constexpr size_t kChunkHeaderSize = 6;  // "%04x\r\n"
+  static constexpr size_t kChunkReserve = 7;     // "\r\n" closing a chunk + "0\r\n\r\n"
+
+  bool writeHead(int code, const char* contentType, size_t length);
+  void closeChunk();
+
+  char* buffer_;
+  size_t capacity_;
+  bool keepAlive_;
+  size_t length_ = 0;
+  int status_ = 0;
+  bool sent_ = false;
+  const char* staticBody_ = nullptr;
+  size_t staticLength_ = 0;
+  bool streaming_ = false;
+  HttpStream stream_;
+  bool chunked_ = false;
+  bool chunkOpen_ = false;
+  bool broken_ = false;
+  size_t chunkStart_ = 0;  // first data byte of the open chunk
+  size_t flushed_ = 0;
+  FlushFn flush_ = nullptr;
+  void* flushContext_ = nullptr;
+  const char* headerNames_[kMaxHeaders] = {};
+  const char* headerValues_[kMaxHeaders] = {};
+  uint8_t headerCount_ = 0;
+};
+
+struct HttpStats {
+  uint32_t requests = 0;
+  uint32_t rejected = 0;         // malformed, oversized or out of connections
+  uint32_t bytesSent = 0;
+  uint32_t windowMs = 0;         // since the last reset
+  uint32_t latencyP50Us = 0;     // first request byte -> last response byte
+  uint32_t latencyP99Us = 0;
+  uint32_t latencyMaxUs = 0;
+  uint8_t openConnections = 0;
+  uint8_t peakConnections = 0;
+  uint32_t chunkedResponses = 0;
+  // Largest drop in free heap seen while serving one request. Approximate:
+  // it is the whole heap, so other tasks allocating meanwhile count too.
+  uint32_t heapPeakBytes = 0;
+  uint32_t heapLastPeakBytes = 0;  // the same for the most recent request
+  uint32_t stackFreeMinBytes = 0;  // server task stack headroom, lowest since boot
+};
+
+// Print adapter for chunked bodies, so serializeJson() can write straight
+// into the response: HttpResponsePrint out(response); serializeJson(doc, out);
+class HttpResponsePrint : public Print {
+ public:
+  explicit HttpResponsePrint(HttpResponse& response) : response_(response) {}
+
+  size_t write(uint8_t c) override { return response_.write(reinterpret_cast<const char*>(&c), 1); }
+  size_t write(const uint8_t* data, size_t length) override {
+    return response_.write(reinterpret_cast<const char*>(data), length);
+  }
+
+ private:
+  HttpResponse& response_;
+};
+
+// Small HTTP/1.1 server on lwIP sockets, run by its own task. One select()
+// loop multiplexes up to kMaxConnections keep-alive clients, each with fixed
+// receive and transmit buffers, so a slow client never holds up another one
+// or the UI loop. Handlers run on the server task.
+class HttpServer {
+ public:
+  using Handler = void (*)(void* context, const HttpRequest& request, HttpResponse& response);
+
+  static constexpr uint8_t kMaxConnections = 4;
+  static constexpr size_t kRxBufferSize = 1024;
+  static constexpr size_t kTxBufferSize = 2048;
+
+  // Routes must be registered before begin().
+  bool on(HttpMethod method, const char* path, Handler handler, void* context);
+  void onNotFound(Handler handler, void* context);
+  bool begin(uint16_t port);
+
+  HttpStats stats() const;
+  void resetStats();
+
+  // Runs the handler for request as if it had arrived, bypassing sockets and
+  // stats; for in-process load tests. Call on the server task (see post()).
+  const char* handle(const HttpRequest& request, HttpResponse& response) { return dispatch(request, response); }
+  // Runs job once on the server task, between select() rounds; false while
+  // another job is pending.
+  bool post(void (*job)(void* context), void* context);
+
+ private:
+  struct Route {
+    HttpMethod method;
+    const char* path;
+    Handler handler;
+    void* context;
+  };
+
+  struct Connection {
+    int fd = -1;
+    char rx[kRxBufferSize];
+    size_t rxLength = 0;
+    char tx[kTxBufferSize];
+    size_t txLength = 0;
+    size_t txSent = 0;
+    const char* staticBody = nullptr;  // sent after tx, see sendStatic()
+    size_t staticLength = 0;
+    size_t staticSent = 0;
+    bool closeAfterSend = false;
+    uint32_t lastActivityMs = 0;
+    uint32_t requestStartUs = 0;  // first byte of the request being served
+    bool requestStarted = false;
+    // Set once the head is parsed (in place) while the body is still arriving.
+    size_t headLength = 0;
+    size_t contentLength = 0;
+    HttpRequest request;
+    bool streaming = false;  // no more requests; tx is refilled from stream
+    HttpStream stream;
+    uint32_t heapLow = 0;  // lowest free heap seen while serving the request
+  };
+
+  static constexpr uint8_t kMaxRoutes = 20;
+  static constexpr uint16_t kSelectTimeoutMs = 100;
+  static constexpr uint16_t kIdleTimeoutMs = 5000;
+  static constexpr uint8_t kLatencySamples = 128;
+  static constexpr uint16_t kFlushTimeoutMs = 1000;
+
+  static void taskEntry(void* arg);
+  static bool flushChunk(void* context, const char* data, size_t length);
+  void run();
+  void acceptClient();
+  void readClient(Connection& conn);
+  void writeClient(Connection& conn);
+  static bool hasPendingWrite(const Connection& conn);
+  void closeClient(Connection& conn);
+  void processRequests(Connection& conn);
+  void pollStream(Connection& conn);
+  bool parseHead(Connection& conn);
+  void reject(Connection& conn, int code, const char* body);
+  // Returns the matched route's path, for metrics.
+  const char* dispatch(const HttpRequest& request, HttpResponse& response);
+  void recordRequest(uint32_t latencyUs, size_t bytes);
+  void recordResponse(uint32_t heapPeakBytes, bool chunked, size_t flushedBytes);
+  void recordRejected();
+
+  Route routes_[kMaxRoutes] = {};
+  uint8_t routeCount_ = 0;
+  Handler notFound_ = nullptr;
+  void* notFoundContext_ = nullptr;
+
+  int listenFd_ = -1;
+  TaskHandle_t task_ = nullptr;
+  void (*job_)(void* context) = nullptr;
+  void* jobContext_ = nullptr;
+  Connection connections_[kMaxConnections];
+
+  mutable portMUX_TYPE statsLock_ = portMUX_INITIALIZER_UNLOCKED;
+  HttpStats stats_;
+  uint32_t statsSinceMs_ = 0;
+  uint32_t latencies_[kLatencySamples] = {};
+  uint8_t latencyCount_ = 0;
+  uint8_t latencyNext_ = 0;
+};
+
+}  // namespace web
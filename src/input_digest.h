@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cmath>
+
+namespace display {
+
+// FNV-1a digest used to detect whether the values a page draws have changed.
+class InputDigest {
+ public:
+  void add(uint32_t value) {
+    for (uint8_t i = 0; i < 4; ++i) {
+      mix(static_cast<uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  void add(const char* text) {
+    if (text == nullptr) {
+      add(0xFFFFFFFFUL);
+      return;
+    }
+    while (*text != '\0') {
+      mix(static_cast<uint8_t>(*text++));
+    }
+    mix(0);
+  }
+
+  void add(const String& text) { add(text.c_str()); }
+
+  // Quantizes to the precision the page prints so invisible jitter is ignored.
+  void add(float value, float scale) {
+    if (std::isnan(value)) {
+      add(0x7FC00000UL);
+      return;
+    }
+    add(static_cast<uint32_t>(static_cast<int32_t>(std::lround(value * scale))));
+  }
+
+  uint32_t value() const { return hash_; }
+
+ private:
+  void mix(uint8_t byte) {
+    hash_ ^= byte;
+    hash_ *= 16777619UL;
+  }
+
+  uint32_t hash_ = 2166136261UL;
+};
+
+}  // namespace display
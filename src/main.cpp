@@ -1,15 +1,22 @@
 #include <Arduino.h>
 #include <Wire.h>
+#include <algorithm>
 #include <cstdio>
 #include <esp_random.h>
 
 #include "ai_client.h"
 #include "audio_engine.h"
+#include "button_gestures.h"
 #include "buttons.h"
 #include "display_manager.h"
+#include "display_snapshot.h"
 #include "expression_logic.h"
+#include "face_animator.h"
 #include "hardware_config.h"
+#include "melody_dsl.h"
 #include "menu_controller.h"
+#include "metrics.h"
+#include "mood_glow.h"
 #include "network_manager.h"
 #include "plant_profile.h"
 #include "sensors.h"
@@ -18,7 +25,6 @@
 
 namespace {
 constexpr uint32_t kSensorIntervalMs = 1500;
-constexpr uint32_t kDisplayIntervalMs = 100;
 
 constexpr display::PageId kScreenOrder[] = {
     display::PageId::Mood, display::PageId::Info, display::PageId::Debug};
@@ -30,9 +36,11 @@ constexpr uint8_t kPresetCount = sizeof(kPresetSpecies) / sizeof(kPresetSpecies[
 
 sensing::SensorSuite sensors;
 audio::AudioEngine audioEngine;
-display::DisplayManager displayManager;
+U8G2_SH1106_128X64_NONAME_F_HW_I2C oledPanel(U8G2_R0, /* reset=*/U8X8_PIN_NONE, hw::PIN_I2C_SCL, hw::PIN_I2C_SDA);
+display::DisplayManager displayManager(oledPanel);
 input::ButtonInput buttons(hw::PIN_BUTTON_LEFT, hw::PIN_BUTTON_RIGHT, /*activeLow=*/true,
                            hw::BUTTON_DEBOUNCE_MS, hw::BUTTON_LONG_PRESS_MS);
+input::GestureRecognizer gestures(buttons);
 brain::ExpressionLogic expressionLogic;
 ui::MenuController menuController;
 plant::PlantProfileManager profileManager;
@@ -44,12 +52,47 @@ brain::MoodResult currentMood;
 uint32_t lastSensorSampleMs = 0;
 uint32_t lastDisplayUpdateMs = 0;
 
-bool blinkActive = false;
-uint32_t blinkStartMs = 0;
-uint32_t nextBlinkAtMs = 0;
-constexpr uint32_t kAmbientResumeDelayMs = 6000;
-uint32_t ambientResumeAtMs = 0;
-uint32_t lastInteractionMs = 0;
+anim::FaceAnimator faceAnimator;
+display::DisplayPowerPolicy displayPower;
+glow::MoodGlow moodGlow;
+glow::GlowPattern glowOverride = {};
+// Coalescing keys for queued sounds: repeats of the same cue merge.
+constexpr uint8_t kSoundClick = 1;
+constexpr uint8_t kSoundCalibration = 2;
+constexpr uint8_t kSoundProfileLoaded = 3;
+constexpr uint8_t kSoundDemo = 4;
+constexpr uint8_t kSoundHydration = 5;
+constexpr uint8_t kSoundCelebration = 6;
+
+// Stall added to every loop() pass while an audio trace runs (audio:trace:<sound>:<ms>).
+constexpr uint32_t kMaxTraceLoadMs = 250;
+uint32_t traceLoadMs = 0;
+
+// loop() passes and the slowest one while a web:bench run is under way.
+bool benchActive = false;
+uint32_t benchLoopPasses = 0;
+uint32_t benchLoopMaxUs = 0;
+
+// Served at /metrics and printed by the "metrics" serial command.
+metrics::Counter framesRendered("plantey_display_frames_total", "Frames drawn and sent to the OLED",
+                                [] { return static_cast<uint64_t>(displayManager.renderStats().framesRendered); });
+metrics::Counter framesSkipped("plantey_display_frames_skipped_total", "Frames skipped because nothing on them changed",
+                               [] { return static_cast<uint64_t>(displayManager.renderStats().framesSkipped); });
+metrics::Counter i2cBytes("plantey_i2c_bytes_total", "Bytes written to the OLED over I2C");
+metrics::Counter fetchAttempts("plantey_profile_fetch_attempts_total", "Plant profile fetches started");
+metrics::Counter fetchFailures("plantey_profile_fetch_failures_total", "Plant profile fetches that failed");
+constexpr uint32_t kLoopBucketsUs[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000, 500000};
+metrics::Histogram<8> loopDuration("plantey_loop_duration_us", "Duration of one loop() pass", kLoopBucketsUs);
+
+// The OLED's own I2C byte callback; countOledBytes() sits in front of it.
+u8x8_msg_cb oledByteCallback = nullptr;
+
+uint8_t countOledBytes(u8x8_t* u8x8, uint8_t msg, uint8_t argInt, void* argPtr) {
+  if (msg == U8X8_MSG_BYTE_SEND) {
+    i2cBytes.inc(argInt);
+  }
+  return oledByteCallback(u8x8, msg, argInt, argPtr);
+}
 
 uint16_t soilDryCalibration = hw::SOIL_RAW_DRY_DEFAULT;
 uint16_t soilWetCalibration = hw::SOIL_RAW_WET_DEFAULT;
@@ -67,22 +110,46 @@ bool profileFetchInProgress = false;
 display::SystemStatusView statusView;
 constexpr const char* kLogTagMain = "main";
 
-void scheduleNextBlink(uint32_t nowMs) {
-  uint32_t window = hw::BLINK_INTERVAL_MAX_MS - hw::BLINK_INTERVAL_MIN_MS;
-  nextBlinkAtMs = nowMs + hw::BLINK_INTERVAL_MIN_MS + random(window);
+// Wakes the display for the next loop pass. Returns true if it was idling.
+bool wakeDisplay(uint32_t nowMs) {
+  if (!displayPower.wake(nowMs)) {
+    return false;
+  }
+  displayManager.applyPowerState(displayPower.state());
+  lastDisplayUpdateMs = 0;
+  return true;
 }
 
-bool updateBlink(uint32_t nowMs) {
-  if (blinkActive) {
-    if (nowMs - blinkStartMs >= hw::BLINK_DURATION_MS) {
-      blinkActive = false;
-      scheduleNextBlink(nowMs);
-    }
-  } else if (nowMs >= nextBlinkAtMs) {
-    blinkActive = true;
-    blinkStartMs = nowMs;
+// The press that wakes an idle display belongs to the wake, not the menu: its
+// first gesture and, for a hold, the repeats up to its HoldEnd. A hold that
+// the recognizer reports right behind the waking click (click, then hold) is
+// the same press.
+struct WakePress {
+  bool holding = false;
+  bool justWoke = false;
+  input::ButtonId id = input::ButtonId::Left;
+  uint32_t atUs = 0;
+};
+WakePress wakePress;
+
+// True if evt woke the display or is part of the press that did.
+bool consumeWakeGesture(const input::GestureEvent& evt, uint32_t nowMs) {
+  bool sameId = evt.id == wakePress.id;
+  bool holdBehindClick = wakePress.justWoke && sameId && evt.atUs == wakePress.atUs &&
+                         evt.gesture == input::Gesture::HoldStart;
+  wakePress.justWoke = false;
+  if ((wakePress.holding && sameId) || holdBehindClick) {
+    wakePress.holding = evt.gesture != input::Gesture::HoldEnd;
+    return true;
   }
-  return blinkActive;
+  if (evt.gesture == input::Gesture::HoldEnd || !wakeDisplay(nowMs)) {
+    return false;
+  }
+  wakePress.justWoke = true;
+  wakePress.id = evt.id;
+  wakePress.atUs = evt.atUs;
+  wakePress.holding = evt.gesture == input::Gesture::HoldStart || evt.gesture == input::Gesture::HoldRepeat;
+  return true;
 }
 
 void applyCalibration(ui::CalibrationTarget target) {
@@ -91,30 +158,36 @@ void applyCalibration(ui::CalibrationTarget target) {
       soilDryCalibration = lastReadings.soilRaw;
       sensors.setSoilCalibration(soilDryCalibration, soilWetCalibration);
       Serial.printf("[cal] Soil dry raw=%u\n", soilDryCalibration);
-      audioEngine.playTone(523.3f, 220);
+      audioEngine.submit(
+          audio::SoundRequest::tone(audio::note::C5, 220, audio::SoundPriority::Feedback, kSoundCalibration));
       break;
     case ui::CalibrationTarget::SoilWet:
       soilWetCalibration = lastReadings.soilRaw;
       sensors.setSoilCalibration(soilDryCalibration, soilWetCalibration);
       Serial.printf("[cal] Soil wet raw=%u\n", soilWetCalibration);
-      audioEngine.playTone(659.3f, 220);
+      audioEngine.submit(
+          audio::SoundRequest::tone(audio::note::E5, 220, audio::SoundPriority::Feedback, kSoundCalibration));
       break;
     case ui::CalibrationTarget::LightDark:
       lightDarkCalibration = lastReadings.lightRaw;
       sensors.setLightCalibration(lightDarkCalibration, lightBrightCalibration);
       Serial.printf("[cal] Light dark raw=%u\n", lightDarkCalibration);
-      audioEngine.playTone(392.0f, 180);
+      audioEngine.submit(
+          audio::SoundRequest::tone(audio::note::G4, 180, audio::SoundPriority::Feedback, kSoundCalibration));
       break;
     case ui::CalibrationTarget::LightBright:
       lightBrightCalibration = lastReadings.lightRaw;
       sensors.setLightCalibration(lightDarkCalibration, lightBrightCalibration);
       Serial.printf("[cal] Light bright raw=%u\n", lightBrightCalibration);
-      audioEngine.playTone(784.0f, 180);
+      audioEngine.submit(
+          audio::SoundRequest::tone(audio::note::G5, 180, audio::SoundPriority::Feedback, kSoundCalibration));
       break;
     case ui::CalibrationTarget::None:
     default:
-      break;
+      return;
   }
+  bool soil = target == ui::CalibrationTarget::SoilDry || target == ui::CalibrationTarget::SoilWet;
+  web::service.publishCalibration(target, soil ? lastReadings.soilRaw : lastReadings.lightRaw);
 }
 
 void updateSpeciesQuery(const String& query, bool announce) {
@@ -181,6 +254,152 @@ void processSerialLine(String line) {
     LOG_WARN(kLogTagMain, "Profile cleared via serial command");
   } else if (line.equalsIgnoreCase("wifi:status")) {
     Serial.printf("[serial] WiFi status: %s\n", wifiStatusText.c_str());
+  } else if (line.equalsIgnoreCase("display:pbm")) {
+    display::dumpSnapshots(kScreenCount, Serial);
+  } else if (line.equalsIgnoreCase("display:bench")) {
+    display::benchmarkSnapshots(kScreenCount, 20, Serial);
+  } else if (line.equalsIgnoreCase("display:stats")) {
+    const display::RenderStats& stats = displayManager.renderStats();
+    uint32_t total = stats.framesRendered + stats.framesSkipped;
+    Serial.printf("[serial] Display rendered=%lu skipped=%lu (%lu%% skipped) chrome builds=%lu face=%lu cycles/frame\n",
+                  static_cast<unsigned long>(stats.framesRendered), static_cast<unsigned long>(stats.framesSkipped),
+                  static_cast<unsigned long>(total > 0 ? (stats.framesSkipped * 100UL) / total : 0),
+                  static_cast<unsigned long>(stats.chromeBuilds),
+                  static_cast<unsigned long>(displayManager.averageFaceCycles()));
+  } else if (line.equalsIgnoreCase("audio:timing")) {
+    audio::SequencerStats stats = audioEngine.timingStats();
+    Serial.printf("[serial] Audio sequencer=%s steps=%lu late max=%lu us mean=%lu us\n",
+                  stats.hardwareTimer ? "esp_timer" : "loop", static_cast<unsigned long>(stats.events),
+                  static_cast<unsigned long>(stats.maxLatenessUs), static_cast<unsigned long>(stats.meanLatenessUs));
+    audioEngine.resetTimingStats();
+#if PLANTEY_AUDIO_SYNTH
+    audio::SynthLoadStats load = audioEngine.synthLoad();
+    for (uint8_t voices = 0; voices < audio::SynthLoadStats::kBuckets; ++voices) {
+      Serial.printf("[serial]   synth %u voices: %6lu cycles/sample over %lu samples\n", voices,
+                    static_cast<unsigned long>(load.meanCycles[voices]), static_cast<unsigned long>(load.samples[voices]));
+    }
+    Serial.printf("[serial]   synth cost per voice: %lu cycles/sample\n", static_cast<unsigned long>(load.cyclesPerVoice));
+#endif
+  } else if (line.equalsIgnoreCase("audio:queue")) {
+    const audio::SoundQueueStats& stats = audioEngine.queueStats();
+    Serial.printf("[serial] Audio queue submitted=%lu merged=%lu expired=%lu dropped=%lu evicted=%lu preempted=%lu\n",
+                  static_cast<unsigned long>(stats.submitted), static_cast<unsigned long>(stats.merged),
+                  static_cast<unsigned long>(stats.expired), static_cast<unsigned long>(stats.dropped),
+                  static_cast<unsigned long>(stats.evicted), static_cast<unsigned long>(stats.preempted));
+  } else if (line.startsWith("audio:trace:")) {
+    line.remove(0, 12);
+    int split = line.indexOf(':');
+    String target = split >= 0 ? line.substring(0, split) : line;
+    traceLoadMs = split >= 0 ? static_cast<uint32_t>(std::max(0L, line.substring(split + 1).toInt())) : 0;
+    traceLoadMs = std::min(traceLoadMs, kMaxTraceLoadMs);
+    if (target.equalsIgnoreCase("boot")) {
+      audioEngine.startTrace(audio::TraceTarget::Boot);
+    } else if (target.equalsIgnoreCase("ambient")) {
+      audioEngine.startTrace(audio::TraceTarget::Ambient);
+    } else if (target.equalsIgnoreCase("chord")) {
+      audioEngine.startTrace(audio::TraceTarget::Chord);
+    } else {
+      traceLoadMs = 0;
+      Serial.println(F("[serial] Trace target must be boot, ambient or chord"));
+      return;
+    }
+    Serial.printf("[serial] Tracing %s with %lu ms loop load; send audio:trace when it finishes\n", target.c_str(),
+                  static_cast<unsigned long>(traceLoadMs));
+  } else if (line.equalsIgnoreCase("audio:trace")) {
+    if (audioEngine.traceActive()) {
+      Serial.println(F("[serial] Trace still recording"));
+      return;
+    }
+    audio::TraceReport report = audioEngine.traceReport();
+    Serial.printf("[serial] Trace events=%u/%u wrong pitch=%u onset error max=%lu us mean=%lu us duration error max=%lu us\n",
+                  static_cast<unsigned>(report.captured), static_cast<unsigned>(report.expected),
+                  static_cast<unsigned>(report.mismatched), static_cast<unsigned long>(report.maxOnsetErrorUs),
+                  static_cast<unsigned long>(report.meanOnsetErrorUs),
+                  static_cast<unsigned long>(report.maxDurationErrorUs));
+    Serial.printf("[serial] Trace %s (tolerance: all events at the right pitch, onset %lu us, length %lu us)\n",
+                  report.passed() ? "PASS" : "FAIL", static_cast<unsigned long>(audio::kTraceOnsetToleranceUs),
+                  static_cast<unsigned long>(audio::kTraceDurationToleranceUs));
+    audioEngine.dumpTrace(Serial);
+  } else if (line.equalsIgnoreCase("web:stats") || line.equalsIgnoreCase("web:stats:reset")) {
+    web::HttpStats stats = web::service.stats();
+    uint32_t windowMs = stats.windowMs > 0 ? stats.windowMs : 1;
+    Serial.printf("[serial] Web requests=%lu (%lu.%02lu/s over %lu s) rejected=%lu sent=%lu B\n",
+                  static_cast<unsigned long>(stats.requests),
+                  static_cast<unsigned long>((stats.requests * 1000ULL) / windowMs),
+                  static_cast<unsigned long>(((stats.requests * 100000ULL) / windowMs) % 100),
+                  static_cast<unsigned long>(windowMs / 1000), static_cast<unsigned long>(stats.rejected),
+                  static_cast<unsigned long>(stats.bytesSent));
+    Serial.printf("[serial] Web latency p50=%lu us p99=%lu us max=%lu us, connections open=%u peak=%u\n",
+                  static_cast<unsigned long>(stats.latencyP50Us), static_cast<unsigned long>(stats.latencyP99Us),
+                  static_cast<unsigned long>(stats.latencyMaxUs), stats.openConnections, stats.peakConnections);
+    Serial.printf("[serial] Web heap per request (approx., whole heap) peak=%lu B last=%lu B, chunked responses=%lu, "
+                  "free=%lu B\n",
+                  static_cast<unsigned long>(stats.heapPeakBytes), static_cast<unsigned long>(stats.heapLastPeakBytes),
+                  static_cast<unsigned long>(stats.chunkedResponses), static_cast<unsigned long>(ESP.getFreeHeap()));
+    Serial.printf("[serial] Web server stack never below %lu B free\n",
+                  static_cast<unsigned long>(stats.stackFreeMinBytes));
+    Serial.printf("[serial] Web /api/status serialized=%lu cached=%lu not-modified=%lu\n",
+                  static_cast<unsigned long>(web::service.statusBuilds()),
+                  static_cast<unsigned long>(web::service.statusCacheHits()),
+                  static_cast<unsigned long>(web::service.statusNotModified()));
+    const web::EventStream& events = web::service.events();
+    Serial.printf("[serial] Web /api/stream subscribers=%u/%u published=%lu dropped=%lu memory=%u B\n",
+                  events.subscriberCount(), web::EventStream::kMaxSubscribers,
+                  static_cast<unsigned long>(events.published()), static_cast<unsigned long>(events.dropped()),
+                  static_cast<unsigned>(web::EventStream::memoryBytes()));
+    if (line.equalsIgnoreCase("web:stats:reset")) {
+      web::service.resetStats();
+    }
+  } else if (line.equalsIgnoreCase("web:bench") || line.startsWith("web:bench:")) {
+    // web:bench[:requests]
+    int requests = line.length() > 10 ? line.substring(10).toInt() : 200;
+    if (requests <= 0 || !web::service.startLoadTest(static_cast<uint16_t>(std::min(requests, 65535)))) {
+      Serial.println(F("[serial] Load test not started (already running, bad count or no server)"));
+      return;
+    }
+    benchActive = true;
+    benchLoopPasses = 0;
+    benchLoopMaxUs = 0;
+    Serial.printf("[serial] Load test started (%d requests, at most %u)\n", requests, web::LoadTest::kMaxRequests);
+  } else if (line.equalsIgnoreCase("metrics")) {
+    metrics::renderAll(Serial);
+  } else if (line.equalsIgnoreCase("metrics:check")) {
+    metrics::checkAll(&Serial);
+  } else if (line.equalsIgnoreCase("glow:auto")) {
+    moodGlow.setOverride(nullptr, millis(), 300);
+    Serial.println(F("[serial] Glow follows mood and battery"));
+  } else if (line.equalsIgnoreCase("glow:status")) {
+    const glow::GlowPattern& pattern = moodGlow.pattern();
+    Serial.printf("[serial] Glow #%02X%02X%02X fall=%u rise=%u floor=%u battery=%u%s\n", pattern.color.r,
+                  pattern.color.g, pattern.color.b, pattern.fallMs, pattern.riseMs, pattern.floorQ8,
+                  static_cast<unsigned>(moodGlow.battery()), moodGlow.overridden() ? " (override)" : "");
+  } else if (line.startsWith("glow:")) {
+    // glow:RRGGBB[:breathPeriodMs]
+    line.remove(0, 5);
+    int split = line.indexOf(':');
+    String hex = split >= 0 ? line.substring(0, split) : line;
+    uint32_t periodMs = split >= 0 ? static_cast<uint32_t>(line.substring(split + 1).toInt()) : 0;
+    if (hex.length() != 6) {
+      Serial.println(F("[serial] Glow expects RRGGBB[:periodMs], auto or status"));
+      return;
+    }
+    uint32_t rgb = strtoul(hex.c_str(), nullptr, 16);
+    uint16_t halfMs = static_cast<uint16_t>(std::min<uint32_t>(periodMs / 2, 30000));
+    glowOverride = {{static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb)},
+                    40, halfMs, halfMs};
+    moodGlow.setOverride(&glowOverride, millis(), 300);
+    Serial.printf("[serial] Glow pinned to #%06lX, breath %lu ms\n", static_cast<unsigned long>(rgb & 0xFFFFFF),
+                  static_cast<unsigned long>(halfMs * 2UL));
+  } else if (line.equalsIgnoreCase("display:power")) {
+    uint32_t now = millis();
+    Serial.printf("[serial] Display power state=%s transitions=%lu\n",
+                  display::DisplayPowerPolicy::name(displayPower.state()),
+                  static_cast<unsigned long>(displayPower.transitions()));
+    for (uint8_t i = 0; i < display::DisplayPowerPolicy::kStateCount; ++i) {
+      display::PowerState state = static_cast<display::PowerState>(i);
+      Serial.printf("[serial]   %-8s %10lu ms\n", display::DisplayPowerPolicy::name(state),
+                    static_cast<unsigned long>(displayPower.residencyMs(state, now)));
+    }
   } else {
     Serial.printf("[serial] Unknown command: %s\n", line.c_str());
     LOG_WARN(kLogTagMain, "Unknown serial command: %s", line.c_str());
@@ -245,10 +464,17 @@ void maybeHandleProfileFetch() {
   profileFetchInProgress = true;
   profileStatusText = String("Fetching ") + speciesQuery + "...";
   LOG_INFO(kLogTagMain, "Starting profile fetch for '%s'", speciesQuery.c_str());
+  // The fetch blocks this loop; stream clients still hear that it started.
+  web::service.publishState(lastReadings, currentMood.mood, profileFetchInProgress, profileStatusText);
 
   plant::PlantProfile profile;
   String error;
-  if (knowledgeClient.fetchProfile(speciesQuery, profile, error)) {
+  fetchAttempts.inc();
+  bool fetched = knowledgeClient.fetchProfile(speciesQuery, profile, error);
+  if (!fetched) {
+    fetchFailures.inc();
+  }
+  if (fetched) {
     profile.speciesQuery = speciesQuery;
     profile.generatedAtEpoch = millis() / 1000UL;
     profileManager.setProfile(profile);
@@ -261,9 +487,8 @@ void maybeHandleProfileFetch() {
     profileStatusText =
         String("Profile loaded: ") +
         (profile.speciesCommonName.length() ? profile.speciesCommonName : speciesQuery);
-    if (!audioEngine.isPlaying()) {
-      audioEngine.playChord({523.3f, 659.3f, 783.9f}, 650, 10);
-    }
+    audioEngine.submit(audio::SoundRequest::chord({audio::note::C5, audio::note::E5, audio::note::G5}, 650, 10,
+                                                  audio::SoundPriority::Cue, kSoundProfileLoaded));
     LOG_INFO(kLogTagMain,
              "Profile fetch succeeded: common='%s' soil[%.1f-%.1f] light[%.1f-%.1f]",
              profile.speciesCommonName.c_str(), profile.soilTargetMinPct, profile.soilTargetMaxPct,
@@ -328,7 +553,7 @@ void handleWebAdjustContrast(void*, int8_t delta) {
 }
 
 void handleWebPlayDemo(void*) {
-  audioEngine.playChord({523.3f, 659.3f, 783.9f}, 900, 10);
+  audioEngine.submit(audio::demoChord(audio::SoundPriority::Cue, kSoundDemo));
 }
 
 void handleWebResetProfile(void*) {
@@ -351,7 +576,6 @@ void setup() {
   randomSeed(esp_random());
   net::network.begin();
   profileManager.begin();
-  web::service.begin();
   web::service.attachNetworkManager(&net::network);
   web::CommandHandlers webHandlers;
   webHandlers.context = nullptr;
@@ -363,20 +587,34 @@ void setup() {
   webHandlers.resetProfile = handleWebResetProfile;
   web::service.setHandlers(webHandlers);
   web::service.setPresetList(kPresetSpecies, kPresetCount);
+  web::service.begin();
+  if (!metrics::checkAll(&Serial)) {
+    LOG_WARN(kLogTagMain, "Some metrics render invalid exposition lines, /metrics scrapes will fail");
+  }
 
   buttons.begin();
   sensors.begin();
   sensors.setSoilCalibration(soilDryCalibration, soilWetCalibration);
   sensors.setLightCalibration(lightDarkCalibration, lightBrightCalibration);
   audioEngine.begin();
+  moodGlow.begin();
   menuController.begin(kScreenOrder, kScreenCount);
-
+  ui::MenuModel menuModel;
+  menuModel.presets = kPresetSpecies;
+  menuModel.presetCount = kPresetCount;
+  menuModel.presetIndex = &presetIndex;
+  menuModel.logic = &expressionLogic;
+  menuModel.readings = &lastReadings;
+  menuController.setModel(menuModel);
+
+  u8x8_t* oledBus = oledPanel.getU8x8();
+  oledByteCallback = oledBus->byte_cb;
+  oledBus->byte_cb = countOledBytes;
   displayManager.begin();
   displayManager.drawSplash("Plantey", "breathing in...");
   LOG_INFO(kLogTagMain, "Display initialized and splash shown");
   audioEngine.playBootSequence();
   LOG_INFO(kLogTagMain, "Boot melody started");
-  ambientResumeAtMs = millis() + kAmbientResumeDelayMs;
   delay(600);
 
   if (profileManager.hasProfile()) {
@@ -401,33 +639,47 @@ void setup() {
 
   lastReadings = sensors.sample();
   currentMood = expressionLogic.evaluate(lastReadings);
-  scheduleNextBlink(millis());
+  faceAnimator.begin(millis());
+  moodGlow.setMood(currentMood.mood, millis(), anim::FaceAnimator::durationMs(anim::ClipId::MoodShift));
+  moodGlow.setBattery(glow::batteryStateFor(lastReadings), millis());
+  displayPower.begin(millis());
+  displayManager.applyPowerState(displayPower.state());
   LOG_INFO(kLogTagMain, "Initial sensor sample soil=%.1f%% light=%.1f%% temp=%.1fC",
            lastReadings.soilMoisturePct, lastReadings.lightPct, lastReadings.temperatureC);
 }
 
 void loop() {
   uint32_t now = millis();
+  uint32_t loopStartUs = micros();
 
   handleSerialInput();
   net::network.loop();
   web::service.loop();
 
-  // Buttons and menu handling.
-  input::ButtonEvent evt = buttons.poll();
-  if (evt.type != input::ButtonEventType::None) {
-    lastInteractionMs = now;
-    if (evt.type == input::ButtonEventType::Click) {
-      if (evt.id == input::ButtonId::Both) {
-        audioEngine.playChord({523.3f, 659.3f}, 120, 8);
-      } else {
-        float base = (evt.id == input::ButtonId::Left) ? 622.3f : 783.9f;
-        audioEngine.playTone(base, 70);
-      }
-      ambientResumeAtMs = now + kAmbientResumeDelayMs;
+  // Buttons and menu handling: every gesture recognized since the last pass.
+  for (input::GestureEvent evt = gestures.poll(); evt.gesture != input::Gesture::None; evt = gestures.poll()) {
+    if (consumeWakeGesture(evt, now)) {
+      LOG_DEBUG(kLogTagMain, "Gesture %d belongs to the press that woke the display", static_cast<int>(evt.gesture));
+      continue;
+    }
+    if (evt.gesture == input::Gesture::HoldEnd) {
+      continue;
+    }
+    if (evt.gesture != input::Gesture::HoldRepeat) {
+      faceAnimator.trigger(anim::ClipId::Interaction, now);
+    }
+    if (evt.id == input::ButtonId::Both) {
+      audioEngine.submit(audio::SoundRequest::chord({audio::note::C5, audio::note::E5}, 120, 8,
+                                                    audio::SoundPriority::Feedback, kSoundClick));
+    } else {
+      uint32_t base = (evt.id == input::ButtonId::Left) ? audio::note::Eb5 : audio::note::G5;
+      bool repeating = evt.gesture == input::Gesture::HoldStart || evt.gesture == input::Gesture::HoldRepeat;
+      audioEngine.submit(
+          audio::SoundRequest::tone(base, repeating ? 30 : 70, audio::SoundPriority::Feedback, kSoundClick));
     }
-    ui::MenuAction action = menuController.handleEvent(evt);
-    LOG_DEBUG(kLogTagMain, "Button event id=%d type=%d", static_cast<int>(evt.id), static_cast<int>(evt.type));
+    ui::MenuAction action = menuController.handleGesture(evt);
+    LOG_DEBUG(kLogTagMain, "Gesture id=%d gesture=%d repeat=%u lag=%lu us", static_cast<int>(evt.id),
+              static_cast<int>(evt.gesture), evt.repeat, static_cast<unsigned long>(micros() - evt.atUs));
     if (action.openScreen || action.returnToMenu) {
       lastDisplayUpdateMs = 0;
       LOG_INFO(kLogTagMain, "Display mode %s -> screen %d",
@@ -442,6 +694,15 @@ void loop() {
     if (action.presetDelta != 0) {
       cyclePreset(action.presetDelta);
     }
+    if (action.presetIndex >= 0 && action.presetIndex < kPresetCount) {
+      updateSpeciesQuery(String(kPresetSpecies[action.presetIndex]), true);
+    }
+    if (action.thresholdChanged) {
+      expressionLogic.setThreshold(action.threshold, action.thresholdValue);
+      currentMood = expressionLogic.evaluate(lastReadings);
+      LOG_INFO(kLogTagMain, "Threshold %d set to %.1f from menu", static_cast<int>(action.threshold),
+               static_cast<double>(action.thresholdValue));
+    }
     if (action.triggerProfileFetch) {
       if (!profileFetchInProgress) {
         profileStatusText = String("Queued fetch: ") + speciesQuery;
@@ -450,7 +711,7 @@ void loop() {
       LOG_INFO(kLogTagMain, "Queued profile fetch (preset delta %d)", action.presetDelta);
     }
     if (action.playDemoChord) {
-      audioEngine.playChord({523.3f, 659.3f, 783.9f}, 900, 10);
+      audioEngine.submit(audio::demoChord(audio::SoundPriority::Cue, kSoundDemo));
       LOG_INFO(kLogTagMain, "Demo chord requested");
     }
     if (action.resetProfile) {
@@ -470,36 +731,57 @@ void loop() {
   // Sensor sampling.
   if (now - lastSensorSampleMs >= kSensorIntervalMs) {
     lastReadings = sensors.sample();
+    brain::MoodKind previousMood = currentMood.mood;
     currentMood = expressionLogic.evaluate(lastReadings);
+    if (currentMood.mood != previousMood) {
+      // The glow crossfade lasts exactly as long as the face's mood-shift clip.
+      faceAnimator.trigger(anim::ClipId::MoodShift, now);
+      moodGlow.setMood(currentMood.mood, now, anim::FaceAnimator::durationMs(anim::ClipId::MoodShift));
+      if (currentMood.mood != brain::MoodKind::Sleepy) {
+        wakeDisplay(now);
+      }
+    }
+    if (currentMood.playHydrationCue || currentMood.playCelebrationCue) {
+      wakeDisplay(now);
+    }
+    moodGlow.setBattery(glow::batteryStateFor(lastReadings), now);
     LOG_DEBUG(kLogTagMain, "Sensor update soil=%.1f%% light=%.1f%% temp=%.1fC hum=%.1f%% mood=%d",
               lastReadings.soilMoisturePct, lastReadings.lightPct, lastReadings.temperatureC,
               lastReadings.humidityPct, static_cast<int>(currentMood.mood));
-    if (currentMood.playHydrationCue && !audioEngine.isPlaying()) {
-      audioEngine.playChord({392.0f, 523.3f}, 800, 14);
+    if (currentMood.playHydrationCue) {
+      audioEngine.submit(audio::SoundRequest::chord({audio::note::G4, audio::note::C5}, 800, 14,
+                                                    audio::SoundPriority::Alert, kSoundHydration));
       LOG_INFO(kLogTagMain, "Hydration cue triggered");
-    } else if (currentMood.playCelebrationCue && !audioEngine.isPlaying()) {
-      audioEngine.playChord({523.3f, 659.3f, 783.9f}, 750, 8);
+    } else if (currentMood.playCelebrationCue) {
+      audioEngine.submit(audio::SoundRequest::chord({audio::note::C5, audio::note::E5, audio::note::G5}, 750, 8,
+                                                    audio::SoundPriority::Cue, kSoundCelebration));
       LOG_INFO(kLogTagMain, "Celebration cue triggered");
     }
     lastSensorSampleMs = now;
   }
 
-  // Display updates, including blink animation.
-  bool blink = updateBlink(now);
+  // Display updates; the animator owns blinks, winks and idle glances.
+  faceAnimator.setPlayful(currentMood.playful, now);
+  faceAnimator.update(now);
   refreshStatusView(now);
   char timeText[6];
   formatClock(timeText, sizeof(timeText));
   web::service.updateState(lastReadings, statusView, speciesQuery, profileFetchInProgress, presetIndex, kPresetCount);
-  if (now - lastDisplayUpdateMs >= kDisplayIntervalMs) {
+  web::service.publishState(lastReadings, currentMood.mood, profileFetchInProgress, profileStatusText);
+  if (displayPower.update(now, currentMood.mood == brain::MoodKind::Sleepy)) {
+    displayManager.applyPowerState(displayPower.state());
+    lastDisplayUpdateMs = 0;
+  }
+  uint32_t frameIntervalMs = displayPower.frameIntervalMs();
+  if (displayPower.state() == display::PowerState::Sleeping) {
+    if (now - lastDisplayUpdateMs >= frameIntervalMs) {
+      displayManager.drawSleepFrame();
+      lastDisplayUpdateMs = now;
+    }
+  } else if (frameIntervalMs != 0 && now - lastDisplayUpdateMs >= frameIntervalMs) {
     if (menuState.inMenu || menuState.activeScreen != display::PageId::Mood) {
       timeText[0] = '\0';
     }
-    uint32_t interactionAge = (lastInteractionMs == 0) ? 0xFFFFFFFFUL : now - lastInteractionMs;
-    if (interactionAge <= 1200UL) {
-      currentMood.face.interactionPulseMs = static_cast<uint16_t>(interactionAge);
-    } else {
-      currentMood.face.interactionPulseMs = 0xFFFF;
-    }
     display::MenuListView menuView;
     const display::MenuListView* menuPtr = nullptr;
     if (menuState.inMenu) {
@@ -510,30 +792,37 @@ void loop() {
     uint8_t screenIndex = menuState.screenIndex;
     uint8_t screenCount = menuState.screenCount;
     displayManager.render(currentMood.face, lastReadings, statusView, menuPtr, timeText, pageToRender, screenIndex,
-                          screenCount, blink);
+                          screenCount, faceAnimator.sample(now));
     lastDisplayUpdateMs = now;
   }
 
-  audioEngine.update();
-
-  bool ambientActive = audioEngine.isAmbientActive();
-  bool wantAmbient = (!menuState.inMenu && menuState.activeScreen == display::PageId::Mood);
+  moodGlow.setEnabled(displayPower.state() != display::PowerState::Off, now);
+  moodGlow.update(now);
 
-  if (audioEngine.isPlaying() && !ambientActive) {
-    ambientResumeAtMs = now + kAmbientResumeDelayMs;
-  }
+  audioEngine.setAmbientEnabled(!menuState.inMenu && menuState.activeScreen == display::PageId::Mood);
+  audioEngine.update();
 
-  if (!wantAmbient && ambientActive) {
-    audioEngine.stopAmbient();
-    ambientActive = false;
-    ambientResumeAtMs = now + kAmbientResumeDelayMs;
+  if (audioEngine.traceActive() && traceLoadMs > 0) {
+    // Simulated slow frame: sequencer steps must not wait on loop(). Blocking
+    // rather than spinning keeps the idle task (and its watchdog) fed.
+    delay(traceLoadMs);
+  } else {
+    traceLoadMs = 0;
   }
 
-  if (wantAmbient && !ambientActive && !audioEngine.isPlaying() && now >= ambientResumeAtMs) {
-    audioEngine.playAmbientLoop();
-    ambientActive = true;
+  // The pass's own work; the fixed yield below is left out.
+  uint32_t loopUs = micros() - loopStartUs;
+  loopDuration.observe(loopUs);
+  if (benchActive) {
+    ++benchLoopPasses;
+    benchLoopMaxUs = std::max(benchLoopMaxUs, loopUs);
+    if (web::service.loadTest().finished()) {
+      benchActive = false;
+      web::service.loadTest().printReport(Serial);
+      Serial.printf("[bench] UI loop during the run: %lu passes, slowest %lu us\n",
+                    static_cast<unsigned long>(benchLoopPasses), static_cast<unsigned long>(benchLoopMaxUs));
+    }
   }
-
   delay(10);
 }
 
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "audio_engine.h"
+
+// Compile-time melody notation. A melody is a space-separated list of steps:
+//   "G#4:180/45"  note G#4 for 180 ms, then 45 ms of silence
+//   "Eb5:200"     note without a trailing pause
+//   "R:160"       160 ms rest
+// PLANTEY_MELODY("...") expands to a constexpr std::array<MelodyStep, N>, so the
+// frequencies and LEDC dividers are computed by the compiler. Malformed text
+// fails the build at the offending step.
+#define PLANTEY_MELODY(text) (::audio::melody::parse<::audio::melody::countSteps(text)>(text))
+
+namespace audio {
+namespace melody {
+
+// Deliberately not constexpr: reaching it during constant evaluation is what
+// turns a typo in a melody string into a compile error.
+void invalidMelodyText();
+
+constexpr float kOctave4Hz[12] = {261.63f, 277.18f, 293.66f, 311.13f, 329.63f, 349.23f,
+                                  369.99f, 392.00f, 415.30f, 440.00f, 466.16f, 493.88f};
+
+constexpr bool isSeparator(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == ',';
+}
+
+constexpr size_t countSteps(const char* text) {
+  size_t count = 0;
+  bool inStep = false;
+  for (size_t i = 0; text[i] != '\0'; ++i) {
+    bool separator = isSeparator(text[i]);
+    if (!separator && !inStep) {
+      ++count;
+    }
+    inStep = !separator;
+  }
+  return count;
+}
+
+constexpr int semitoneOf(char letter) {
+  switch (letter) {
+    case 'C': return 0;
+    case 'D': return 2;
+    case 'E': return 4;
+    case 'F': return 5;
+    case 'G': return 7;
+    case 'A': return 9;
+    case 'B': return 11;
+    default: invalidMelodyText(); return 0;
+  }
+}
+
+// Parses a note name such as "C5", "G#4" or "Bb3" starting at text[pos].
+constexpr float noteHz(const char* text, size_t& pos) {
+  int semitone = semitoneOf(text[pos++]);
+  if (text[pos] == '#') {
+    ++semitone;
+    ++pos;
+  } else if (text[pos] == 'b') {
+    --semitone;
+    ++pos;
+  }
+  if (text[pos] < '0' || text[pos] > '8') {
+    invalidMelodyText();
+  }
+  int octave = text[pos++] - '0';
+  if (semitone < 0) {
+    semitone += 12;
+    --octave;
+  } else if (semitone > 11) {
+    semitone -= 12;
+    ++octave;
+  }
+  float hz = kOctave4Hz[semitone];
+  for (int o = octave; o < 4; ++o) hz /= 2.0f;
+  for (int o = octave; o > 4; --o) hz *= 2.0f;
+  return hz;
+}
+
+constexpr float noteHz(const char* name) {
+  size_t pos = 0;
+  float hz = noteHz(name, pos);
+  if (name[pos] != '\0') {
+    invalidMelodyText();
+  }
+  return hz;
+}
+
+constexpr uint16_t parseMs(const char* text, size_t& pos) {
+  if (text[pos] < '0' || text[pos] > '9') {
+    invalidMelodyText();
+  }
+  uint32_t value = 0;
+  while (text[pos] >= '0' && text[pos] <= '9') {
+    value = value * 10 + static_cast<uint32_t>(text[pos++] - '0');
+    if (value > 0xFFFF) {
+      invalidMelodyText();
+    }
+  }
+  return static_cast<uint16_t>(value);
+}
+
+template <size_t N>
+constexpr std::array<MelodyStep, N> parse(const char* text) {
+  std::array<MelodyStep, N> steps{};
+  size_t pos = 0;
+  for (size_t i = 0; i < N; ++i) {
+    while (isSeparator(text[pos])) {
+      ++pos;
+    }
+    bool rest = text[pos] == 'R';
+    float hz = 0.0f;
+    if (rest) {
+      ++pos;
+    } else {
+      hz = noteHz(text, pos);
+    }
+    if (text[pos++] != ':') {
+      invalidMelodyText();
+    }
+    uint16_t duration = parseMs(text, pos);
+    uint16_t pause = 0;
+    if (text[pos] == '/') {
+      ++pos;
+      pause = parseMs(text, pos);
+    }
+    if (text[pos] != '\0' && !isSeparator(text[pos])) {
+      invalidMelodyText();
+    }
+    steps[i] = rest ? MelodyStep(0.0f, 0, static_cast<uint16_t>(duration + pause)) : MelodyStep(hz, duration, pause);
+  }
+  return steps;
+}
+
+}  // namespace melody
+
+// LEDC dividers for cues and feedback tones outside of melodies. Like melody
+// steps they are computed by the compiler, so the requests that use them do no
+// float math at runtime (the C3 has no FPU).
+namespace note {
+constexpr uint32_t G4 = ledcDividerQ8(melody::noteHz("G4"));
+constexpr uint32_t C5 = ledcDividerQ8(melody::noteHz("C5"));
+constexpr uint32_t Eb5 = ledcDividerQ8(melody::noteHz("Eb5"));
+constexpr uint32_t E5 = ledcDividerQ8(melody::noteHz("E5"));
+constexpr uint32_t G5 = ledcDividerQ8(melody::noteHz("G5"));
+}  // namespace note
+
+// The web/menu demo chord. audio:trace:chord plays the same one as its reference.
+constexpr uint32_t kDemoChord[] = {note::C5, note::E5, note::G5};
+constexpr uint16_t kDemoChordMs = 900;
+constexpr uint16_t kDemoChordCycleMs = 10;
+
+inline SoundRequest demoChord(SoundPriority priority, uint8_t coalesceKey = 0) {
+  return SoundRequest::chord({kDemoChord[0], kDemoChord[1], kDemoChord[2]}, kDemoChordMs, kDemoChordCycleMs,
+                             priority, coalesceKey);
+}
+
+}  // namespace audio
@@ -9,7 +9,16 @@
 namespace ui {
 namespace {
 
-enum class MenuNodeId : uint8_t { Root = 0, SensorTools = 1, PlantTools = 2, DisplaySound = 3 };
+enum class MenuNodeId : uint8_t {
+  Root,
+  SensorTools,
+  PlantTools,
+  DisplaySound,
+  SpeciesPicker,
+  Thresholds,
+  ThresholdEditor,
+  CalibrationWizard,
+};
 
 enum class MenuItemType : uint8_t { Screen, Submenu, Action, Back };
 
@@ -23,6 +32,12 @@ enum class ActionId : uint8_t {
   MarkLightBright,
   PlayDemo,
   ResetProfile,
+  SelectPreset,    // arg: preset index
+  EditThreshold,   // arg: index into kThresholdSpecs
+  SaveThreshold,
+  StartWizard,
+  WizardCapture,
+  WizardSkip,
 };
 
 struct MenuItemDef {
@@ -31,58 +46,266 @@ struct MenuItemDef {
   MenuNodeId submenu;
   display::PageId screen;
   ActionId action;
+  uint8_t arg;
+};
+
+struct MenuContext {
+  const MenuModel& model;
+  const MenuSession& session;
+};
+
+// Generates a node's entries on demand. Only the rows in the visible window
+// are asked for, and generated labels are written into the caller's buffer
+// (MenuListView::kLabelLength bytes), so nothing is allocated.
+struct MenuProvider {
+  uint8_t (*count)(const MenuContext& ctx);
+  void (*item)(const MenuContext& ctx, uint8_t index, MenuItemDef* item, char* text);
+  void (*title)(const MenuContext& ctx, char* text);  // optional; else the node title
+  // Optional: Up/Down change a value instead of moving the selection.
+  void (*adjust)(const MenuModel& model, MenuSession& session, int8_t steps);
 };
 
 struct MenuNodeDef {
   MenuNodeId id;
   const char* title;
-  const MenuItemDef* items;
+  const MenuItemDef* items;  // static nodes
   uint8_t itemCount;
+  const MenuProvider* provider;  // generated nodes
 };
 
+// Menu description helpers.
+constexpr MenuItemDef screenItem(const char* label, display::PageId screen) {
+  return {label, MenuItemType::Screen, MenuNodeId::Root, screen, ActionId::None, 0};
+}
+
+constexpr MenuItemDef submenuItem(const char* label, MenuNodeId node) {
+  return {label, MenuItemType::Submenu, node, display::PageId::Mood, ActionId::None, 0};
+}
+
+constexpr MenuItemDef actionItem(const char* label, ActionId action, uint8_t arg = 0) {
+  return {label, MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, action, arg};
+}
+
+constexpr MenuItemDef backItem(const char* label = "Back") {
+  return {label, MenuItemType::Back, MenuNodeId::Root, display::PageId::Mood, ActionId::None, 0};
+}
+
+template <size_t N>
+constexpr MenuNodeDef staticNode(MenuNodeId id, const char* title, const MenuItemDef (&items)[N]) {
+  static_assert(N > 0 && N < 256, "a menu node holds 1..255 items");
+  return {id, title, items, static_cast<uint8_t>(N), nullptr};
+}
+
+constexpr MenuNodeDef providerNode(MenuNodeId id, const char* title, const MenuProvider& provider) {
+  return {id, title, nullptr, 0, &provider};
+}
+
+struct ThresholdSpec {
+  brain::Threshold id;
+  const char* label;
+  const char* unit;
+  float min;
+  float max;
+  float step;
+};
+
+constexpr ThresholdSpec kThresholdSpecs[] = {
+    {brain::Threshold::SoilDry, "Soil dry", "%", 0.0f, 100.0f, 1.0f},
+    {brain::Threshold::SoilSoggy, "Soil soggy", "%", 0.0f, 100.0f, 1.0f},
+    {brain::Threshold::LightLow, "Light low", "%", 0.0f, 100.0f, 1.0f},
+    {brain::Threshold::LightHigh, "Light high", "%", 0.0f, 100.0f, 1.0f},
+    {brain::Threshold::TempMin, "Temp min", "C", -10.0f, 45.0f, 0.5f},
+    {brain::Threshold::TempMax, "Temp max", "C", -10.0f, 45.0f, 0.5f},
+};
+constexpr uint8_t kThresholdCount = sizeof(kThresholdSpecs) / sizeof(ThresholdSpec);
+
+struct WizardStep {
+  CalibrationTarget target;
+  const char* prompt;
+  bool soil;
+};
+
+constexpr WizardStep kWizardSteps[] = {
+    {CalibrationTarget::SoilDry, "Probe in dry soil", true},
+    {CalibrationTarget::SoilWet, "Probe in wet soil", true},
+    {CalibrationTarget::LightDark, "Cover light sensor", false},
+    {CalibrationTarget::LightBright, "Light on sensor", false},
+};
+constexpr uint8_t kWizardStepCount = sizeof(kWizardSteps) / sizeof(WizardStep);
+
+uint8_t decimalsFor(const ThresholdSpec& spec) {
+  return spec.step < 1.0f ? 1 : 0;
+}
+
+uint8_t speciesCount(const MenuContext& ctx) {
+  return ctx.model.presetCount + 1;
+}
+
+void speciesItem(const MenuContext& ctx, uint8_t index, MenuItemDef* item, char* text) {
+  if (index >= ctx.model.presetCount) {
+    *item = backItem();
+    return;
+  }
+  bool current = ctx.model.presetIndex != nullptr && *ctx.model.presetIndex == index;
+  snprintf(text, display::MenuListView::kLabelLength, "%c %s", current ? '*' : ' ', ctx.model.presets[index]);
+  *item = actionItem(text, ActionId::SelectPreset, index);
+}
+
+uint8_t thresholdCount(const MenuContext&) {
+  return kThresholdCount + 1;
+}
+
+void thresholdItem(const MenuContext& ctx, uint8_t index, MenuItemDef* item, char* text) {
+  if (index >= kThresholdCount) {
+    *item = backItem();
+    return;
+  }
+  const ThresholdSpec& spec = kThresholdSpecs[index];
+  if (ctx.model.logic != nullptr) {
+    snprintf(text, display::MenuListView::kLabelLength, "%-11s%5.*f%s", spec.label, decimalsFor(spec),
+             static_cast<double>(ctx.model.logic->threshold(spec.id)), spec.unit);
+  } else {
+    snprintf(text, display::MenuListView::kLabelLength, "%-11s   --", spec.label);
+  }
+  *item = actionItem(text, ActionId::EditThreshold, index);
+}
+
+uint8_t editorCount(const MenuContext&) {
+  return 1;
+}
+
+void editorItem(const MenuContext& ctx, uint8_t, MenuItemDef* item, char* text) {
+  const ThresholdSpec& spec = kThresholdSpecs[ctx.session.editIndex % kThresholdCount];
+  snprintf(text, display::MenuListView::kLabelLength, "<  %.*f %s  >", decimalsFor(spec),
+           static_cast<double>(ctx.session.editValue), spec.unit);
+  *item = actionItem(text, ActionId::SaveThreshold);
+}
+
+void editorTitle(const MenuContext& ctx, char* text) {
+  snprintf(text, display::MenuListView::kLabelLength, "%s",
+           kThresholdSpecs[ctx.session.editIndex % kThresholdCount].label);
+}
+
+void editorAdjust(const MenuModel&, MenuSession& session, int8_t steps) {
+  const ThresholdSpec& spec = kThresholdSpecs[session.editIndex % kThresholdCount];
+  float value = session.editValue + steps * spec.step;
+  session.editValue = std::min(spec.max, std::max(spec.min, value));
+}
+
+uint8_t wizardCount(const MenuContext&) {
+  return 3;
+}
+
+void wizardItem(const MenuContext& ctx, uint8_t index, MenuItemDef* item, char* text) {
+  switch (index) {
+    case 0: {
+      const WizardStep& step = kWizardSteps[ctx.session.wizardStep % kWizardStepCount];
+      if (ctx.model.readings != nullptr) {
+        snprintf(text, display::MenuListView::kLabelLength, "Capture (raw %u)",
+                 step.soil ? ctx.model.readings->soilRaw : ctx.model.readings->lightRaw);
+        *item = actionItem(text, ActionId::WizardCapture);
+      } else {
+        *item = actionItem("Capture", ActionId::WizardCapture);
+      }
+      break;
+    }
+    case 1:
+      *item = actionItem("Skip this step", ActionId::WizardSkip);
+      break;
+    default:
+      *item = backItem("Cancel");
+      break;
+  }
+}
+
+void wizardTitle(const MenuContext& ctx, char* text) {
+  uint8_t step = ctx.session.wizardStep % kWizardStepCount;
+  snprintf(text, display::MenuListView::kLabelLength, "%u/%u %s", step + 1, kWizardStepCount,
+           kWizardSteps[step].prompt);
+}
+
+constexpr MenuProvider kSpeciesProvider = {speciesCount, speciesItem, nullptr, nullptr};
+constexpr MenuProvider kThresholdProvider = {thresholdCount, thresholdItem, nullptr, nullptr};
+constexpr MenuProvider kEditorProvider = {editorCount, editorItem, editorTitle, editorAdjust};
+constexpr MenuProvider kWizardProvider = {wizardCount, wizardItem, wizardTitle, nullptr};
+
 constexpr MenuItemDef kRootItems[] = {
-    {"Face view", MenuItemType::Screen, MenuNodeId::Root, display::PageId::Mood, ActionId::None},
-    {"Plant insights", MenuItemType::Screen, MenuNodeId::Root, display::PageId::Info, ActionId::None},
-    {"Sensor toolkit", MenuItemType::Submenu, MenuNodeId::SensorTools, display::PageId::Mood, ActionId::None},
-    {"Plant toolkit", MenuItemType::Submenu, MenuNodeId::PlantTools, display::PageId::Mood, ActionId::None},
-    {"Sound & calm", MenuItemType::Submenu, MenuNodeId::DisplaySound, display::PageId::Mood, ActionId::None},
-    {"Diagnostics", MenuItemType::Screen, MenuNodeId::Root, display::PageId::Debug, ActionId::None},
+    screenItem("Face view", display::PageId::Mood),
+    screenItem("Plant insights", display::PageId::Info),
+    submenuItem("Sensor toolkit", MenuNodeId::SensorTools),
+    submenuItem("Plant toolkit", MenuNodeId::PlantTools),
+    submenuItem("Sound & calm", MenuNodeId::DisplaySound),
+    screenItem("Diagnostics", display::PageId::Debug),
 };
 
 constexpr MenuItemDef kSensorItems[] = {
-    {"Mark soil as dry", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::MarkSoilDry},
-    {"Mark soil as wet", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::MarkSoilWet},
-    {"Mark light as dark", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::MarkLightDark},
-    {"Mark light as bright", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::MarkLightBright},
-    {"Back", MenuItemType::Back, MenuNodeId::Root, display::PageId::Mood, ActionId::None},
+    actionItem("Calibration wizard", ActionId::StartWizard),
+    actionItem("Mark soil as dry", ActionId::MarkSoilDry),
+    actionItem("Mark soil as wet", ActionId::MarkSoilWet),
+    actionItem("Mark light as dark", ActionId::MarkLightDark),
+    actionItem("Mark light as bright", ActionId::MarkLightBright),
+    backItem(),
 };
 
 constexpr MenuItemDef kPlantItems[] = {
-    {"Fetch plant profile", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::FetchProfile},
-    {"Next preset + fetch", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::NextPresetFetch},
-    {"Reset plant profile", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::ResetProfile},
-    {"Back", MenuItemType::Back, MenuNodeId::Root, display::PageId::Mood, ActionId::None},
+    actionItem("Fetch plant profile", ActionId::FetchProfile),
+    submenuItem("Choose species", MenuNodeId::SpeciesPicker),
+    actionItem("Next preset + fetch", ActionId::NextPresetFetch),
+    submenuItem("Mood thresholds", MenuNodeId::Thresholds),
+    actionItem("Reset plant profile", ActionId::ResetProfile),
+    backItem(),
 };
 
 constexpr MenuItemDef kDisplayItems[] = {
-    {"Play audio demo", MenuItemType::Action, MenuNodeId::Root, display::PageId::Mood, ActionId::PlayDemo},
-    {"Back", MenuItemType::Back, MenuNodeId::Root, display::PageId::Mood, ActionId::None},
+    actionItem("Play audio demo", ActionId::PlayDemo),
+    backItem(),
 };
 
+// Indexed by MenuNodeId.
 constexpr MenuNodeDef kMenuNodes[] = {
-    {MenuNodeId::Root, "Main menu", kRootItems, static_cast<uint8_t>(sizeof(kRootItems) / sizeof(MenuItemDef))},
-    {MenuNodeId::SensorTools, "Sensor tools", kSensorItems, static_cast<uint8_t>(sizeof(kSensorItems) / sizeof(MenuItemDef))},
-    {MenuNodeId::PlantTools, "Plant tools", kPlantItems, static_cast<uint8_t>(sizeof(kPlantItems) / sizeof(MenuItemDef))},
-    {MenuNodeId::DisplaySound, "Sound & calm", kDisplayItems,
-     static_cast<uint8_t>(sizeof(kDisplayItems) / sizeof(MenuItemDef))},
+    staticNode(MenuNodeId::Root, "Main menu", kRootItems),
+    staticNode(MenuNodeId::SensorTools, "Sensor tools", kSensorItems),
+    staticNode(MenuNodeId::PlantTools, "Plant tools", kPlantItems),
+    staticNode(MenuNodeId::DisplaySound, "Sound & calm", kDisplayItems),
+    providerNode(MenuNodeId::SpeciesPicker, "Choose species", kSpeciesProvider),
+    providerNode(MenuNodeId::Thresholds, "Mood thresholds", kThresholdProvider),
+    providerNode(MenuNodeId::ThresholdEditor, "Edit threshold", kEditorProvider),
+    providerNode(MenuNodeId::CalibrationWizard, "Calibration", kWizardProvider),
 };
+constexpr uint8_t kNodeCount = sizeof(kMenuNodes) / sizeof(MenuNodeDef);
+
+constexpr bool menuTreeValid() {
+  for (uint8_t n = 0; n < kNodeCount; ++n) {
+    const MenuNodeDef& node = kMenuNodes[n];
+    if (static_cast<uint8_t>(node.id) != n) {
+      return false;
+    }
+    for (uint8_t i = 0; node.items != nullptr && i < node.itemCount; ++i) {
+      if (node.items[i].type == MenuItemType::Submenu && static_cast<uint8_t>(node.items[i].submenu) >= kNodeCount) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+static_assert(menuTreeValid(), "kMenuNodes must be in MenuNodeId order and every submenu must exist");
 
 const MenuNodeDef& nodeForIndex(uint8_t index) {
-  return kMenuNodes[index % (sizeof(kMenuNodes) / sizeof(MenuNodeDef))];
+  return kMenuNodes[index % kNodeCount];
 }
 
-const MenuNodeDef& nodeForId(MenuNodeId id) {
-  return nodeForIndex(static_cast<uint8_t>(id));
+uint8_t itemCountOf(const MenuNodeDef& node, const MenuContext& ctx) {
+  return node.provider != nullptr ? node.provider->count(ctx) : node.itemCount;
+}
+
+// A generated label is written to text, which must outlive the returned item.
+MenuItemDef itemAt(const MenuNodeDef& node, const MenuContext& ctx, uint8_t index, char* text) {
+  if (node.provider == nullptr) {
+    return node.items[index];
+  }
+  MenuItemDef item = backItem();
+  node.provider->item(ctx, index, &item, text);
+  return item;
 }
 
 display::MenuEntryKind kindForItem(MenuItemType type) {
@@ -99,6 +322,54 @@ display::MenuEntryKind kindForItem(MenuItemType type) {
   }
 }
 
+// What each gesture does in the menu and on a screen. Hold repeats accelerate,
+// so long menus scroll quickly; pairs not listed are ignored.
+enum class Command : uint8_t {
+  None,
+  Up,
+  Down,
+  First,
+  Last,
+  Activate,
+  Back,
+  OpenMenu,
+  PreviousScreen,
+  NextScreen,
+  FaceView,
+};
+
+struct GestureBinding {
+  bool inMenu;
+  input::ButtonId id;
+  input::Gesture gesture;
+  Command command;
+};
+
+using input::ButtonId;
+using input::Gesture;
+
+constexpr GestureBinding kBindings[] = {
+    {true, ButtonId::Left, Gesture::Click, Command::Up},
+    {true, ButtonId::Right, Gesture::Click, Command::Down},
+    {true, ButtonId::Left, Gesture::HoldStart, Command::Up},
+    {true, ButtonId::Right, Gesture::HoldStart, Command::Down},
+    {true, ButtonId::Left, Gesture::HoldRepeat, Command::Up},
+    {true, ButtonId::Right, Gesture::HoldRepeat, Command::Down},
+    {true, ButtonId::Left, Gesture::DoubleClick, Command::Back},
+    {true, ButtonId::Right, Gesture::DoubleClick, Command::Activate},
+    {true, ButtonId::Left, Gesture::TripleClick, Command::First},
+    {true, ButtonId::Right, Gesture::TripleClick, Command::Last},
+    {true, ButtonId::Both, Gesture::Click, Command::Activate},
+    {true, ButtonId::Both, Gesture::HoldStart, Command::FaceView},
+
+    {false, ButtonId::Left, Gesture::Click, Command::PreviousScreen},
+    {false, ButtonId::Right, Gesture::Click, Command::NextScreen},
+    {false, ButtonId::Left, Gesture::DoubleClick, Command::OpenMenu},
+    {false, ButtonId::Right, Gesture::DoubleClick, Command::OpenMenu},
+    {false, ButtonId::Both, Gesture::Click, Command::OpenMenu},
+    {false, ButtonId::Both, Gesture::HoldStart, Command::FaceView},
+};
+
 }  // namespace
 
 constexpr const char* kLogTagMenu = "menu";
@@ -120,44 +391,71 @@ void MenuController::begin(const display::PageId* screens, uint8_t screenCount)
   LOG_INFO(kLogTagMenu, "Menu initialized with %u screens", screenCount_);
 }
 
-MenuAction MenuController::handleEvent(const input::ButtonEvent& event) {
+MenuAction MenuController::handleGesture(const input::GestureEvent& event) {
   MenuAction action;
   action.screen = activeScreen_;
-  if (event.type == input::ButtonEventType::None) {
-    return action;
-  }
 
-  if (inMenu_) {
-    if (event.type == input::ButtonEventType::Click || event.type == input::ButtonEventType::LongPress) {
-      if (event.id == input::ButtonId::Left) {
-        moveSelection(-1);
-      } else if (event.id == input::ButtonId::Right) {
-        moveSelection(+1);
-      } else if (event.id == input::ButtonId::Both) {
-        action = activateSelection();
-        if (action.openScreen) {
-          action.screen = activeScreen_;
-        }
-      }
-      LOG_DEBUG(kLogTagMenu, "Menu input id=%d type=%d sel=%u depth=%u",
-                static_cast<int>(event.id), static_cast<int>(event.type),
-                stack_[depth_ - 1].selection, depth_);
-  }
-    return action;
+  Command command = Command::None;
+  for (const GestureBinding& binding : kBindings) {
+    if (binding.inMenu == inMenu_ && binding.id == event.id && binding.gesture == event.gesture) {
+      command = binding.command;
+      break;
+    }
   }
 
-  if (!inMenu_) {
-    if (event.type == input::ButtonEventType::Click || event.type == input::ButtonEventType::LongPress) {
-      if (event.id == input::ButtonId::Left || event.id == input::ButtonId::Right || event.id == input::ButtonId::Both) {
-        inMenu_ = true;
-        syncState();
-        action.returnToMenu = true;
-        LOG_INFO(kLogTagMenu, "Menu opened from face view");
+  switch (command) {
+    case Command::Up:
+      moveOrAdjust(-1);
+      break;
+    case Command::Down:
+      moveOrAdjust(+1);
+      break;
+    case Command::First:
+      stack_[depth_ - 1].selection = 0;
+      break;
+    case Command::Last:
+      moveSelection(-1 - static_cast<int8_t>(stack_[depth_ - 1].selection));
+      break;
+    case Command::Activate:
+      action = activateSelection();
+      if (action.openScreen) {
+        action.screen = activeScreen_;
       }
-    }
-    return action;
+      break;
+    case Command::Back:
+      if (depth_ > 1) {
+        popMenu();
+      } else {
+        action = leaveMenu(activeScreen_);
+      }
+      break;
+    case Command::OpenMenu:
+      inMenu_ = true;
+      syncState();
+      action.returnToMenu = true;
+      LOG_INFO(kLogTagMenu, "Menu opened from screen %u", activeScreenIndex_);
+      break;
+    case Command::PreviousScreen:
+      previousScreen();
+      action.openScreen = true;
+      action.screen = activeScreen_;
+      break;
+    case Command::NextScreen:
+      nextScreen();
+      action.openScreen = true;
+      action.screen = activeScreen_;
+      break;
+    case Command::FaceView:
+      action = leaveMenu(screens_ != nullptr && screenCount_ > 0 ? screens_[0] : display::PageId::Mood);
+      break;
+    case Command::None:
+      break;
   }
 
+  if (command != Command::None) {
+    LOG_DEBUG(kLogTagMenu, "Gesture id=%d gesture=%d -> command %d sel=%u depth=%u", static_cast<int>(event.id),
+              static_cast<int>(event.gesture), static_cast<int>(command), stack_[depth_ - 1].selection, depth_);
+  }
   return action;
 }
 
@@ -181,33 +479,40 @@ void MenuController::buildMenuView(display::MenuListView* view) const {
 
   const StackEntry& top = stack_[depth_ - 1];
   const MenuNodeDef& node = nodeForIndex(top.menuIndex);
+  const MenuContext ctx{model_, session_};
+  uint8_t itemCount = itemCountOf(node, ctx);
   view->title = node.title;
-  view->totalCount = node.itemCount;
-  view->selectedIndex = std::min<uint8_t>(top.selection, node.itemCount > 0 ? node.itemCount - 1 : 0);
+  if (node.provider != nullptr && node.provider->title != nullptr) {
+    node.provider->title(ctx, view->titleText);
+    view->title = view->titleText;
+  }
+  view->totalCount = itemCount;
+  view->selectedIndex = std::min<uint8_t>(top.selection, itemCount > 0 ? itemCount - 1 : 0);
 
-  if (node.itemCount == 0) {
+  if (itemCount == 0) {
     return;
   }
 
   uint8_t maxVisible = display::MenuListView::kMaxVisible;
   uint8_t topIndex = 0;
 
-  if (node.itemCount <= maxVisible) {
+  if (itemCount <= maxVisible) {
     topIndex = 0;
   } else {
     if (view->selectedIndex >= maxVisible) {
       topIndex = view->selectedIndex - (maxVisible - 1);
     }
-    uint8_t maxTop = node.itemCount - maxVisible;
+    uint8_t maxTop = itemCount - maxVisible;
     if (topIndex > maxTop) {
       topIndex = maxTop;
     }
   }
 
   view->topIndex = topIndex;
-  view->entryCount = std::min<uint8_t>(maxVisible, node.itemCount - topIndex);
+  // Only the visible window is materialized.
+  view->entryCount = std::min<uint8_t>(maxVisible, itemCount - topIndex);
   for (uint8_t i = 0; i < view->entryCount; ++i) {
-    const MenuItemDef& item = node.items[topIndex + i];
+    MenuItemDef item = itemAt(node, ctx, topIndex + i, view->text[i]);
     view->items[i] = item.label;
     view->kinds[i] = kindForItem(item.type);
   }
@@ -218,21 +523,33 @@ void MenuController::moveSelection(int8_t delta) {
     return;
   }
   StackEntry& top = stack_[depth_ - 1];
-  const MenuNodeDef& node = nodeForIndex(top.menuIndex);
-  if (node.itemCount == 0) {
+  uint8_t itemCount = itemCountOf(nodeForIndex(top.menuIndex), MenuContext{model_, session_});
+  if (itemCount == 0) {
     top.selection = 0;
     return;
   }
   int16_t index = static_cast<int16_t>(top.selection) + delta;
   while (index < 0) {
-    index += node.itemCount;
+    index += itemCount;
   }
-  while (index >= node.itemCount) {
-    index -= node.itemCount;
+  while (index >= itemCount) {
+    index -= itemCount;
   }
   top.selection = static_cast<uint8_t>(index);
 }
 
+void MenuController::moveOrAdjust(int8_t delta) {
+  if (depth_ == 0) {
+    return;
+  }
+  const MenuNodeDef& node = nodeForIndex(stack_[depth_ - 1].menuIndex);
+  if (node.provider != nullptr && node.provider->adjust != nullptr) {
+    node.provider->adjust(model_, session_, delta);
+    return;
+  }
+  moveSelection(delta);
+}
+
 MenuAction MenuController::activateSelection() {
   MenuAction action;
   if (depth_ == 0) {
@@ -240,11 +557,13 @@ MenuAction MenuController::activateSelection() {
   }
   StackEntry& top = stack_[depth_ - 1];
   const MenuNodeDef& node = nodeForIndex(top.menuIndex);
-  if (node.itemCount == 0 || top.selection >= node.itemCount) {
+  const MenuContext ctx{model_, session_};
+  if (top.selection >= itemCountOf(node, ctx)) {
     return action;
   }
 
-  const MenuItemDef& item = node.items[top.selection];
+  char text[display::MenuListView::kLabelLength];
+  const MenuItemDef item = itemAt(node, ctx, top.selection, text);
 
   switch (item.type) {
     case MenuItemType::Screen:
@@ -293,6 +612,38 @@ MenuAction MenuController::activateSelection() {
           action.resetProfile = true;
           LOG_WARN(kLogTagMenu, "Action reset profile");
           break;
+        case ActionId::SelectPreset:
+          action.presetIndex = static_cast<int8_t>(item.arg);
+          action.triggerProfileFetch = true;
+          popMenu();
+          LOG_INFO(kLogTagMenu, "Action select preset %u + fetch", item.arg);
+          break;
+        case ActionId::EditThreshold:
+          session_.editIndex = item.arg % kThresholdCount;
+          session_.editValue =
+              model_.logic != nullptr ? model_.logic->threshold(kThresholdSpecs[session_.editIndex].id) : 0.0f;
+          pushMenu(static_cast<uint8_t>(MenuNodeId::ThresholdEditor));
+          break;
+        case ActionId::SaveThreshold:
+          action.thresholdChanged = true;
+          action.threshold = kThresholdSpecs[session_.editIndex].id;
+          action.thresholdValue = session_.editValue;
+          popMenu();
+          LOG_INFO(kLogTagMenu, "Action set %s to %.1f", kThresholdSpecs[session_.editIndex].label,
+                   static_cast<double>(session_.editValue));
+          break;
+        case ActionId::StartWizard:
+          session_.wizardStep = 0;
+          pushMenu(static_cast<uint8_t>(MenuNodeId::CalibrationWizard));
+          LOG_INFO(kLogTagMenu, "Action start calibration wizard");
+          break;
+        case ActionId::WizardCapture:
+          action.calibration = kWizardSteps[session_.wizardStep % kWizardStepCount].target;
+          advanceWizard();
+          break;
+        case ActionId::WizardSkip:
+          advanceWizard();
+          break;
         case ActionId::None:
         default:
           break;
@@ -308,6 +659,14 @@ MenuAction MenuController::activateSelection() {
   return action;
 }
 
+MenuAction MenuController::leaveMenu(display::PageId screen) {
+  MenuAction action;
+  enterScreen(screen);
+  action.openScreen = true;
+  action.screen = activeScreen_;
+  return action;
+}
+
 void MenuController::enterScreen(display::PageId screen) {
   inMenu_ = false;
   for (uint8_t i = 0; i < screenCount_; ++i) {
@@ -351,7 +710,7 @@ void MenuController::pushMenu(uint8_t submenuIndex) {
     LOG_WARN(kLogTagMenu, "Max menu depth reached");
     return;
   }
-  stack_[depth_].menuIndex = submenuIndex % (sizeof(kMenuNodes) / sizeof(MenuNodeDef));
+  stack_[depth_].menuIndex = submenuIndex % kNodeCount;
   stack_[depth_].selection = 0;
   ++depth_;
   LOG_DEBUG(kLogTagMenu, "Pushed submenu %u depth=%u", submenuIndex, depth_);
@@ -365,6 +724,15 @@ void MenuController::popMenu() {
   LOG_DEBUG(kLogTagMenu, "Popped to depth=%u", depth_);
 }
 
+void MenuController::advanceWizard() {
+  ++session_.wizardStep;
+  if (session_.wizardStep >= kWizardStepCount) {
+    session_.wizardStep = 0;
+    popMenu();
+    LOG_INFO(kLogTagMenu, "Calibration wizard finished");
+  }
+}
+
 void MenuController::syncState() {
   state_.inMenu = inMenu_;
   state_.activeScreen = activeScreen_;
@@ -1,7 +1,9 @@
 #pragma once
 
-#include "buttons.h"
+#include "button_gestures.h"
 #include "display_manager.h"
+#include "expression_logic.h"
+#include "sensors.h"
 
 namespace ui {
 
@@ -20,6 +22,22 @@ struct MenuState {
   uint8_t screenCount = 0;
 };
 
+// Live data the generated menu entries are built from; owned by the caller.
+struct MenuModel {
+  const char* const* presets = nullptr;
+  uint8_t presetCount = 0;
+  const uint8_t* presetIndex = nullptr;
+  const brain::ExpressionLogic* logic = nullptr;
+  const sensing::EnvironmentReadings* readings = nullptr;
+};
+
+// Menu state the generated entries depend on (wizard step, value being edited).
+struct MenuSession {
+  uint8_t wizardStep = 0;
+  uint8_t editIndex = 0;
+  float editValue = 0.0f;
+};
+
 struct MenuAction {
   bool openScreen = false;
   bool returnToMenu = false;
@@ -28,24 +46,32 @@ struct MenuAction {
   bool playDemoChord = false;
   bool triggerProfileFetch = false;
   int8_t presetDelta = 0;
+  int8_t presetIndex = -1;  // >= 0 picks that preset outright
   bool resetProfile = false;
+  bool thresholdChanged = false;
+  brain::Threshold threshold = brain::Threshold::SoilDry;
+  float thresholdValue = 0.0f;
 };
 
 class MenuController {
  public:
   void begin(const display::PageId* screens, uint8_t screenCount);
-  MenuAction handleEvent(const input::ButtonEvent& event);
+  void setModel(const MenuModel& model) { model_ = model; }
+  MenuAction handleGesture(const input::GestureEvent& event);
   const MenuState& state() const { return state_; }
   void buildMenuView(display::MenuListView* view) const;
 
  private:
   void moveSelection(int8_t delta);
+  void moveOrAdjust(int8_t delta);
   MenuAction activateSelection();
+  MenuAction leaveMenu(display::PageId screen);
   void enterScreen(display::PageId screen);
   void nextScreen();
   void previousScreen();
   void pushMenu(uint8_t submenuIndex);
   void popMenu();
+  void advanceWizard();
   void syncState();
 
   static constexpr uint8_t kMaxDepth = 4;
@@ -64,6 +90,8 @@ class MenuController {
   display::PageId activeScreen_;
   uint8_t activeScreenIndex_ = 0;
   MenuState state_;
+  MenuModel model_;
+  MenuSession session_;
 };
 
 }  // namespace ui
@@ -0,0 +1,272 @@
+#include "metrics.h"
+
+#include <ctype.h>
+
+namespace metrics {
+namespace {
+
+// Constant-initialized, so it is ready before any metric's constructor runs.
+Metric* registryHead = nullptr;
+uint32_t droppedLines = 0;
+
+bool isNameChar(char c, bool first) {
+  return isalpha(static_cast<unsigned char>(c)) || c == '_' || c == ':' ||
+         (!first && isdigit(static_cast<unsigned char>(c)));
+}
+
+// Skips a metric or label name; nullptr if there is none.
+const char* skipName(const char* p) {
+  if (!isNameChar(*p, true)) {
+    return nullptr;
+  }
+  while (isNameChar(*p, false)) {
+    ++p;
+  }
+  return p;
+}
+
+// One line of the text format: a HELP or TYPE comment, or
+// name{label="value",...} value.
+bool validLine(const char* line) {
+  if (strncmp(line, "# HELP ", 7) == 0 || strncmp(line, "# TYPE ", 7) == 0) {
+    bool type = line[2] == 'T';
+    const char* p = skipName(line + 7);
+    if (p == nullptr || *p != ' ' || p[1] == '\0') {
+      return false;
+    }
+    return !type || strcmp(p + 1, "counter") == 0 || strcmp(p + 1, "gauge") == 0 ||
+           strcmp(p + 1, "histogram") == 0;
+  }
+  const char* p = skipName(line);
+  if (p == nullptr) {
+    return false;
+  }
+  if (*p == '{') {
+    ++p;
+    while (*p != '}') {
+      p = skipName(p);
+      if (p == nullptr || p[0] != '=' || p[1] != '"') {
+        return false;
+      }
+      p = strchr(p + 2, '"');
+      if (p == nullptr) {
+        return false;
+      }
+      ++p;
+      if (*p == ',') {
+        ++p;
+      } else if (*p != '}') {
+        return false;
+      }
+    }
+    ++p;
+  }
+  if (*p != ' ' || p[1] == '\0') {
+    return false;
+  }
+  ++p;
+  if (strcmp(p, "NaN") == 0 || strcmp(p, "+Inf") == 0 || strcmp(p, "-Inf") == 0) {
+    return true;
+  }
+  char* end = nullptr;
+  strtod(p, &end);
+  return end != p && *end == '\0';
+}
+
+// Splits rendered text into lines and validates each one.
+class LineChecker : public Print {
+ public:
+  explicit LineChecker(Print* report) : report_(report) {}
+
+  size_t write(uint8_t c) override {
+    if (c != '\n') {
+      if (length_ < sizeof(line_) - 1) {
+        line_[length_++] = static_cast<char>(c);
+      } else {
+        overlong_ = true;
+      }
+      return 1;
+    }
+    line_[length_] = '\0';
+    ++lines_;
+    if (overlong_ || !validLine(line_)) {
+      ++errors_;
+      if (report_ != nullptr) {
+        report_->printf("[metrics] bad line: %s%s\n", line_, overlong_ ? "..." : "");
+      }
+    }
+    length_ = 0;
+    overlong_ = false;
+    return 1;
+  }
+  using Print::write;
+
+  // A trailing line without its newline counts as an error too.
+  uint32_t finish() {
+    if (length_ > 0) {
+      write('\n');
+      ++errors_;
+    }
+    return errors_;
+  }
+  uint32_t lines() const { return lines_; }
+
+ private:
+  Print* report_;
+  char line_[256];
+  size_t length_ = 0;
+  bool overlong_ = false;
+  uint32_t lines_ = 0;
+  uint32_t errors_ = 0;
+};
+
+// Formats one sample line into a small stack buffer and writes it out. A
+// line that does not fit is dropped whole rather than cut, which would leave
+// the scrape unparseable; checkAll() reports it.
+template <typename... Args>
+void printLine(Print& out, const char* format, Args... args) {
+  char line[128];
+  int length = snprintf(line, sizeof(line), format, args...);
+  if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+    out.write(reinterpret_cast<const uint8_t*>(line), length);
+  } else {
+    ++droppedLines;
+  }
+}
+
+// Prometheus expects NaN rather than C's "nan".
+void printValue(Print& out, const char* name, float value) {
+  if (isnan(value)) {
+    printLine(out, "%s NaN\n", name);
+  } else {
+    printLine(out, "%s %.7g\n", name, static_cast<double>(value));
+  }
+}
+
+// Process-wide gauges that belong to no module.
+Gauge heapFree("plantey_heap_free_bytes", "Free heap", [] { return static_cast<float>(ESP.getFreeHeap()); });
+Gauge heapLargestBlock("plantey_heap_largest_free_block_bytes", "Largest allocatable heap block",
+                       [] { return static_cast<float>(ESP.getMaxAllocHeap()); });
+Gauge heapMinimum("plantey_heap_min_free_bytes", "Lowest free heap since boot",
+                  [] { return static_cast<float>(ESP.getMinFreeHeap()); });
+Gauge uptime("plantey_uptime_seconds", "Seconds since boot", [] { return millis() / 1000.0f; });
+
+}  // namespace
+
+namespace detail {
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+void renderHistogram(Print& out, const char* name, const uint32_t* bounds, const uint32_t* counts, size_t buckets,
+                     uint64_t sum) {
+  uint32_t cumulative = 0;
+  for (size_t i = 0; i < buckets; ++i) {
+    cumulative += counts[i];
+    printLine(out, "%s_bucket{le=\"%lu\"} %lu\n", name, static_cast<unsigned long>(bounds[i]),
+              static_cast<unsigned long>(cumulative));
+  }
+  cumulative += counts[buckets];
+  printLine(out, "%s_bucket{le=\"+Inf\"} %lu\n", name, static_cast<unsigned long>(cumulative));
+  printLine(out, "%s_sum %llu\n", name, static_cast<unsigned long long>(sum));
+  printLine(out, "%s_count %lu\n", name, static_cast<unsigned long>(cumulative));
+}
+}  // namespace detail
+
+Metric::Metric(const char* name, const char* help, const char* type)
+    : name_(name), help_(help), type_(type), next_(registryHead) {
+  registryHead = this;
+}
+
+// Written piecewise: name and help can be any length, unlike a formatted line.
+void Metric::renderHeader(Print& out) const {
+  out.print("# HELP ");
+  out.print(name_);
+  out.print(' ');
+  out.print(help_);
+  out.print("\n# TYPE ");
+  out.print(name_);
+  out.print(' ');
+  out.print(type_);
+  out.print('\n');
+}
+
+void renderAll(Print& out) {
+  for (const Metric* metric = registryHead; metric != nullptr; metric = metric->next_) {
+    metric->render(out);
+  }
+}
+
+bool checkAll(Print* report) {
+  uint32_t droppedBefore = droppedLines;
+  LineChecker checker(report);
+  renderAll(checker);
+  uint32_t errors = checker.finish();
+  uint32_t dropped = droppedLines - droppedBefore;
+  if (report != nullptr) {
+    report->printf("[metrics] %lu lines checked, %lu malformed, %lu too long to render\n",
+                   static_cast<unsigned long>(checker.lines()), static_cast<unsigned long>(errors),
+                   static_cast<unsigned long>(dropped));
+  }
+  return errors == 0 && dropped == 0;
+}
+
+void Counter::inc(uint32_t amount) {
+  portENTER_CRITICAL(&detail::lock);
+  value_ += amount;
+  portEXIT_CRITICAL(&detail::lock);
+}
+
+uint64_t Counter::value() const {
+  if (sample_ != nullptr) {
+    return sample_();
+  }
+  portENTER_CRITICAL(&detail::lock);
+  uint64_t value = value_;
+  portEXIT_CRITICAL(&detail::lock);
+  return value;
+}
+
+void Counter::render(Print& out) const {
+  renderHeader(out);
+  printLine(out, "%s %llu\n", name_, static_cast<unsigned long long>(value()));
+}
+
+void Gauge::render(Print& out) const {
+  renderHeader(out);
+  printValue(out, name_, sample_ != nullptr ? sample_() : value_);
+}
+
+void LabeledCounter::inc(const char* text, int number) {
+  portENTER_CRITICAL(&detail::lock);
+  Slot* target = &slots_[kSlots - 1];
+  for (Slot& slot : slots_) {
+    if (slot.text == nullptr) {
+      slot.text = &slot == &slots_[kSlots - 1] ? "overflow" : text;
+      slot.number = &slot == &slots_[kSlots - 1] ? 0 : number;
+      target = &slot;
+      break;
+    }
+    if (slot.number == number && (slot.text == text || strcmp(slot.text, text) == 0)) {
+      target = &slot;
+      break;
+    }
+  }
+  ++target->count;
+  portEXIT_CRITICAL(&detail::lock);
+}
+
+void LabeledCounter::render(Print& out) const {
+  Slot slots[kSlots];
+  portENTER_CRITICAL(&detail::lock);
+  memcpy(slots, slots_, sizeof(slots));
+  portEXIT_CRITICAL(&detail::lock);
+  renderHeader(out);
+  for (const Slot& slot : slots) {
+    if (slot.text == nullptr) {
+      break;
+    }
+    printLine(out, "%s{%s=\"%s\",%s=\"%d\"} %lu\n", name_, textLabel_, slot.text, numberLabel_, slot.number,
+              static_cast<unsigned long>(slot.count));
+  }
+}
+
+}  // namespace metrics
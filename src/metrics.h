@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace metrics {
+
+// Base of every metric. Each one is a static object that links itself into
+// the registry when constructed, so declaring it is all the registration
+// there is; nothing is allocated and the list lives in the objects.
+class Metric {
+ public:
+  Metric(const char* name, const char* help, const char* type);
+  Metric(const Metric&) = delete;
+  Metric& operator=(const Metric&) = delete;
+
+  // Writes this metric in the Prometheus text exposition format.
+  virtual void render(Print& out) const = 0;
+
+ protected:
+  ~Metric() = default;
+  void renderHeader(Print& out) const;
+
+  const char* name_;
+  const char* help_;
+  const char* type_;
+
+ private:
+  friend void renderAll(Print& out);
+  Metric* next_;
+};
+
+// Writes every registered metric; used for /metrics and the serial console.
+void renderAll(Print& out);
+// Renders everything and checks that each line is valid exposition text,
+// printing any bad ones and a summary to report if given. Run at boot.
+bool checkAll(Print* report = nullptr);
+
+// Counts with inc(), or reads a total some module already keeps from
+// sample() when scraped.
+class Counter final : public Metric {
+ public:
+  using Sampler = uint64_t (*)();
+
+  Counter(const char* name, const char* help, Sampler sample = nullptr)
+      : Metric(name, help, "counter"), sample_(sample) {}
+
+  void inc(uint32_t amount = 1);
+  uint64_t value() const;
+  void render(Print& out) const override;
+
+ private:
+  Sampler sample_;
+  uint64_t value_ = 0;
+};
+
+// A value read when scraped from sample(), or the last set() if it has none.
+class Gauge final : public Metric {
+ public:
+  using Sampler = float (*)();
+
+  Gauge(const char* name, const char* help, Sampler sample = nullptr)
+      : Metric(name, help, "gauge"), sample_(sample) {}
+
+  void set(float value) { value_ = value; }
+  void render(Print& out) const override;
+
+ private:
+  Sampler sample_;
+  volatile float value_ = NAN;
+};
+
+// Counters split by a (string, number) label pair, e.g. route and status.
+// Slots are claimed on first use; once all are taken, new pairs are counted
+// under the overflow label.
+class LabeledCounter final : public Metric {
+ public:
+  static constexpr uint8_t kSlots = 32;
+
+  LabeledCounter(const char* name, const char* help, const char* textLabel, const char* numberLabel)
+      : Metric(name, help, "counter"), textLabel_(textLabel), numberLabel_(numberLabel) {}
+
+  // text must stay valid for the whole program (a string literal or route path).
+  void inc(const char* text, int number);
+  void render(Print& out) const override;
+
+ private:
+  struct Slot {
+    const char* text = nullptr;
+    int number = 0;
+    uint32_t count = 0;
+  };
+
+  const char* textLabel_;
+  const char* numberLabel_;
+  Slot slots_[kSlots];
+};
+
+// Cumulative histogram over fixed upper bounds; the +Inf bucket is implied.
+template <size_t Buckets>
+class Histogram final : public Metric {
+ public:
+  Histogram(const char* name, const char* help, const uint32_t (&bounds)[Buckets])
+      : Metric(name, help, "histogram"), bounds_(bounds) {}
+
+  void observe(uint32_t value);
+  void render(Print& out) const override;
+
+ private:
+  const uint32_t (&bounds_)[Buckets];
+  uint32_t counts_[Buckets + 1] = {};
+  uint64_t sum_ = 0;
+};
+
+namespace detail {
+extern portMUX_TYPE lock;
+void renderHistogram(Print& out, const char* name, const uint32_t* bounds, const uint32_t* counts, size_t buckets,
+                     uint64_t sum);
+}  // namespace detail
+
+template <size_t Buckets>
+void Histogram<Buckets>::observe(uint32_t value) {
+  size_t bucket = 0;
+  while (bucket < Buckets && value > bounds_[bucket]) {
+    ++bucket;
+  }
+  portENTER_CRITICAL(&detail::lock);
+  ++counts_[bucket];
+  sum_ += value;
+  portEXIT_CRITICAL(&detail::lock);
+}
+
+template <size_t Buckets>
+void Histogram<Buckets>::render(Print& out) const {
+  uint32_t counts[Buckets + 1];
+  portENTER_CRITICAL(&detail::lock);
+  memcpy(counts, counts_, sizeof(counts));
+  uint64_t sum = sum_;
+  portEXIT_CRITICAL(&detail::lock);
+  renderHeader(out);
+  detail::renderHistogram(out, name_, bounds_, counts, Buckets, sum);
+}
+
+}  // namespace metrics
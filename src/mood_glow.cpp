@@ -0,0 +1,229 @@
+#include "mood_glow.h"
+
+#include <algorithm>
+#include <driver/ledc.h>
+
+#include "hardware_config.h"
+#include "logging.h"
+#include "motion_tables.h"
+
+namespace glow {
+namespace {
+
+constexpr const char* kLogTagGlow = "glow";
+constexpr ledc_mode_t kMode = LEDC_LOW_SPEED_MODE;
+constexpr ledc_timer_t kTimer = static_cast<ledc_timer_t>(hw::RGB_LEDC_TIMER);
+constexpr uint8_t kPins[3] = {hw::PIN_RGB_RED, hw::PIN_RGB_GREEN, hw::PIN_RGB_BLUE};
+constexpr ledc_channel_t kChannels[3] = {
+    static_cast<ledc_channel_t>(hw::RGB_LEDC_CHANNEL_RED),
+    static_cast<ledc_channel_t>(hw::RGB_LEDC_CHANNEL_GREEN),
+    static_cast<ledc_channel_t>(hw::RGB_LEDC_CHANNEL_BLUE),
+};
+constexpr uint16_t kUnit = motion::kUnitQ8;
+
+// Indexed by brain::MoodKind.
+constexpr GlowPattern kMoodPatterns[] = {
+    {{255, 170, 40}, 90, 1100, 1100},   // Joyful: warm gold, quick happy breath
+    {{40, 200, 80}, 70, 2600, 2600},    // Content: soft green, slow breath
+    {{255, 80, 0}, 20, 350, 900},       // Thirsty: amber pulse
+    {{30, 80, 255}, 60, 1800, 1800},    // Overwatered: deep blue
+    {{70, 20, 130}, 0, 4000, 4000},     // Sleepy: dim violet, fades out fully
+    {{210, 200, 120}, 80, 2000, 2000},  // SeekingLight: pale daylight
+    {{255, 220, 160}, 0, 0, 0},         // TooBright: steady, nothing to add
+    {{255, 30, 10}, 40, 600, 600},      // TooHot: red
+    {{90, 170, 255}, 60, 2200, 2200},   // TooCold: icy blue
+    {{200, 60, 200}, 50, 900, 1300},    // Curious: magenta
+};
+static_assert(sizeof(kMoodPatterns) / sizeof(GlowPattern) == static_cast<size_t>(brain::MoodKind::Curious) + 1,
+              "kMoodPatterns must list every MoodKind in order");
+
+// Brief red flash every three seconds.
+constexpr GlowPattern kCriticalBattery = {{255, 0, 0}, 0, 400, 2600};
+constexpr GlowPattern kDark = {{0, 0, 0}, 0, 0, 0};
+constexpr uint8_t kLowBatteryBrightnessQ8 = 110;
+
+// Perceived brightness is roughly quadratic in duty.
+uint16_t gammaDuty(uint32_t value8) {
+  return static_cast<uint16_t>((value8 * value8) >> (16 - hw::RGB_LEDC_RESOLUTION));
+}
+
+}  // namespace
+
+BatteryState batteryStateFor(const sensing::EnvironmentReadings& env) {
+  if (!env.batteryValid) {
+    return BatteryState::External;
+  }
+  if (env.batteryVolts <= hw::BATTERY_CRITICAL_V) {
+    return BatteryState::Critical;
+  }
+  if (env.batteryVolts <= hw::BATTERY_LOW_V) {
+    return BatteryState::Low;
+  }
+  return BatteryState::Ok;
+}
+
+const GlowPattern& patternFor(brain::MoodKind mood) {
+  return kMoodPatterns[static_cast<uint8_t>(mood)];
+}
+
+bool MoodGlow::begin() {
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = kMode;
+  timer.duty_resolution = static_cast<ledc_timer_bit_t>(hw::RGB_LEDC_RESOLUTION);
+  timer.timer_num = kTimer;
+  timer.freq_hz = hw::RGB_LEDC_FREQUENCY_HZ;
+  timer.clk_cfg = LEDC_AUTO_CLK;
+  if (ledc_timer_config(&timer) != ESP_OK) {
+    LOG_ERROR(kLogTagGlow, "LEDC timer %u unavailable", hw::RGB_LEDC_TIMER);
+    return false;
+  }
+
+  for (uint8_t i = 0; i < 3; ++i) {
+    ledc_channel_config_t channel = {};
+    channel.gpio_num = kPins[i];
+    channel.speed_mode = kMode;
+    channel.channel = kChannels[i];
+    channel.intr_type = LEDC_INTR_DISABLE;
+    channel.timer_sel = kTimer;
+    channel.duty = 0;
+    channel.hpoint = 0;
+    channel.flags.output_invert = hw::RGB_COMMON_ANODE ? 1 : 0;
+    if (ledc_channel_config(&channel) != ESP_OK) {
+      LOG_ERROR(kLogTagGlow, "LEDC channel %u unavailable", static_cast<unsigned>(kChannels[i]));
+      return false;
+    }
+  }
+
+  esp_err_t err = ledc_fade_func_install(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {  // already installed is fine
+    LOG_ERROR(kLogTagGlow, "LEDC fade service unavailable (%d)", err);
+    return false;
+  }
+
+  ready_ = true;
+  LOG_INFO(kLogTagGlow, "Initialized (pins %u/%u/%u, channels %u-%u)", hw::PIN_RGB_RED, hw::PIN_RGB_GREEN,
+           hw::PIN_RGB_BLUE, hw::RGB_LEDC_CHANNEL_RED, hw::RGB_LEDC_CHANNEL_BLUE);
+  retarget(millis(), kDefaultTransitionMs);
+  return true;
+}
+
+void MoodGlow::setMood(brain::MoodKind mood, uint32_t nowMs, uint16_t transitionMs) {
+  if (mood == mood_) {
+    return;
+  }
+  mood_ = mood;
+  retarget(nowMs, transitionMs);
+}
+
+void MoodGlow::setBattery(BatteryState state, uint32_t nowMs) {
+  if (state == battery_) {
+    return;
+  }
+  LOG_INFO(kLogTagGlow, "Battery state %u -> %u", static_cast<unsigned>(battery_), static_cast<unsigned>(state));
+  battery_ = state;
+  retarget(nowMs, kDefaultTransitionMs);
+}
+
+void MoodGlow::setOverride(const GlowPattern* pattern, uint32_t nowMs, uint16_t transitionMs) {
+  hasOverride_ = pattern != nullptr;
+  if (hasOverride_) {
+    override_ = *pattern;
+  }
+  retarget(nowMs, transitionMs);
+}
+
+void MoodGlow::setEnabled(bool enabled, uint32_t nowMs) {
+  if (enabled == enabled_) {
+    return;
+  }
+  enabled_ = enabled;
+  retarget(nowMs, kDefaultTransitionMs);
+}
+
+void MoodGlow::update(uint32_t nowMs) {
+  if (!ready_ || steady_) {
+    return;
+  }
+  if (segmentActive_ && static_cast<int32_t>(nowMs - segmentEndMs_) < 0) {
+    return;
+  }
+  segmentActive_ = false;
+
+  // Crossfade to the new pattern's peak, finishing exactly at the cycle start.
+  if (static_cast<int32_t>(cycleStartMs_ - nowMs) > 0) {
+    fadeTo(kUnit, nowMs, cycleStartMs_ - nowMs);
+    return;
+  }
+  if (pattern_.fallMs == 0 && pattern_.riseMs == 0) {
+    fadeTo(kUnit, nowMs, 0);
+    steady_ = true;
+    return;
+  }
+  uint32_t span = std::min<uint32_t>(kSegmentMs, msToNextTurn(nowMs));
+  fadeTo(levelAt(nowMs + span), nowMs, span);
+}
+
+void MoodGlow::retarget(uint32_t nowMs, uint16_t transitionMs) {
+  if (!enabled_) {
+    pattern_ = kDark;
+  } else if (hasOverride_) {
+    pattern_ = override_;
+  } else if (battery_ == BatteryState::Critical) {
+    pattern_ = kCriticalBattery;
+  } else {
+    pattern_ = patternFor(mood_);
+  }
+  brightnessQ8_ = battery_ == BatteryState::Low ? kLowBatteryBrightnessQ8 : 255;
+  // A fade already in flight cannot be retargeted; the crossfade picks up
+  // when it ends and still finishes at cycleStartMs_.
+  cycleStartMs_ = nowMs + transitionMs;
+  steady_ = false;
+  update(nowMs);
+}
+
+uint16_t MoodGlow::levelAt(uint32_t atMs) const {
+  uint32_t cycle = static_cast<uint32_t>(pattern_.fallMs) + pattern_.riseMs;
+  if (cycle == 0 || static_cast<int32_t>(cycleStartMs_ - atMs) >= 0) {
+    return kUnit;
+  }
+  uint32_t phase = (atMs - cycleStartMs_) % cycle;
+  int32_t swing = kUnit - pattern_.floorQ8;
+  if (phase < pattern_.fallMs) {
+    int16_t progress = static_cast<int16_t>((phase * kUnit) / pattern_.fallMs);
+    return static_cast<uint16_t>(kUnit - (swing * motion::easeQ8(motion::Ease::InOutSmooth, progress)) / kUnit);
+  }
+  int16_t progress = static_cast<int16_t>(((phase - pattern_.fallMs) * kUnit) / pattern_.riseMs);
+  return static_cast<uint16_t>(pattern_.floorQ8 + (swing * motion::easeQ8(motion::Ease::InOutSmooth, progress)) / kUnit);
+}
+
+uint32_t MoodGlow::msToNextTurn(uint32_t atMs) const {
+  uint32_t cycle = static_cast<uint32_t>(pattern_.fallMs) + pattern_.riseMs;
+  uint32_t phase = (atMs - cycleStartMs_) % cycle;
+  uint32_t remaining = phase < pattern_.fallMs ? pattern_.fallMs - phase : cycle - phase;
+  return remaining > 0 ? remaining : 1;
+}
+
+// Fade times are rounded down by the driver, so a segment never outlasts durationMs.
+void MoodGlow::fadeTo(uint16_t levelQ8, uint32_t nowMs, uint32_t durationMs) {
+  const uint8_t components[3] = {pattern_.color.r, pattern_.color.g, pattern_.color.b};
+  for (uint8_t i = 0; i < 3; ++i) {
+    uint32_t value = (static_cast<uint32_t>(components[i]) * levelQ8) >> 8;
+    value = (value * brightnessQ8_) >> 8;
+    uint16_t duty = gammaDuty(value);
+    if (duty == duty_[i]) {
+      continue;
+    }
+    if (durationMs == 0) {
+      ledc_set_duty(kMode, kChannels[i], duty);
+      ledc_update_duty(kMode, kChannels[i]);
+    } else {
+      ledc_set_fade_with_time(kMode, kChannels[i], duty, static_cast<int>(durationMs));
+      ledc_fade_start(kMode, kChannels[i], LEDC_FADE_NO_WAIT);
+    }
+    duty_[i] = duty;
+  }
+  segmentActive_ = durationMs > 0;
+  segmentEndMs_ = nowMs + durationMs;
+}
+
+}  // namespace glow
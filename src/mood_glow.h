@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "expression_logic.h"
+
+namespace glow {
+
+struct Rgb {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+// A breathing colour: peak -> floor over fallMs, back up over riseMs.
+// Both times 0 means a steady colour.
+struct GlowPattern {
+  Rgb color;
+  uint8_t floorQ8;  // lowest level of the breath, relative to the peak
+  uint16_t fallMs;
+  uint16_t riseMs;
+};
+
+enum class BatteryState : uint8_t { External, Ok, Low, Critical };
+
+BatteryState batteryStateFor(const sensing::EnvironmentReadings& env);
+const GlowPattern& patternFor(brain::MoodKind mood);
+
+// Drives the RGB LED on GPIO5-7 with the LEDC hardware fade engine. The CPU
+// only queues the next fade segment (at most every kSegmentMs); the duty ramps
+// themselves run in hardware. Segments follow an eased curve so a breath does
+// not look like a linear triangle.
+class MoodGlow {
+ public:
+  bool begin();
+
+  // Crossfades to the mood's pattern; the fade ends transitionMs from now so it
+  // lands together with the face's mood-shift clip.
+  void setMood(brain::MoodKind mood, uint32_t nowMs, uint16_t transitionMs);
+  // Low dims the glow; Critical replaces it with a slow red pulse.
+  void setBattery(BatteryState state, uint32_t nowMs);
+  // Pins a pattern over the mood and battery mapping; nullptr returns to them.
+  void setOverride(const GlowPattern* pattern, uint32_t nowMs, uint16_t transitionMs);
+  void setEnabled(bool enabled, uint32_t nowMs);
+  // Queues the next hardware fade once the current one has run out.
+  void update(uint32_t nowMs);
+
+  const GlowPattern& pattern() const { return pattern_; }
+  BatteryState battery() const { return battery_; }
+  bool overridden() const { return hasOverride_; }
+
+ private:
+  static constexpr uint16_t kSegmentMs = 200;
+  static constexpr uint16_t kDefaultTransitionMs = 300;
+
+  void retarget(uint32_t nowMs, uint16_t transitionMs);
+  uint16_t levelAt(uint32_t atMs) const;
+  uint32_t msToNextTurn(uint32_t atMs) const;
+  void fadeTo(uint16_t levelQ8, uint32_t nowMs, uint32_t durationMs);
+
+  bool ready_ = false;
+  bool enabled_ = true;
+  brain::MoodKind mood_ = brain::MoodKind::Content;
+  BatteryState battery_ = BatteryState::External;
+  bool hasOverride_ = false;
+  GlowPattern override_ = {};
+  GlowPattern pattern_ = {};
+  uint8_t brightnessQ8_ = 255;
+
+  uint32_t cycleStartMs_ = 0;     // the pattern is at its peak here
+  uint32_t segmentEndMs_ = 0;
+  bool segmentActive_ = false;
+  bool steady_ = false;           // a steady pattern reached its level
+  uint16_t duty_[3] = {};
+};
+
+}  // namespace glow
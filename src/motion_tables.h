@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+
+namespace motion {
+
+// Fixed-point helpers for the periodic face animation. Angles are 32-bit phase
+// accumulators (one full turn == 2^32) so they wrap for free, and every table
+// below is generated at compile time and lives in flash.
+
+constexpr uint8_t kSineIndexBits = 8;
+constexpr uint16_t kSineSteps = 1u << kSineIndexBits;
+constexpr int16_t kUnitQ8 = 256;
+
+constexpr uint8_t kEaseIndexBits = 6;
+constexpr uint16_t kEaseSteps = 1u << kEaseIndexBits;
+
+enum class Ease : uint8_t { Linear, InQuad, OutQuad, InOutSmooth };
+
+namespace detail {
+
+constexpr double kPi = 3.14159265358979323846;
+
+constexpr double taylorSin(double x) {
+  // Valid for x in [-pi, pi]; 12 terms keeps the error far below one Q15 LSB.
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 12; ++n) {
+    term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr int16_t roundToInt16(double value) {
+  return static_cast<int16_t>(value < 0.0 ? value - 0.5 : value + 0.5);
+}
+
+constexpr std::array<int16_t, kSineSteps + 1> makeSineTable() {
+  std::array<int16_t, kSineSteps + 1> table{};
+  for (uint16_t i = 0; i <= kSineSteps; ++i) {
+    double angle = 2.0 * kPi * static_cast<double>(i) / kSineSteps;
+    if (angle > kPi) {
+      angle -= 2.0 * kPi;
+    }
+    table[i] = roundToInt16(taylorSin(angle) * 32767.0);
+  }
+  return table;
+}
+
+constexpr double easeCurve(Ease curve, double t) {
+  switch (curve) {
+    case Ease::InQuad:
+      return t * t;
+    case Ease::OutQuad:
+      return t * (2.0 - t);
+    case Ease::InOutSmooth:
+      return t * t * (3.0 - 2.0 * t);
+    case Ease::Linear:
+    default:
+      return t;
+  }
+}
+
+constexpr std::array<int16_t, kEaseSteps + 1> makeEaseTable(Ease curve) {
+  std::array<int16_t, kEaseSteps + 1> table{};
+  for (uint16_t i = 0; i <= kEaseSteps; ++i) {
+    table[i] = roundToInt16(easeCurve(curve, static_cast<double>(i) / kEaseSteps) * kUnitQ8);
+  }
+  return table;
+}
+
+}  // namespace detail
+
+inline constexpr std::array<int16_t, kSineSteps + 1> kSineTable = detail::makeSineTable();
+inline constexpr std::array<int16_t, kEaseSteps + 1> kEaseInQuadTable = detail::makeEaseTable(Ease::InQuad);
+inline constexpr std::array<int16_t, kEaseSteps + 1> kEaseOutQuadTable = detail::makeEaseTable(Ease::OutQuad);
+inline constexpr std::array<int16_t, kEaseSteps + 1> kEaseInOutSmoothTable = detail::makeEaseTable(Ease::InOutSmooth);
+
+// Phase advance per millisecond for a wave with the given period.
+constexpr uint32_t phaseStepPerMs(uint32_t periodMs) {
+  return static_cast<uint32_t>((0x100000000ULL + periodMs / 2) / periodMs);
+}
+
+// Sine of a 32-bit phase in Q15 (-32767 .. 32767), linearly interpolated.
+inline int16_t sinQ15(uint32_t phase) {
+  constexpr uint8_t kFracBits = 32 - kSineIndexBits;
+  uint32_t index = phase >> kFracBits;
+  int32_t frac = static_cast<int32_t>((phase >> (kFracBits - 8)) & 0xFFu);
+  int32_t a = kSineTable[index];
+  int32_t b = kSineTable[index + 1];
+  return static_cast<int16_t>(a + (((b - a) * frac) >> 8));
+}
+
+// Sine of a 32-bit phase in Q8 (-256 .. 256).
+inline int16_t sinQ8(uint32_t phase) {
+  return static_cast<int16_t>((static_cast<int32_t>(sinQ15(phase)) * kUnitQ8) / 32767);
+}
+
+// Maps a Q8 progress value (clamped to 0 .. 256) through an easing curve.
+inline int16_t easeQ8(Ease curve, int16_t tQ8) {
+  if (tQ8 <= 0) return 0;
+  if (tQ8 >= kUnitQ8) return kUnitQ8;
+  if (curve == Ease::Linear) return tQ8;
+
+  const std::array<int16_t, kEaseSteps + 1>* table = &kEaseInOutSmoothTable;
+  if (curve == Ease::InQuad) {
+    table = &kEaseInQuadTable;
+  } else if (curve == Ease::OutQuad) {
+    table = &kEaseOutQuadTable;
+  }
+  constexpr uint8_t kFracBits = 8 - kEaseIndexBits;
+  uint16_t index = static_cast<uint16_t>(tQ8) >> kFracBits;
+  int32_t frac = tQ8 & ((1 << kFracBits) - 1);
+  int32_t a = (*table)[index];
+  int32_t b = (*table)[index + 1];
+  return static_cast<int16_t>(a + (((b - a) * frac) >> kFracBits));
+}
+
+// Scales a Q8 factor by an integer and truncates toward zero, matching a float
+// multiply followed by static_cast<int>.
+inline int16_t scaleQ8(int32_t valueQ8, int32_t scale) {
+  return static_cast<int16_t>((valueQ8 * scale) / kUnitQ8);
+}
+
+struct PhaseAccumulator {
+  explicit PhaseAccumulator(uint32_t periodMs) : stepPerMs(phaseStepPerMs(periodMs)) {}
+
+  void advance(uint32_t elapsedMs) { phase += elapsedMs * stepPerMs; }
+
+  uint32_t phase = 0;
+  uint32_t stepPerMs;
+};
+
+}  // namespace motion
@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "logging.h"
+#include "metrics.h"
 
 #if __has_include("secrets.h")
 #include "secrets.h"
@@ -19,6 +20,10 @@ const IPAddress kApIp(192, 168, 4, 1);
 const IPAddress kApGateway(192, 168, 4, 1);
 const IPAddress kApSubnet(255, 255, 255, 0);
 
+metrics::Counter staConnects("plantey_wifi_connects_total", "Station connections established, reconnects included");
+metrics::Gauge staRssi("plantey_wifi_rssi_dbm", "Station signal strength, NaN while disconnected",
+                       [] { return WiFi.isConnected() ? static_cast<float>(WiFi.RSSI()) : NAN; });
+
 const char* defaultApSsid() {
   return "PlanteyPet";
 }
@@ -81,6 +86,10 @@ bool NetworkManager::ensureConnected() {
   if (WiFi.isConnected()) {
     IPAddress ip = WiFi.localIP();
     statusMessage_ = String("STA ") + ip.toString();
+    if (!connected_) {
+      connected_ = true;
+      staConnects.inc();
+    }
     attemptingConnection_ = false;
     static IPAddress lastIp;
     if (lastIp != ip) {
@@ -90,6 +99,7 @@ bool NetworkManager::ensureConnected() {
     return true;
   }
 
+  connected_ = false;
   unsigned long now = millis();
   if (!attemptingConnection_ || (now - lastAttemptMs_) > kRetryIntervalMs) {
     WiFi.begin(secrets::WIFI_SSID, secrets::WIFI_PASSWORD);
@@ -21,6 +21,7 @@ class NetworkManager {
   String statusMessage_ = "WiFi idle";
   unsigned long lastAttemptMs_ = 0;
   bool attemptingConnection_ = false;
+  bool connected_ = false;  // as of the last ensureConnected()
   bool apStarted_ = false;
   bool apAnnounced_ = false;
 };
@@ -4,10 +4,13 @@
 #include <cmath>
 
 #include "logging.h"
+#include "metrics.h"
 
 namespace sensing {
 
 namespace {
+metrics::Counter samplesTaken("plantey_sensor_samples_total", "Sensor samples taken");
+
 float clampf(float value, float minValue, float maxValue) {
   return std::max(minValue, std::min(maxValue, value));
 }
@@ -22,6 +25,7 @@ void SensorSuite::begin() {
   dht_.begin();
   pinMode(hw::PIN_SOIL_SENSOR, INPUT);
   pinMode(hw::PIN_LDR_SENSOR, INPUT);
+  pinMode(hw::PIN_BATTERY_SENSE, INPUT);
   started_ = true;
   LOG_INFO("sensors", "Initialized (soil pin %u, light pin %u, DHT pin %u)", hw::PIN_SOIL_SENSOR, hw::PIN_LDR_SENSOR,
            hw::PIN_DHT);
@@ -31,6 +35,7 @@ EnvironmentReadings SensorSuite::sample() {
   if (!started_) {
     begin();
   }
+  samplesTaken.inc();
 
   EnvironmentReadings reading;
 
@@ -66,6 +71,15 @@ EnvironmentReadings SensorSuite::sample() {
     lightFiltered_ = (1.0f - hw::LIGHT_ALPHA) * lightFiltered_ + hw::LIGHT_ALPHA * lightRaw;
   }
 
+  float batteryVolts = analogReadMilliVolts(hw::PIN_BATTERY_SENSE) * hw::BATTERY_DIVIDER_RATIO / 1000.0f;
+  if (!batteryPrimed_) {
+    batteryFiltered_ = batteryVolts;
+    batteryPrimed_ = true;
+  } else {
+    batteryFiltered_ = (1.0f - hw::BATTERY_ALPHA) * batteryFiltered_ + hw::BATTERY_ALPHA * batteryVolts;
+  }
+  bool batteryValid = batteryFiltered_ >= hw::BATTERY_PRESENT_MIN_V;
+
   float soilPct = mapToPercent(static_cast<uint16_t>(soilFiltered_), soilWet_, soilDry_, true);
   float lightPct = mapToPercent(static_cast<uint16_t>(lightFiltered_), lightBright_, lightDark_, true);
 
@@ -77,6 +91,9 @@ EnvironmentReadings SensorSuite::sample() {
   lastReading_.lightPct = lightPct;
   lastReading_.lightValid = true;
 
+  lastReading_.batteryVolts = batteryFiltered_;
+  lastReading_.batteryValid = batteryValid;
+
   reading.soilRaw = soilRaw;
   reading.soilMoisturePct = soilPct;
   reading.soilValid = true;
@@ -85,6 +102,9 @@ EnvironmentReadings SensorSuite::sample() {
   reading.lightPct = lightPct;
   reading.lightValid = true;
 
+  reading.batteryVolts = batteryFiltered_;
+  reading.batteryValid = batteryValid;
+
   LOG_DEBUG("sensors", "Sample raw soil=%u light=%u filtered soil=%.1f%% light=%.1f%% temp=%.1fC hum=%.1f%%",
             soilRaw, lightRaw, soilPct, lightPct, reading.temperatureC, reading.humidityPct);
 
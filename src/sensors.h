@@ -19,6 +19,9 @@ struct EnvironmentReadings {
   uint16_t lightRaw = 0;
   float lightPct = NAN;
   bool lightValid = false;
+
+  float batteryVolts = NAN;
+  bool batteryValid = false;  // false when no cell is connected
 };
 
 class SensorSuite {
@@ -45,8 +48,10 @@ class SensorSuite {
 
   bool soilPrimed_ = false;
   bool lightPrimed_ = false;
+  bool batteryPrimed_ = false;
   float soilFiltered_ = 0.0f;
   float lightFiltered_ = 0.0f;
+  float batteryFiltered_ = 0.0f;
 
   EnvironmentReadings lastReading_;
 };
@@ -0,0 +1,52 @@
+#include "sprite_cache.h"
+
+namespace display {
+
+void captureXbm(const uint8_t* frame, int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t* xbm) {
+  uint8_t rowBytes = (width + 7) / 8;
+  for (uint8_t row = 0; row < height; ++row) {
+    int16_t fy = y + row;
+    if (fy < 0 || fy >= kFrameHeight) {
+      continue;
+    }
+    const uint8_t* page = frame + (fy >> 3) * kFrameWidth;
+    uint8_t mask = static_cast<uint8_t>(1u << (fy & 7));
+    uint8_t* out = xbm + row * rowBytes;
+    for (uint8_t col = 0; col < width; ++col) {
+      int16_t fx = x + col;
+      if (fx < 0 || fx >= kFrameWidth) {
+        continue;
+      }
+      if (page[fx] & mask) {
+        out[col >> 3] |= static_cast<uint8_t>(1u << (col & 7));
+      }
+    }
+  }
+}
+
+void blitXbm(uint8_t* frame, int16_t x, int16_t y, uint8_t width, uint8_t height, const uint8_t* xbm) {
+  uint8_t rowBytes = (width + 7) / 8;
+  for (uint8_t row = 0; row < height; ++row) {
+    int16_t fy = y + row;
+    if (fy < 0 || fy >= kFrameHeight) {
+      continue;
+    }
+    uint8_t* page = frame + (fy >> 3) * kFrameWidth;
+    uint8_t mask = static_cast<uint8_t>(1u << (fy & 7));
+    const uint8_t* in = xbm + row * rowBytes;
+    for (uint8_t byteIndex = 0; byteIndex < rowBytes; ++byteIndex) {
+      uint8_t bits = in[byteIndex];
+      // Only lit pixels are written, so transparent parts of the tile cost nothing.
+      while (bits != 0) {
+        uint8_t bit = static_cast<uint8_t>(__builtin_ctz(bits));
+        bits &= static_cast<uint8_t>(bits - 1);
+        int16_t fx = x + byteIndex * 8 + bit;
+        if (fx >= 0 && fx < kFrameWidth) {
+          page[fx] |= mask;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace display
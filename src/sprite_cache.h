@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstring>
+
+namespace display {
+
+constexpr int16_t kFrameWidth = 128;
+constexpr int16_t kFrameHeight = 64;
+
+// Copies a rectangle of the U8g2 full-frame buffer (page layout, LSB = top row)
+// into an XBM tile (row-major, LSB = leftmost pixel).
+void captureXbm(const uint8_t* frame, int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t* xbm);
+
+// ORs an XBM tile into the U8g2 full-frame buffer at (x, y), clipped to the panel.
+void blitXbm(uint8_t* frame, int16_t x, int16_t y, uint8_t width, uint8_t height, const uint8_t* xbm);
+
+// Fixed pool of XBM tiles keyed by a packed parameter tuple. When every slot is
+// taken the least recently used tile is recycled.
+template <uint8_t Width, uint8_t Height, uint8_t Slots>
+class SpritePool {
+ public:
+  static constexpr uint8_t kWidth = Width;
+  static constexpr uint8_t kHeight = Height;
+  static constexpr uint16_t kBytes = static_cast<uint16_t>((Width + 7) / 8) * Height;
+
+  const uint8_t* find(uint32_t key) {
+    for (uint8_t i = 0; i < Slots; ++i) {
+      if (slots_[i].used && slots_[i].key == key) {
+        slots_[i].lastUse = ++clock_;
+        ++hits_;
+        return slots_[i].bits;
+      }
+    }
+    ++misses_;
+    return nullptr;
+  }
+
+  // Claims a slot for key and returns its zeroed bitmap for the caller to fill.
+  uint8_t* allocate(uint32_t key) {
+    uint8_t victim = 0;
+    for (uint8_t i = 0; i < Slots; ++i) {
+      if (!slots_[i].used) {
+        victim = i;
+        break;
+      }
+      if (slots_[i].lastUse < slots_[victim].lastUse) {
+        victim = i;
+      }
+    }
+    Slot& slot = slots_[victim];
+    slot.used = true;
+    slot.key = key;
+    slot.lastUse = ++clock_;
+    std::memset(slot.bits, 0, sizeof(slot.bits));
+    return slot.bits;
+  }
+
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+
+ private:
+  struct Slot {
+    uint32_t key = 0;
+    uint32_t lastUse = 0;
+    bool used = false;
+    uint8_t bits[kBytes] = {};
+  };
+
+  Slot slots_[Slots];
+  uint32_t clock_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+};
+
+}  // namespace display
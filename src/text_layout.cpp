@@ -0,0 +1,169 @@
+#include "text_layout.h"
+
+#include <cstring>
+
+#include "input_digest.h"
+
+namespace display {
+namespace {
+
+constexpr uint16_t kMarqueeHoldMs = 1200;
+constexpr uint16_t kMarqueeMsPerPixel = 50;
+constexpr uint16_t kPageHoldMs = 3500;
+
+}  // namespace
+
+void GlyphMetrics::build(U8G2& device, const uint8_t* font) {
+  font_ = font;
+  device.setFont(font);
+  fallback_ = 0;
+  for (uint8_t code = kFirstGlyph; code <= kLastGlyph; ++code) {
+    int8_t advance = u8g2_GetGlyphWidth(device.getU8g2(), code);
+    advance_[code - kFirstGlyph] = advance > 0 ? static_cast<uint8_t>(advance) : 0;
+    if (advance_[code - kFirstGlyph] > fallback_) {
+      fallback_ = advance_[code - kFirstGlyph];
+    }
+  }
+}
+
+uint16_t GlyphMetrics::width(const char* text) const {
+  return text != nullptr ? width(text, static_cast<uint16_t>(std::strlen(text))) : 0;
+}
+
+uint16_t GlyphMetrics::width(const char* text, uint16_t length) const {
+  uint16_t total = 0;
+  for (uint16_t i = 0; i < length && text[i] != '\0'; ++i) {
+    total += advance(text[i]);
+  }
+  return total;
+}
+
+bool TextLayout::update(const char* const* paragraphs, uint8_t count, const GlyphMetrics& metrics,
+                        uint16_t maxWidth) {
+  if (count > kMaxParagraphs) {
+    count = kMaxParagraphs;
+  }
+  InputDigest digest;
+  digest.add(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(metrics.font())));
+  digest.add(static_cast<uint32_t>(maxWidth) | (static_cast<uint32_t>(count) << 16));
+  for (uint8_t i = 0; i < count; ++i) {
+    digest.add(paragraphs[i]);
+  }
+
+  for (uint8_t i = 0; i < count; ++i) {
+    paragraphs_[i] = paragraphs[i];
+  }
+  paragraphCount_ = count;
+  if (valid_ && digest.value() == digest_) {
+    return false;
+  }
+
+  digest_ = digest.value();
+  valid_ = true;
+  lineCount_ = 0;
+  for (uint8_t i = 0; i < count && lineCount_ < kMaxLines; ++i) {
+    if (paragraphs[i] != nullptr && paragraphs[i][0] != '\0') {
+      wrapParagraph(i, metrics, maxWidth);
+    }
+  }
+  ++rebuilds_;
+  return true;
+}
+
+void TextLayout::wrapParagraph(uint8_t paragraph, const GlyphMetrics& metrics, uint16_t maxWidth) {
+  const char* text = paragraphs_[paragraph];
+  uint16_t length = static_cast<uint16_t>(std::strlen(text));
+  uint16_t pos = 0;
+
+  while (pos < length && lineCount_ < kMaxLines) {
+    while (pos < length && text[pos] == ' ') {
+      ++pos;
+    }
+    if (pos >= length) {
+      break;
+    }
+
+    uint16_t lineStart = pos;
+    uint16_t lineWidth = 0;
+    int32_t lastSpace = -1;
+    uint16_t widthAtSpace = 0;
+    while (pos < length && text[pos] != '\n') {
+      uint8_t advance = metrics.advance(text[pos]);
+      if (lineWidth + advance > maxWidth || pos - lineStart >= 255) {
+        break;
+      }
+      if (text[pos] == ' ') {
+        lastSpace = pos;
+        widthAtSpace = lineWidth;
+      }
+      lineWidth += advance;
+      ++pos;
+    }
+
+    uint16_t lineEnd = pos;
+    if (pos < length && text[pos] != '\n') {
+      if (text[pos] == ' ') {
+        // The overflow landed exactly on a space.
+        ++pos;
+      } else if (lastSpace > static_cast<int32_t>(lineStart)) {
+        // Break at the last space that fit.
+        lineEnd = static_cast<uint16_t>(lastSpace);
+        lineWidth = widthAtSpace;
+        pos = lineEnd + 1;
+      } else if (pos == lineStart) {
+        // A glyph wider than the box: emit it alone so wrapping always advances.
+        lineWidth = metrics.advance(text[pos]);
+        lineEnd = ++pos;
+      }
+    } else if (pos < length) {
+      ++pos;  // consume the newline
+    }
+
+    TextSpan& span = lines_[lineCount_++];
+    span.paragraph = paragraph;
+    span.start = lineStart;
+    span.length = static_cast<uint8_t>(lineEnd - lineStart);
+    span.widthPx = static_cast<uint8_t>(lineWidth > 255 ? 255 : lineWidth);
+  }
+}
+
+void TextLayout::copyLine(uint8_t index, char* buffer, size_t size) const {
+  if (size == 0) {
+    return;
+  }
+  buffer[0] = '\0';
+  if (index >= lineCount_) {
+    return;
+  }
+  const TextSpan& span = lines_[index];
+  size_t length = span.length < size - 1 ? span.length : size - 1;
+  std::memcpy(buffer, paragraphs_[span.paragraph] + span.start, length);
+  buffer[length] = '\0';
+}
+
+uint16_t marqueeOffset(uint16_t textWidth, uint16_t boxWidth, uint32_t nowMs) {
+  if (textWidth <= boxWidth) {
+    return 0;
+  }
+  uint32_t travel = textWidth - boxWidth;
+  uint32_t scrollMs = travel * kMarqueeMsPerPixel;
+  uint32_t cycleMs = scrollMs + 2UL * kMarqueeHoldMs;
+  uint32_t t = nowMs % cycleMs;
+  if (t < kMarqueeHoldMs) {
+    return 0;
+  }
+  t -= kMarqueeHoldMs;
+  if (t >= scrollMs) {
+    return static_cast<uint16_t>(travel);
+  }
+  return static_cast<uint16_t>(t / kMarqueeMsPerPixel);
+}
+
+uint8_t pageForTime(uint8_t pageCount, uint32_t nowMs) {
+  if (pageCount <= 1) {
+    return 0;
+  }
+  return static_cast<uint8_t>((nowMs / kPageHoldMs) % pageCount);
+}
+
+}  // namespace display
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+namespace display {
+
+// Advance widths for printable ASCII in one font, read from U8g2 once so that
+// measuring and wrapping text never calls getStrWidth.
+class GlyphMetrics {
+ public:
+  void build(U8G2& device, const uint8_t* font);
+
+  const uint8_t* font() const { return font_; }
+  uint8_t advance(char c) const {
+    uint8_t code = static_cast<uint8_t>(c);
+    return (code >= kFirstGlyph && code <= kLastGlyph) ? advance_[code - kFirstGlyph] : fallback_;
+  }
+  uint16_t width(const char* text) const;
+  uint16_t width(const char* text, uint16_t length) const;
+
+ private:
+  static constexpr uint8_t kFirstGlyph = 32;
+  static constexpr uint8_t kLastGlyph = 126;
+
+  const uint8_t* font_ = nullptr;
+  uint8_t advance_[kLastGlyph - kFirstGlyph + 1] = {};
+  uint8_t fallback_ = 0;
+};
+
+// One wrapped line: a slice of one of the source paragraphs.
+struct TextSpan {
+  uint8_t paragraph = 0;
+  uint16_t start = 0;
+  uint8_t length = 0;
+  uint8_t widthPx = 0;
+};
+
+// Word-wrapped paragraphs. The spans are only recomputed when the text, the
+// font or the box width changes; otherwise update() is a digest comparison.
+// The paragraph pointers must stay valid until the layout is drawn.
+class TextLayout {
+ public:
+  static constexpr uint8_t kMaxParagraphs = 6;
+  static constexpr uint8_t kMaxLines = 16;
+
+  // Returns true when the layout had to be rebuilt.
+  bool update(const char* const* paragraphs, uint8_t count, const GlyphMetrics& metrics, uint16_t maxWidth);
+
+  uint8_t lineCount() const { return lineCount_; }
+  const TextSpan& line(uint8_t index) const { return lines_[index]; }
+  // Copies a wrapped line into a NUL-terminated buffer for drawStr.
+  void copyLine(uint8_t index, char* buffer, size_t size) const;
+  uint32_t rebuildCount() const { return rebuilds_; }
+
+ private:
+  void wrapParagraph(uint8_t paragraph, const GlyphMetrics& metrics, uint16_t maxWidth);
+
+  const char* paragraphs_[kMaxParagraphs] = {};
+  uint8_t paragraphCount_ = 0;
+  TextSpan lines_[kMaxLines];
+  uint8_t lineCount_ = 0;
+  uint32_t digest_ = 0;
+  bool valid_ = false;
+  uint32_t rebuilds_ = 0;
+};
+
+// Horizontal scroll offset for text wider than its box: hold at the start,
+// scroll to the end, hold, then jump back.
+uint16_t marqueeOffset(uint16_t textWidth, uint16_t boxWidth, uint32_t nowMs);
+
+// Page to show when cycling through pageCount pages on a fixed hold time.
+uint8_t pageForTime(uint8_t pageCount, uint32_t nowMs);
+
+}  // namespace display
@@ -0,0 +1,163 @@
+#include "wavetable_synth.h"
+
+#include <hal/sigmadelta_ll.h>
+#include <soc/gpio_sd_struct.h>
+
+#include "hardware_config.h"
+#include "motion_tables.h"
+
+namespace audio {
+namespace {
+
+constexpr uint8_t kWaveBits = 8;
+constexpr uint16_t kWaveSize = 1u << kWaveBits;
+constexpr uint32_t kTimerTickHz = 1000000;  // 80 MHz APB / 80
+constexpr int32_t kLevelMax = 0xFFFF;
+constexpr int32_t kAttackStep = kLevelMax / (4 * hw::SYNTH_SAMPLE_RATE_HZ / 1000);    // 4 ms
+constexpr int32_t kReleaseStep = kLevelMax / (30 * hw::SYNTH_SAMPLE_RATE_HZ / 1000);  // 30 ms
+// One voice at full level drives half the modulator range; two or more can clip.
+constexpr uint8_t kMixShift = 9;
+
+// Sine plus a little third harmonic, which the piezo reproduces more audibly
+// than a pure sine. Lives in DRAM so the ISR never touches flash.
+DRAM_ATTR int16_t gWave[kWaveSize];
+
+void buildWave() {
+  for (uint16_t i = 0; i < kWaveSize; ++i) {
+    uint32_t phase = static_cast<uint32_t>(i) << (32 - kWaveBits);
+    int32_t value = motion::sinQ15(phase) + (3 * motion::sinQ15(phase * 3)) / 10;
+    gWave[i] = static_cast<int16_t>((value * 10) / 13);
+  }
+}
+
+}  // namespace
+
+constexpr uint8_t WavetableSynth::kVoices;
+constexpr uint8_t SynthLoadStats::kBuckets;
+WavetableSynth* WavetableSynth::active_ = nullptr;
+
+bool WavetableSynth::begin() {
+  buildWave();
+  active_ = this;
+  sigmaDeltaSetup(hw::PIN_BUZZER, hw::SYNTH_SD_CHANNEL, hw::SYNTH_SD_CARRIER_HZ);
+  timer_ = timerBegin(hw::SYNTH_TIMER_NUM, hw::BUZZER_LEDC_CLOCK_HZ / kTimerTickHz, true);
+  if (timer_ == nullptr) {
+    return false;
+  }
+  timerAttachInterrupt(timer_, &WavetableSynth::onSample, true);
+  timerAlarmWrite(timer_, kTimerTickHz / hw::SYNTH_SAMPLE_RATE_HZ, true);
+  timerAlarmEnable(timer_);
+  return true;
+}
+
+void WavetableSynth::noteOn(uint8_t voice, uint32_t dividerQ8) {
+  if (voice >= kVoices) {
+    return;
+  }
+  if (dividerQ8 == 0) {
+    noteOff(voice);
+    return;
+  }
+  // Same pitch as the LEDC divider would give: f = clock * 256 / (2^res * divider).
+  uint32_t step = static_cast<uint32_t>(
+      (static_cast<uint64_t>(hw::BUZZER_LEDC_CLOCK_HZ) << (40 - hw::BUZZER_LEDC_RESOLUTION)) /
+      (static_cast<uint64_t>(hw::SYNTH_SAMPLE_RATE_HZ) * dividerQ8));
+  portENTER_CRITICAL(&lock_);
+  Voice& v = voices_[voice];
+  if (v.stage == Stage::Off) {
+    v.phase = 0;
+  }
+  v.step = step;
+  v.stage = Stage::Attack;
+  portEXIT_CRITICAL(&lock_);
+}
+
+void WavetableSynth::noteOff(uint8_t voice) {
+  if (voice >= kVoices) {
+    return;
+  }
+  portENTER_CRITICAL(&lock_);
+  if (voices_[voice].stage != Stage::Off) {
+    voices_[voice].stage = Stage::Release;
+  }
+  portEXIT_CRITICAL(&lock_);
+}
+
+void WavetableSynth::releaseAll() {
+  for (uint8_t i = 0; i < kVoices; ++i) {
+    noteOff(i);
+  }
+}
+
+SynthLoadStats WavetableSynth::loadStats() const {
+  SynthLoadStats stats;
+  uint64_t cycles[SynthLoadStats::kBuckets];
+  portENTER_CRITICAL(&lock_);
+  for (uint8_t i = 0; i < SynthLoadStats::kBuckets; ++i) {
+    cycles[i] = loadCycles_[i];
+    stats.samples[i] = loadSamples_[i];
+  }
+  portEXIT_CRITICAL(&lock_);
+
+  uint8_t highest = 0;
+  for (uint8_t i = 0; i < SynthLoadStats::kBuckets; ++i) {
+    if (stats.samples[i] > 0) {
+      stats.meanCycles[i] = static_cast<uint32_t>(cycles[i] / stats.samples[i]);
+      highest = i;
+    }
+  }
+  if (highest > 0 && stats.samples[0] > 0 && stats.meanCycles[highest] > stats.meanCycles[0]) {
+    stats.cyclesPerVoice = (stats.meanCycles[highest] - stats.meanCycles[0]) / highest;
+  }
+  return stats;
+}
+
+void IRAM_ATTR WavetableSynth::onSample() {
+  if (active_ != nullptr) {
+    active_->mix();
+  }
+}
+
+void IRAM_ATTR WavetableSynth::mix() {
+  uint32_t start = ESP.getCycleCount();
+  int32_t sum = 0;
+  uint8_t sounding = 0;
+  for (Voice& v : voices_) {
+    switch (v.stage) {
+      case Stage::Off:
+        continue;
+      case Stage::Attack:
+        v.levelQ16 += kAttackStep;
+        if (v.levelQ16 >= kLevelMax) {
+          v.levelQ16 = kLevelMax;
+          v.stage = Stage::Sustain;
+        }
+        break;
+      case Stage::Sustain:
+        break;
+      case Stage::Release:
+        v.levelQ16 -= kReleaseStep;
+        if (v.levelQ16 <= 0) {
+          v.levelQ16 = 0;
+          v.stage = Stage::Off;
+          continue;
+        }
+        break;
+    }
+    ++sounding;
+    v.phase += v.step;
+    int32_t sample = gWave[v.phase >> (32 - kWaveBits)];
+    sum += (sample * (v.levelQ16 >> 1)) >> 15;
+  }
+
+  int32_t duty = sum >> kMixShift;
+  if (duty > 127) duty = 127;
+  if (duty < -128) duty = -128;
+  sigmadelta_ll_set_duty(&SIGMADELTA, static_cast<sigmadelta_channel_t>(hw::SYNTH_SD_CHANNEL),
+                         static_cast<int8_t>(duty));
+
+  loadCycles_[sounding] += ESP.getCycleCount() - start;
+  ++loadSamples_[sounding];
+}
+
+}  // namespace audio
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace audio {
+
+// Per-voice CPU cost of the mixer, measured inside the sample ISR.
+struct SynthLoadStats {
+  static constexpr uint8_t kBuckets = 5;  // 0 .. 4 active voices
+  uint32_t samples[kBuckets] = {};
+  uint32_t meanCycles[kBuckets] = {};     // mean ISR cycles with that many voices sounding
+  uint32_t cyclesPerVoice = 0;            // marginal cost of one more voice
+};
+
+// Four-voice fixed-point wavetable synth. A general-purpose timer ISR mixes the
+// voices at SYNTH_SAMPLE_RATE_HZ and writes the sum to the sigma-delta modulator
+// on the buzzer pin, so chords sound at once instead of as an arpeggio.
+class WavetableSynth {
+ public:
+  static constexpr uint8_t kVoices = 4;
+
+  bool begin();
+  // dividerQ8 uses the LEDC divider encoding from MelodyStep; 0 releases the voice.
+  void noteOn(uint8_t voice, uint32_t dividerQ8);
+  void noteOff(uint8_t voice);
+  void releaseAll();
+
+  SynthLoadStats loadStats() const;
+
+ private:
+  enum class Stage : uint8_t { Off, Attack, Sustain, Release };
+
+  struct Voice {
+    uint32_t phase = 0;
+    uint32_t step = 0;
+    int32_t levelQ16 = 0;
+    Stage stage = Stage::Off;
+  };
+
+  static void onSample();
+  void mix();
+
+  static WavetableSynth* active_;
+
+  hw_timer_t* timer_ = nullptr;
+  // Written by tasks inside lock_, read by the ISR; the C3 is single core so
+  // masking interrupts is enough to keep a voice update atomic.
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  Voice voices_[kVoices];
+
+  uint64_t loadCycles_[SynthLoadStats::kBuckets] = {};
+  uint32_t loadSamples_[SynthLoadStats::kBuckets] = {};
+};
+
+}  // namespace audio
@@ -0,0 +1,231 @@
+#include "web_bench.h"
+
+#include <algorithm>
+#include <new>
+
+#include "alloc_counter.h"
+#include "generated/dashboard_gz.h"
+#include "logging.h"
+
+namespace web {
+namespace {
+constexpr const char* kLogTagBench = "bench";
+
+const char* methodName(HttpMethod method) {
+  switch (method) {
+    case HttpMethod::Get:
+      return "GET";
+    case HttpMethod::Post:
+      return "POST";
+    case HttpMethod::Options:
+      return "OPTIONS";
+    default:
+      return "?";
+  }
+}
+
+// Bucket bounds step through this series once per decade, about 25 % apart.
+constexpr uint8_t kDecadeSteps[] = {10, 12, 16, 20, 25, 32, 40, 50, 64, 80};
+constexpr uint8_t kStepsPerDecade = sizeof(kDecadeSteps);
+
+uint32_t bucketBoundUs(uint8_t bucket) {
+  uint32_t bound = kDecadeSteps[bucket % kStepsPerDecade];
+  for (uint8_t decade = bucket / kStepsPerDecade; decade > 0; --decade) {
+    bound *= 10;
+  }
+  return bound;
+}
+
+uint8_t bucketFor(uint32_t latencyUs) {
+  uint8_t bucket = 0;
+  while (bucket < LoadTest::kLatencyBuckets - 1 && latencyUs > bucketBoundUs(bucket)) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+// Nearest rank, reported as the upper bound of the bucket it falls in (the
+// slowest request for the last bucket, and never above it).
+uint32_t percentile(const uint16_t* buckets, uint32_t count, uint32_t maxUs, uint8_t percent) {
+  if (count == 0) {
+    return 0;
+  }
+  uint32_t rank = (count - 1) * percent / 100 + 1;
+  uint32_t seen = 0;
+  for (uint8_t bucket = 0; bucket < LoadTest::kLatencyBuckets - 1; ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      return std::min(bucketBoundUs(bucket), maxUs);
+    }
+  }
+  return maxUs;
+}
+}  // namespace
+
+// Roughly what the dashboard and a scraper send: mostly reads, some commands.
+const LoadTest::Scenario LoadTest::kScenarios[kScenarioCount] = {
+    {HttpMethod::Get, "/api/status", nullptr, nullptr},
+    {HttpMethod::Get, "/api/status", nullptr, "*"},
+    {HttpMethod::Post, "/api/plant", "{\"species\":\"Monstera\",\"fetch\":true}", nullptr},
+    {HttpMethod::Post, "/api/calibrate", "{\"target\":\"soilDry\"}", nullptr},
+    {HttpMethod::Post, "/api/display", "{\"playDemo\":true}", nullptr},
+    {HttpMethod::Post, "/api/batch",
+     "{\"commands\":[{\"type\":\"calibrate\",\"target\":\"soilDry\"},{\"type\":\"plant\",\"species\":\"Monstera\"}]}",
+     nullptr},
+    {HttpMethod::Post, "/api/profile/reset", nullptr, nullptr},
+    {HttpMethod::Get, "/metrics", nullptr, nullptr},
+    {HttpMethod::Get, dashboard::kPath, nullptr, nullptr},
+    {HttpMethod::Get, "/nope", nullptr, nullptr},
+};
+
+bool LoadTest::start(HttpServer& server, uint16_t requests) {
+  if (busy_.exchange(true)) {
+    return false;
+  }
+  server_ = &server;
+  requests_ = std::min<uint16_t>(std::max<uint16_t>(requests, 1), kMaxRequests);
+  finished_ = false;
+  if (!server.post(&LoadTest::runEntry, this)) {
+    busy_ = false;
+    return false;
+  }
+  return true;
+}
+
+void LoadTest::runEntry(void* context) {
+  static_cast<LoadTest*>(context)->run();
+}
+
+// Stands in for the socket: counts nothing itself (the response tallies the
+// flushed bytes) but samples the heap like the server's own flush does.
+bool LoadTest::sink(void* context, const char*, size_t) {
+  LoadTest& test = *static_cast<LoadTest*>(context);
+  test.heapLow_ = std::min(test.heapLow_, ESP.getFreeHeap());
+  return true;
+}
+
+void LoadTest::run() {
+  for (Result& result : results_) {
+    result = Result();
+  }
+  heapPeakBytes_ = 0;
+  // Only needed while the run lasts, so it is not kept resident.
+  char* tx = new (std::nothrow) char[HttpServer::kTxBufferSize];
+  noMemory_ = tx == nullptr;
+  if (noMemory_) {
+    LOG_ERROR(kLogTagBench, "No heap for a %u byte response buffer", static_cast<unsigned>(HttpServer::kTxBufferSize));
+    finished_ = true;
+    busy_ = false;
+    return;
+  }
+  running_ = true;
+  diag::trackAllocations(xTaskGetCurrentTaskHandle());
+  uint32_t startUs = micros();
+  for (uint16_t i = 0; i < requests_; ++i) {
+    runOne(kScenarios[i % kScenarioCount], results_[i % kScenarioCount], tx);
+  }
+  elapsedUs_ = micros() - startUs;
+  diag::trackAllocations(nullptr);
+  running_ = false;
+  delete[] tx;
+
+  LOG_INFO(kLogTagBench, "Handled %u requests in %lu ms", requests_, static_cast<unsigned long>(elapsedUs_ / 1000));
+  finished_ = true;
+  busy_ = false;
+}
+
+void LoadTest::runOne(const Scenario& scenario, Result& result, char* tx) {
+  HttpRequest request;
+  request.method = scenario.method;
+  request.path = scenario.path;
+  request.body = scenario.body;
+  request.bodyLength = scenario.body != nullptr ? strlen(scenario.body) : 0;
+  request.ifNoneMatch = scenario.ifNoneMatch;
+  request.acceptsGzip = true;  // as every browser does
+  request.http11 = true;
+
+  diag::AllocCounts allocBefore = diag::allocCounts();
+  uint32_t heapBefore = ESP.getFreeHeap();
+  heapLow_ = heapBefore;
+  uint32_t startUs = micros();
+
+  HttpResponse response(tx, HttpServer::kTxBufferSize, true);
+  response.setFlush(&LoadTest::sink, this);
+  server_->handle(request, response);
+  response.endChunked();
+  if (!response.sent() && !response.broken()) {
+    response.send(500, "application/json", "{\"error\":\"No response\"}");
+  }
+
+  uint32_t latencyUs = micros() - startUs;
+  heapLow_ = std::min(heapLow_, ESP.getFreeHeap());
+  diag::AllocCounts allocAfter = diag::allocCounts();
+
+  ++result.requests;
+  if (response.broken() || response.status() >= 500) {
+    ++result.errors;
+  }
+  result.lastStatus = response.status();
+  result.bytes += response.flushedBytes() + response.length() + response.staticLength();
+  result.allocCalls += allocAfter.calls - allocBefore.calls;
+  result.allocBytes += allocAfter.bytes - allocBefore.bytes;
+  result.maxUs = std::max(result.maxUs, latencyUs);
+  ++result.latency[bucketFor(latencyUs)];
+  heapPeakBytes_ = std::max(heapPeakBytes_, heapBefore - heapLow_);
+}
+
+void LoadTest::printReport(Print& out) const {
+  if (!finished()) {
+    out.println("[bench] no results yet");
+    return;
+  }
+  if (noMemory_) {
+    out.println("[bench] run aborted: not enough heap for the response buffer");
+    return;
+  }
+  uint32_t total = 0;
+  uint32_t errors = 0;
+  uint32_t bytes = 0;
+  uint32_t maxUs = 0;
+  for (const Result& result : results_) {
+    total += result.requests;
+    errors += result.errors;
+    bytes += result.bytes;
+    maxUs = std::max(maxUs, result.maxUs);
+  }
+  uint32_t elapsedUs = std::max<uint32_t>(elapsedUs_, 1);
+  out.printf("[bench] %lu requests in %lu ms: %lu req/s, mean %lu us, max %lu us, %lu bytes out, %lu errors, "
+             "heap peak %lu bytes\n",
+             static_cast<unsigned long>(total), static_cast<unsigned long>(elapsedUs / 1000),
+             static_cast<unsigned long>(static_cast<uint64_t>(total) * 1000000 / elapsedUs),
+             static_cast<unsigned long>(elapsedUs / std::max<uint32_t>(total, 1)), static_cast<unsigned long>(maxUs),
+             static_cast<unsigned long>(bytes), static_cast<unsigned long>(errors),
+             static_cast<unsigned long>(heapPeakBytes_));
+  bool allocs = diag::allocTrackingEnabled();
+  if (!allocs) {
+    out.println("[bench] allocations: n/a (build the -bench environment to count them)");
+  }
+  for (uint8_t i = 0; i < kScenarioCount; ++i) {
+    const Result& result = results_[i];
+    if (result.requests == 0) {
+      continue;
+    }
+    char allocText[40] = "";
+    if (allocs) {
+      snprintf(allocText, sizeof(allocText), ", %lu allocs (%lu B)/req",
+               static_cast<unsigned long>(result.allocCalls / result.requests),
+               static_cast<unsigned long>(result.allocBytes / result.requests));
+    }
+    char label[48];
+    snprintf(label, sizeof(label), "%s %s%s", methodName(kScenarios[i].method), kScenarios[i].path,
+             kScenarios[i].ifNoneMatch != nullptr ? " +etag" : "");
+    out.printf("[bench] %-36s n=%lu status=%d p50=%lu p99=%lu max=%lu us, %lu B/req%s\n", label,
+               static_cast<unsigned long>(result.requests), result.lastStatus,
+               static_cast<unsigned long>(percentile(result.latency, result.requests, result.maxUs, 50)),
+               static_cast<unsigned long>(percentile(result.latency, result.requests, result.maxUs, 99)),
+               static_cast<unsigned long>(result.maxUs), static_cast<unsigned long>(result.bytes / result.requests),
+               allocText);
+  }
+}
+
+}  // namespace web
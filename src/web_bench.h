@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "http_server.h"
+
+namespace web {
+
+// Drives the registered handlers with a fixed mix of requests, back to back
+// on the server task, through an in-memory response sink instead of sockets.
+// Measures what the handlers cost (latency, bytes, heap, allocations) while
+// the rest of the firmware keeps running. Commands parsed during a run are
+// validated but not queued (see running()).
+class LoadTest {
+ public:
+  static constexpr uint16_t kMaxRequests = 2000;
+  // Latency histogram per scenario: ten buckets per decade from 10 us to
+  // 800 ms, plus one for anything slower.
+  static constexpr uint8_t kLatencyBuckets = 51;
+
+  // False if a run is already under way or the server is not running.
+  bool start(HttpServer& server, uint16_t requests);
+  // True on the server task while the requests are being handled.
+  bool running() const { return running_.load(); }
+  // Set when a run completes; cleared by start().
+  bool finished() const { return finished_.load(); }
+  // Prints the last run's results, one "[bench]" line each.
+  void printReport(Print& out) const;
+
+ private:
+  struct Scenario {
+    HttpMethod method;
+    const char* path;
+    const char* body;
+    const char* ifNoneMatch;
+  };
+
+  struct Result {
+    uint32_t requests = 0;
+    uint32_t errors = 0;  // 5xx or a broken chunked body
+    uint32_t bytes = 0;
+    uint32_t allocCalls = 0;
+    uint32_t allocBytes = 0;
+    uint32_t maxUs = 0;
+    int lastStatus = 0;
+    uint16_t latency[kLatencyBuckets] = {};  // whole run; kMaxRequests fits
+  };
+
+  static constexpr uint8_t kScenarioCount = 10;
+  static const Scenario kScenarios[kScenarioCount];
+
+  static void runEntry(void* context);
+  static bool sink(void* context, const char* data, size_t length);
+  void run();
+  void runOne(const Scenario& scenario, Result& result, char* tx);
+
+  HttpServer* server_ = nullptr;
+  uint16_t requests_ = 0;
+  std::atomic<bool> busy_{false};  // from start() until the run completes
+  std::atomic<bool> running_{false};
+  std::atomic<bool> finished_{false};
+  bool noMemory_ = false;  // the last run could not get its response buffer
+  uint32_t heapLow_ = 0;
+  uint32_t elapsedUs_ = 0;
+  uint32_t heapPeakBytes_ = 0;
+  Result results_[kScenarioCount];
+};
+
+}  // namespace web
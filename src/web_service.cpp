@@ -1,54 +1,122 @@
 #include "web_service.h"
 
 #include <WiFi.h>
+#include <strings.h>
 
+#include "generated/dashboard_gz.h"
+#include "input_digest.h"
+#include "metrics.h"
 #include "plant_profile.h"
 #include "logging.h"
 
 namespace web {
 
 namespace {
-void addCorsHeaders(WebServer& server) {
-  server.sendHeader("Access-Control-Allow-Origin", "*");
-  server.sendHeader("Access-Control-Allow-Methods", "GET,POST,OPTIONS");
-  server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
-}
+constexpr uint16_t kHttpPort = 80;
 
-ui::CalibrationTarget parseCalibrationTarget(const String& name) {
-  if (name.equalsIgnoreCase("soilDry")) return ui::CalibrationTarget::SoilDry;
-  if (name.equalsIgnoreCase("soilWet")) return ui::CalibrationTarget::SoilWet;
-  if (name.equalsIgnoreCase("lightDark")) return ui::CalibrationTarget::LightDark;
-  if (name.equalsIgnoreCase("lightBright")) return ui::CalibrationTarget::LightBright;
+ui::CalibrationTarget parseCalibrationTarget(const char* name) {
+  if (strcasecmp(name, "soilDry") == 0) return ui::CalibrationTarget::SoilDry;
+  if (strcasecmp(name, "soilWet") == 0) return ui::CalibrationTarget::SoilWet;
+  if (strcasecmp(name, "lightDark") == 0) return ui::CalibrationTarget::LightDark;
+  if (strcasecmp(name, "lightBright") == 0) return ui::CalibrationTarget::LightBright;
   return ui::CalibrationTarget::None;
 }
+
+// A strong validator for the body, so a 304 stays correct across reboots.
+void formatEtag(char* out, size_t length, const char* body, size_t bodyLength) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < bodyLength; ++i) {
+    hash ^= static_cast<uint8_t>(body[i]);
+    hash *= 16777619UL;
+  }
+  snprintf(out, length, "\"%08lx\"", static_cast<unsigned long>(hash));
+}
+
+bool etagMatches(const char* ifNoneMatch, const char* etag) {
+  return ifNoneMatch != nullptr && (strcmp(ifNoneMatch, "*") == 0 || strstr(ifNoneMatch, etag) != nullptr);
+}
+
+// Tenths, so noise below the displayed precision does not become an event.
+int16_t toTenths(float value) {
+  return static_cast<int16_t>(lroundf(value * 10.0f));
+}
+
+const char* calibrationTargetName(ui::CalibrationTarget target) {
+  switch (target) {
+    case ui::CalibrationTarget::SoilDry:
+      return "soilDry";
+    case ui::CalibrationTarget::SoilWet:
+      return "soilWet";
+    case ui::CalibrationTarget::LightDark:
+      return "lightDark";
+    case ui::CalibrationTarget::LightBright:
+      return "lightBright";
+    case ui::CalibrationTarget::None:
+    default:
+      return "none";
+  }
+}
+
+class MutexLock {
+ public:
+  explicit MutexLock(SemaphoreHandle_t mutex) : mutex_(mutex) { xSemaphoreTake(mutex_, portMAX_DELAY); }
+  ~MutexLock() { xSemaphoreGive(mutex_); }
+
+ private:
+  SemaphoreHandle_t mutex_;
+};
+using SnapshotLock = MutexLock;
+using CommandLock = MutexLock;
 }  // namespace
 
 constexpr const char* kLogTagWeb = "web";
 
 void WebService::begin() {
-  server_.on("/", HTTP_GET, std::bind(&WebService::handleRoot, this));
-  server_.on("/api/status", HTTP_GET, std::bind(&WebService::handleStatus, this));
-  server_.on("/api/plant", HTTP_POST, std::bind(&WebService::handlePlantPost, this));
-  server_.on("/api/calibrate", HTTP_POST, std::bind(&WebService::handleCalibratePost, this));
-  server_.on("/api/display", HTTP_POST, std::bind(&WebService::handleDisplayPost, this));
-  server_.on("/api/profile/reset", HTTP_POST, std::bind(&WebService::handleProfileReset, this));
-  server_.onNotFound(std::bind(&WebService::handleNotFound, this));
-  server_.on("/api/status", HTTP_OPTIONS, std::bind(&WebService::handleOptions, this));
-  server_.on("/api/plant", HTTP_OPTIONS, std::bind(&WebService::handleOptions, this));
-  server_.on("/api/calibrate", HTTP_OPTIONS, std::bind(&WebService::handleOptions, this));
-  server_.on("/api/display", HTTP_OPTIONS, std::bind(&WebService::handleOptions, this));
-  server_.on("/api/profile/reset", HTTP_OPTIONS, std::bind(&WebService::handleOptions, this));
-  server_.begin();
-  LOG_INFO(kLogTagWeb, "Web service started on port 80");
+  snapshotLock_ = xSemaphoreCreateMutex();
+  commandLock_ = xSemaphoreCreateMutex();
+  commands_ = xQueueCreate(kCommandQueueLength, sizeof(Command));
+  if (snapshotLock_ == nullptr || commandLock_ == nullptr || commands_ == nullptr) {
+    LOG_ERROR(kLogTagWeb, "Cannot allocate web service state");
+    return;
+  }
+
+  server_.on(HttpMethod::Get, "/", &WebService::route<&WebService::handleRoot>, this);
+  server_.on(HttpMethod::Get, dashboard::kPath, &WebService::route<&WebService::handleDashboard>, this);
+  server_.on(HttpMethod::Get, "/api/status", &WebService::route<&WebService::handleStatus>, this);
+  server_.on(HttpMethod::Get, "/api/stream", &WebService::route<&WebService::handleStream>, this);
+  server_.on(HttpMethod::Get, "/metrics", &WebService::route<&WebService::handleMetrics>, this);
+  server_.on(HttpMethod::Post, "/api/plant", &WebService::route<&WebService::handlePlantPost>, this);
+  server_.on(HttpMethod::Post, "/api/calibrate", &WebService::route<&WebService::handleCalibratePost>, this);
+  server_.on(HttpMethod::Post, "/api/display", &WebService::route<&WebService::handleDisplayPost>, this);
+  server_.on(HttpMethod::Post, "/api/profile/reset", &WebService::route<&WebService::handleProfileReset>, this);
+  server_.on(HttpMethod::Post, "/api/batch", &WebService::route<&WebService::handleBatchPost>, this);
+  server_.onNotFound(&WebService::route<&WebService::handleNotFound>, this);
+  server_.on(HttpMethod::Options, "/api/status", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/stream", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/plant", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/calibrate", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/display", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/profile/reset", &WebService::route<&WebService::handleOptions>, this);
+  server_.on(HttpMethod::Options, "/api/batch", &WebService::route<&WebService::handleOptions>, this);
+  if (server_.begin(kHttpPort)) {
+    LOG_INFO(kLogTagWeb, "Web service started on port %u", kHttpPort);
+  }
 }
 
 void WebService::loop() {
-  server_.handleClient();
+  if (commands_ == nullptr || commandLock_ == nullptr) {
+    return;
+  }
+  CommandLock lock(commandLock_);
+  Command command;
+  while (xQueueReceive(commands_, &command, 0) == pdTRUE) {
+    runCommand(command);
+  }
 }
 
 void WebService::setPresetList(const char* const* presets, uint8_t count) {
   presets_ = presets;
-  presetCount_ = count;
+  snapshot_.presetCount = count;
 }
 
 void WebService::updateState(const sensing::EnvironmentReadings& env,
@@ -57,230 +125,619 @@ void WebService::updateState(const sensing::EnvironmentReadings& env,
                              bool fetchInProgress,
                              uint8_t presetIndex,
                              uint8_t presetCount) {
-  lastEnv_ = env;
-  lastStatus_ = status;
-  speciesQuery_ = speciesQuery;
-  fetchInProgress_ = fetchInProgress;
-  presetIndex_ = presetIndex;
-  presetCount_ = presetCount;
+  if (snapshotLock_ == nullptr) {
+    return;
+  }
+  const plant::PlantProfile* profile =
+      status.profile != nullptr && status.profile->valid ? status.profile : nullptr;
+  bool staConnected = network_ != nullptr && network_->isConnected();
+
+  // Called every loop pass; only a change in what /api/status shows costs a copy.
+  display::InputDigest digest;
+  digest.add(static_cast<uint32_t>(env.soilValid) | (static_cast<uint32_t>(env.lightValid) << 1) |
+             (static_cast<uint32_t>(env.climateValid) << 2) | (static_cast<uint32_t>(fetchInProgress) << 3) |
+             (static_cast<uint32_t>(staConnected) << 4) | (static_cast<uint32_t>(presetIndex) << 8) |
+             (static_cast<uint32_t>(presetCount) << 16));
+  digest.add(env.soilMoisturePct, 100.0f);
+  digest.add(env.lightPct, 100.0f);
+  digest.add(env.temperatureC, 100.0f);
+  digest.add(env.humidityPct, 100.0f);
+  digest.add(status.wifiStatus);
+  digest.add(status.profileStatus);
+  digest.add(speciesQuery);
+  digest.add(profile != nullptr ? profile->generatedAtEpoch : 0);
+  digest.add(profile != nullptr ? profile->speciesQuery.c_str() : nullptr);
+  if (digest.value() == stateDigest_ && snapshot_.version != 0) {
+    return;
+  }
+  stateDigest_ = digest.value();
+
+  // Network details change with the connection state, which the digest covers.
+  String staIp = staConnected ? WiFi.localIP().toString() : String();
+  String apIp = WiFi.softAPIP().toString();
+  String apSsid = WiFi.softAPSSID();
+
+  SnapshotLock lock(snapshotLock_);
+  ++snapshot_.version;
+  snapshot_.env = env;
+  snapshot_.staConnected = staConnected;
+  snapshot_.staIp = staIp;
+  snapshot_.apIp = apIp;
+  snapshot_.apSsid = apSsid;
+  snapshot_.wifiStatus = status.wifiStatus;
+  snapshot_.profileStatus = status.profileStatus;
+  snapshot_.speciesQuery = speciesQuery;
+  snapshot_.fetchInProgress = fetchInProgress;
+  snapshot_.presetIndex = presetIndex;
+  snapshot_.presetCount = presetCount;
+  snapshot_.hasProfile = profile != nullptr;
+  if (profile != nullptr) {
+    snapshot_.speciesCommonName = profile->speciesCommonName;
+    snapshot_.speciesLatinName = profile->speciesLatinName;
+    snapshot_.soilMin = profile->soilTargetMinPct;
+    snapshot_.soilMax = profile->soilTargetMaxPct;
+    snapshot_.lightMin = profile->lightTargetMinPct;
+    snapshot_.lightMax = profile->lightTargetMaxPct;
+    snapshot_.comfortTempMin = profile->comfortTempMinC;
+    snapshot_.comfortTempMax = profile->comfortTempMaxC;
+    snapshot_.wateringIntervalHours = profile->wateringIntervalHours;
+  }
 }
 
-void WebService::handleRoot() {
-  addCorsHeaders(server_);
-  server_.send(200, "text/plain", "PlanteyPetC3 Web API. See /api/status.");
+// The dashboard's URL carries its content hash, so it can be cached forever;
+// only this redirect is revalidated, and a firmware update changes its target.
+void WebService::handleRoot(const HttpRequest&, HttpResponse& response) {
+  response.addHeader("Location", dashboard::kPath);
+  response.addHeader("Cache-Control", "no-cache");
+  response.send(302);
   LOG_DEBUG(kLogTagWeb, "Handled GET /");
 }
 
-void WebService::handleStatus() {
-  StaticJsonDocument<1536> doc;
-
-  JsonObject wifi = doc.createNestedObject("wifi");
-  wifi["status"] = lastStatus_.wifiStatus;
-  bool staConnected = network_ != nullptr && network_->isConnected();
-  wifi["staConnected"] = staConnected;
-  if (staConnected) {
-    wifi["staIp"] = WiFi.localIP().toString();
+// Sent straight from flash, pre-gzipped at build time. There is no identity
+// copy, so a client that refuses gzip gets a 406 instead.
+void WebService::handleDashboard(const HttpRequest& request, HttpResponse& response) {
+  response.addHeader("Vary", "Accept-Encoding");
+  if (!request.acceptsGzip) {
+    response.send(406, "text/plain", "The dashboard is only served gzip-encoded.");
+    return;
   }
-  wifi["apIp"] = WiFi.softAPIP().toString();
-  wifi["apSsid"] = WiFi.softAPSSID();
+  response.addHeader("ETag", dashboard::kEtag);
+  response.addHeader("Cache-Control", "public, max-age=31536000, immutable");
+  if (etagMatches(request.ifNoneMatch, dashboard::kEtag)) {
+    response.send(304);
+    return;
+  }
+  response.addHeader("Content-Encoding", "gzip");
+  response.sendStatic(200, "text/html; charset=utf-8", dashboard::kGzip, dashboard::kGzipLength);
+  LOG_DEBUG(kLogTagWeb, "Handled GET %s", request.path);
+}
 
-  JsonObject plant = doc.createNestedObject("plant");
-  plant["speciesQuery"] = speciesQuery_;
-  plant["profileStatus"] = lastStatus_.profileStatus;
-  plant["fetchInProgress"] = fetchInProgress_;
-  plant["presetIndex"] = presetIndex_;
-  plant["presetCount"] = presetCount_;
-  plant["hasProfile"] = lastStatus_.profile != nullptr && lastStatus_.profile->valid;
-  if (lastStatus_.profile != nullptr && lastStatus_.profile->valid) {
-    const plant::PlantProfile& profile = *lastStatus_.profile;
-    plant["speciesCommonName"] = profile.speciesCommonName;
-    plant["speciesLatinName"] = profile.speciesLatinName;
-    plant["soilMin"] = profile.soilTargetMinPct;
-    plant["soilMax"] = profile.soilTargetMaxPct;
-    plant["lightMin"] = profile.lightTargetMinPct;
-    plant["lightMax"] = profile.lightTargetMaxPct;
-    plant["comfortTempMin"] = profile.comfortTempMinC;
-    plant["comfortTempMax"] = profile.comfortTempMaxC;
-    plant["wateringIntervalHours"] = profile.wateringIntervalHours;
-  }
-  if (presets_ != nullptr && presetCount_ > 0) {
-    JsonArray presets = plant.createNestedArray("presets");
-    for (uint8_t i = 0; i < presetCount_; ++i) {
-      presets.add(String(presets_[i]));
+// Every client polling the same state shares one serialization, and a client
+// that already has it gets a 304.
+void WebService::handleStatus(const HttpRequest& request, HttpResponse& response) {
+  uint32_t version;
+  {
+    SnapshotLock lock(snapshotLock_);
+    version = snapshot_.version;
+  }
+  if (statusLength_ == 0 || version != statusVersion_) {
+    StaticJsonDocument<kStatusDocCapacity> doc;
+    fillStatus(doc);
+    if (!cacheStatus(doc, version)) {
+      // Too big for the cache: stream it chunked, without an ETag.
+      sendJsonDocument(response, doc);
+      return;
     }
+  } else {
+    ++statusCacheHits_;
   }
 
-  JsonObject env = doc.createNestedObject("environment");
-  env["soilValid"] = lastEnv_.soilValid;
-  env["soilPct"] = lastEnv_.soilMoisturePct;
-  env["lightValid"] = lastEnv_.lightValid;
-  env["lightPct"] = lastEnv_.lightPct;
-  env["temperatureValid"] = lastEnv_.climateValid;
-  env["temperatureC"] = lastEnv_.temperatureC;
-  env["humidityPct"] = lastEnv_.humidityPct;
-
-  sendJsonDocument(doc);
+  response.addHeader("ETag", statusEtag_);
+  response.addHeader("Cache-Control", "no-cache");
+  if (etagMatches(request.ifNoneMatch, statusEtag_)) {
+    ++statusNotModified_;
+    response.send(304);
+    LOG_DEBUG(kLogTagWeb, "Handled GET /api/status -> 304");
+    return;
+  }
+  response.send(200, "application/json", statusJson_, statusLength_);
   LOG_DEBUG(kLogTagWeb, "Handled GET /api/status");
 }
 
-void WebService::handlePlantPost() {
-  StaticJsonDocument<1024> doc;
-  if (!parseJsonPayload(doc)) {
+// Holds the connection open; the server task drains this subscriber's queue
+// into it. The first event is a full sample so the client starts in sync.
+void WebService::handleStream(const HttpRequest&, HttpResponse& response) {
+  uint8_t id = 0;
+  if (!events_.subscribe(&id)) {
+    sendError(response, 503, "Too many stream subscribers");
+    LOG_WARN(kLogTagWeb, "Rejected /api/stream, %u subscribers", EventStream::kMaxSubscribers);
+    return;
+  }
+  resync_ = true;
+  response.addHeader("Cache-Control", "no-cache");
+  response.beginStream("text/event-stream", events_.streamFor(id));
+  if (!response.streaming()) {
+    events_.unsubscribe(id);
     return;
   }
+  LOG_DEBUG(kLogTagWeb, "Handled GET /api/stream");
+}
 
-  bool fetchRequested = false;
-  bool nextPreset = false;
+// Rendered chunk by chunk through the transmit buffer; nothing is kept between
+// scrapes. Prometheus scrapes over HTTP/1.1, so chunked encoding is available.
+void WebService::handleMetrics(const HttpRequest&, HttpResponse& response) {
+  if (!response.beginChunked(200, "text/plain; version=0.0.4")) {
+    sendError(response, 500, "Metrics need HTTP/1.1");
+    return;
+  }
+  HttpResponsePrint out(response);
+  metrics::renderAll(out);
+  response.endChunked();
+  LOG_DEBUG(kLogTagWeb, "Handled GET /metrics");
+}
 
-  if (doc.containsKey("species") && handlers_.setSpecies != nullptr) {
-    String species = doc["species"].as<String>();
-    handlers_.setSpecies(handlers_.context, species);
-    LOG_INFO(kLogTagWeb, "Set species via API to '%s'", species.c_str());
+void WebService::publishState(const sensing::EnvironmentReadings& env,
+                              brain::MoodKind mood,
+                              bool fetchInProgress,
+                              const String& fetchStatus) {
+  if (!events_.hasSubscribers()) {
+    return;
+  }
+  bool full = resync_.exchange(false);
+  publishSample(env, full);
+
+  if (full || mood != lastMood_) {
+    lastMood_ = mood;
+    StaticJsonDocument<64> doc;
+    doc["mood"] = brain::moodName(mood);
+    publishEvent("mood", doc);
   }
 
-  if (doc.containsKey("nextPreset")) {
-    nextPreset = doc["nextPreset"].as<bool>();
+  display::InputDigest digest;
+  digest.add(fetchStatus);
+  if (full || fetchInProgress != lastFetchInProgress_ || digest.value() != lastFetchDigest_) {
+    lastFetchInProgress_ = fetchInProgress;
+    lastFetchDigest_ = digest.value();
+    // Truncated so the event stays within EventStream::kEventBytes.
+    char text[64];
+    snprintf(text, sizeof(text), "%s", fetchStatus.c_str());
+    StaticJsonDocument<128> doc;
+    doc["inProgress"] = fetchInProgress;
+    doc["status"] = text;
+    publishEvent("fetch", doc);
   }
-  if (doc.containsKey("presetDelta")) {
-    int delta = doc["presetDelta"].as<int>();
-    if (delta > 0) {
-      nextPreset = true;
+}
+
+// Only fields that moved by at least the displayed 0.1 are sent.
+void WebService::publishSample(const sensing::EnvironmentReadings& env, bool full) {
+  static constexpr const char* kKeys[4] = {"soilPct", "lightPct", "temperatureC", "humidityPct"};
+  const bool valid[4] = {env.soilValid, env.lightValid, env.climateValid, env.climateValid};
+  const float values[4] = {env.soilMoisturePct, env.lightPct, env.temperatureC, env.humidityPct};
+
+  StaticJsonDocument<192> doc;
+  uint8_t validMask = 0;
+  for (uint8_t i = 0; i < 4; ++i) {
+    int16_t tenths = valid[i] ? toTenths(values[i]) : 0;
+    bool wasValid = (lastValid_ & (1u << i)) != 0;
+    if (valid[i]) {
+      validMask |= static_cast<uint8_t>(1u << i);
+    }
+    if (!full && valid[i] == wasValid && tenths == lastSample_[i]) {
+      continue;
     }
+    lastSample_[i] = tenths;
+    if (valid[i]) {
+      doc[kKeys[i]] = tenths / 10.0f;
+    } else {
+      doc[kKeys[i]] = nullptr;  // sensor dropped out
+    }
+  }
+  lastValid_ = validMask;
+  if (doc.size() > 0) {
+    publishEvent("sample", doc);
+  }
+}
+
+void WebService::publishCalibration(ui::CalibrationTarget target, uint16_t raw) {
+  if (!events_.hasSubscribers()) {
+    return;
   }
+  StaticJsonDocument<64> doc;
+  doc["target"] = calibrationTargetName(target);
+  doc["raw"] = raw;
+  publishEvent("calibration", doc);
+}
 
-  if ((doc.containsKey("fetch") && doc["fetch"].as<bool>()) || doc.containsKey("species") || nextPreset) {
-    fetchRequested = true;
+void WebService::publishEvent(const char* type, const JsonDocument& doc) {
+  char data[EventStream::kEventBytes];
+  if (serializeJson(doc, data, sizeof(data)) >= sizeof(data) - 1) {
+    LOG_WARN(kLogTagWeb, "Event '%s' too large", type);
+    return;
   }
+  events_.publish(type, data);
+}
+
+void WebService::fillStatus(JsonDocument& doc) {
+  SnapshotLock lock(snapshotLock_);
 
-  if (fetchRequested && handlers_.queueProfileFetch != nullptr) {
-    handlers_.queueProfileFetch(handlers_.context, nextPreset);
-    LOG_INFO(kLogTagWeb, "Queued profile fetch (nextPreset=%s)", nextPreset ? "true" : "false");
+  JsonObject wifi = doc.createNestedObject("wifi");
+  wifi["status"] = snapshot_.wifiStatus;
+  wifi["staConnected"] = snapshot_.staConnected;
+  if (snapshot_.staConnected) {
+    wifi["staIp"] = snapshot_.staIp;
   }
+  wifi["apIp"] = snapshot_.apIp;
+  wifi["apSsid"] = snapshot_.apSsid;
+
+  JsonObject plant = doc.createNestedObject("plant");
+  plant["speciesQuery"] = snapshot_.speciesQuery;
+  plant["profileStatus"] = snapshot_.profileStatus;
+  plant["fetchInProgress"] = snapshot_.fetchInProgress;
+  plant["presetIndex"] = snapshot_.presetIndex;
+  plant["presetCount"] = snapshot_.presetCount;
+  plant["hasProfile"] = snapshot_.hasProfile;
+  if (snapshot_.hasProfile) {
+    plant["speciesCommonName"] = snapshot_.speciesCommonName;
+    plant["speciesLatinName"] = snapshot_.speciesLatinName;
+    plant["soilMin"] = snapshot_.soilMin;
+    plant["soilMax"] = snapshot_.soilMax;
+    plant["lightMin"] = snapshot_.lightMin;
+    plant["lightMax"] = snapshot_.lightMax;
+    plant["comfortTempMin"] = snapshot_.comfortTempMin;
+    plant["comfortTempMax"] = snapshot_.comfortTempMax;
+    plant["wateringIntervalHours"] = snapshot_.wateringIntervalHours;
+  }
+  if (presets_ != nullptr && snapshot_.presetCount > 0) {
+    JsonArray presets = plant.createNestedArray("presets");
+    for (uint8_t i = 0; i < snapshot_.presetCount; ++i) {
+      presets.add(presets_[i]);
+    }
+  }
+
+  const sensing::EnvironmentReadings& readings = snapshot_.env;
+  JsonObject env = doc.createNestedObject("environment");
+  env["soilValid"] = readings.soilValid;
+  env["soilPct"] = readings.soilMoisturePct;
+  env["lightValid"] = readings.lightValid;
+  env["lightPct"] = readings.lightPct;
+  env["temperatureValid"] = readings.climateValid;
+  env["temperatureC"] = readings.temperatureC;
+  env["humidityPct"] = readings.humidityPct;
 
-  StaticJsonDocument<256> response;
-  response["queued"] = fetchRequested;
-  response["nextPreset"] = nextPreset;
-  sendJsonDocument(response);
-  LOG_DEBUG(kLogTagWeb, "Handled POST /api/plant");
 }
 
-void WebService::handleCalibratePost() {
-  if (handlers_.queueCalibration == nullptr) {
-    sendError(503, F("Calibration handler unavailable"));
-    LOG_WARN(kLogTagWeb, "Calibration handler unavailable");
-    return;
+bool WebService::cacheStatus(const JsonDocument& doc, uint32_t version) {
+  if (measureJson(doc) >= kStatusJsonCapacity) {
+    LOG_WARN(kLogTagWeb, "Status JSON exceeds %u bytes, not cached", static_cast<unsigned>(kStatusJsonCapacity));
+    statusLength_ = 0;
+    return false;
   }
-  StaticJsonDocument<256> doc;
-  if (!parseJsonPayload(doc)) {
+  statusLength_ = serializeJson(doc, statusJson_, kStatusJsonCapacity);
+  statusVersion_ = version;
+  formatEtag(statusEtag_, sizeof(statusEtag_), statusJson_, statusLength_);
+  ++statusBuilds_;
+  return true;
+}
+
+void WebService::handlePlantPost(const HttpRequest& request, HttpResponse& response) {
+  StaticJsonDocument<1024> doc;
+  if (!parseJsonPayload(request, response, doc)) {
     return;
   }
-  if (!doc.containsKey("target")) {
-    sendError(400, F("Missing target"));
+  sendSingleCommand(Command::Type::Plant, doc.as<JsonObjectConst>(), response);
+  LOG_DEBUG(kLogTagWeb, "Handled POST /api/plant");
+}
+
+void WebService::handleCalibratePost(const HttpRequest& request, HttpResponse& response) {
+  StaticJsonDocument<256> doc;
+  if (!parseJsonPayload(request, response, doc)) {
     return;
   }
-  String target = doc["target"].as<String>();
-  ui::CalibrationTarget calTarget = parseCalibrationTarget(target);
-  if (calTarget == ui::CalibrationTarget::None) {
-    sendError(400, F("Unknown calibration target"));
-    LOG_WARN(kLogTagWeb, "Unknown calibration target '%s'", target.c_str());
+  sendSingleCommand(Command::Type::Calibrate, doc.as<JsonObjectConst>(), response);
+}
+
+void WebService::handleDisplayPost(const HttpRequest& request, HttpResponse& response) {
+  StaticJsonDocument<256> doc;
+  if (!parseJsonPayload(request, response, doc)) {
     return;
   }
-  handlers_.queueCalibration(handlers_.context, calTarget);
-  StaticJsonDocument<128> response;
-  response["accepted"] = true;
-  response["target"] = target;
-  sendJsonDocument(response);
-  LOG_INFO(kLogTagWeb, "Handled POST /api/calibrate target=%s", target.c_str());
+  sendSingleCommand(Command::Type::Display, doc.as<JsonObjectConst>(), response);
+  LOG_DEBUG(kLogTagWeb, "Handled POST /api/display");
+}
+
+void WebService::handleProfileReset(const HttpRequest&, HttpResponse& response) {
+  sendSingleCommand(Command::Type::ResetProfile, JsonObjectConst(), response);
 }
 
-void WebService::handleDisplayPost() {
-  if (handlers_.adjustContrast == nullptr && handlers_.playDemo == nullptr) {
-    sendError(503, F("Display handlers unavailable"));
-    LOG_WARN(kLogTagWeb, "Display handlers unavailable");
+// Validates every command before queueing any, then queues them as one unit
+// so loop() runs them back to back, in order, with nothing in between.
+void WebService::handleBatchPost(const HttpRequest& request, HttpResponse& response) {
+  // The request document is reused for the result once the commands are
+  // parsed out of it, so only one of them is on the server task's stack.
+  StaticJsonDocument<1536> doc;
+  if (!parseJsonPayload(request, response, doc)) {
     return;
   }
-  StaticJsonDocument<256> doc;
-  if (!parseJsonPayload(doc)) {
+  JsonArrayConst list = doc.is<JsonArrayConst>() ? doc.as<JsonArrayConst>() : doc["commands"].as<JsonArrayConst>();
+  if (list.isNull() || list.size() == 0) {
+    sendError(response, 400, "Expected a non-empty commands array");
+    return;
+  }
+  if (list.size() > kMaxBatchCommands) {
+    char message[48];
+    snprintf(message, sizeof(message), "At most %u commands per batch", kMaxBatchCommands);
+    sendError(response, 400, message);
     return;
   }
 
-  bool acted = false;
-  String note;
-
-  if (doc.containsKey("contrastDelta")) {
-    int delta = doc["contrastDelta"].as<int>();
-    if (handlers_.adjustContrast != nullptr) {
-      handlers_.adjustContrast(handlers_.context, static_cast<int8_t>(delta));
+  Command* commands = batch_.commands;
+  CommandError* errors = batch_.errors;
+  bool* valid = batch_.valid;
+  uint8_t count = 0;
+  bool allValid = true;
+  for (JsonVariantConst item : list) {
+    commands[count] = Command();
+    errors[count] = CommandError();
+    valid[count] = false;
+    Command::Type type;
+    if (!parseCommandType(item["type"].as<const char*>(), &type)) {
+      errors[count] = {400, "Unknown or missing type"};
+    } else {
+      valid[count] = parseCommand(type, item.as<JsonObjectConst>(), commands[count], errors[count]);
     }
-    note = "Contrast control not supported on SH1106 OLED";
-    LOG_WARN(kLogTagWeb, "Contrast adjustment (%d) requested but unsupported", delta);
+    allValid = allValid && valid[count];
+    ++count;
   }
 
-  if (doc.containsKey("playDemo") && doc["playDemo"].as<bool>() && handlers_.playDemo != nullptr) {
-    handlers_.playDemo(handlers_.context);
-    acted = true;
-    LOG_INFO(kLogTagWeb, "Triggered demo chord via API");
+  if (allValid && !queueCommands(commands, count, response)) {
+    return;
+  }
+  // Nothing parsed out of doc points into it: species is copied and the
+  // error messages are literals.
+  doc.clear();
+  doc["applied"] = allValid;
+  JsonArray results = doc.createNestedArray("results");
+  for (uint8_t i = 0; i < count; ++i) {
+    JsonObject entry = results.createNestedObject();
+    if (!valid[i]) {
+      entry["ok"] = false;
+      entry["error"] = errors[i].message;
+      continue;
+    }
+    entry["ok"] = true;
+    entry["type"] = commandTypeName(commands[i].type);
+    describeCommand(commands[i], entry);
   }
+  sendJsonDocument(response, doc, allValid ? 200 : 400);
+  LOG_INFO(kLogTagWeb, "Handled POST /api/batch (%u commands, %s)", count, allValid ? "queued" : "rejected");
+}
 
-  StaticJsonDocument<128> response;
-  response["accepted"] = acted;
-  if (note.length() > 0) {
-    response["note"] = note;
+void WebService::handleNotFound(const HttpRequest& request, HttpResponse& response) {
+  sendError(response, 404, "Not found");
+  LOG_DEBUG(kLogTagWeb, "Unhandled request %s -> 404", request.path);
+}
+
+void WebService::handleOptions(const HttpRequest&, HttpResponse& response) {
+  response.send(204);
+  LOG_DEBUG(kLogTagWeb, "Handled CORS preflight");
+}
+
+// Commands change UI state, so they wait for loop() instead of running here.
+bool WebService::queueCommand(const Command& command, HttpResponse& response) {
+  return queueCommands(&command, 1, response);
+}
+
+// All or nothing: only this task adds commands, and loop() drains under
+// commandLock_, so it never sees part of a batch.
+bool WebService::queueCommands(const Command* commands, uint8_t count, HttpResponse& response) {
+  CommandLock lock(commandLock_);
+  if (loadTest_.running()) {
+    return true;  // a load test measures the handlers, it must not drive the UI
   }
-  sendJsonDocument(response);
-  LOG_DEBUG(kLogTagWeb, "Handled POST /api/display");
+  if (uxQueueSpacesAvailable(commands_) < count) {
+    sendError(response, 503, "Command queue full");
+    LOG_WARN(kLogTagWeb, "Command queue full, dropped %u command(s)", count);
+    return false;
+  }
+  for (uint8_t i = 0; i < count; ++i) {
+    xQueueSend(commands_, &commands[i], 0);
+  }
+  return true;
 }
 
-void WebService::handleProfileReset() {
-  if (handlers_.resetProfile == nullptr) {
-    sendError(503, F("Reset handler unavailable"));
-    LOG_WARN(kLogTagWeb, "Profile reset handler unavailable");
+// The single-command endpoints: same validation as /api/batch, same result
+// fields, but the errors keep their own status codes.
+void WebService::sendSingleCommand(Command::Type type, JsonObjectConst body, HttpResponse& response) {
+  Command command;
+  CommandError error;
+  if (!parseCommand(type, body, command, error)) {
+    sendError(response, error.code, error.message);
+    return;
+  }
+  if (hasEffect(command) && !queueCommand(command, response)) {
     return;
   }
-  handlers_.resetProfile(handlers_.context);
-  StaticJsonDocument<128> response;
-  response["reset"] = true;
-  sendJsonDocument(response);
-  LOG_WARN(kLogTagWeb, "Handled POST /api/profile/reset");
+  StaticJsonDocument<256> result;
+  JsonObject fields = result.to<JsonObject>();
+  describeCommand(command, fields);
+  sendJsonDocument(response, result);
+}
+
+bool WebService::parseCommandType(const char* name, Command::Type* type) {
+  if (name == nullptr) {
+    return false;
+  }
+  for (uint8_t i = 0; i < kCommandTypeCount; ++i) {
+    if (strcmp(name, commandTypeName(static_cast<Command::Type>(i))) == 0) {
+      *type = static_cast<Command::Type>(i);
+      return true;
+    }
+  }
+  return false;
 }
 
-void WebService::handleNotFound() {
-  sendError(404, F("Not found"));
-  LOG_DEBUG(kLogTagWeb, "Unhandled request -> 404");
+const char* WebService::commandTypeName(Command::Type type) {
+  static constexpr const char* kNames[kCommandTypeCount] = {"plant", "calibrate", "display", "profileReset"};
+  return kNames[static_cast<uint8_t>(type)];
 }
 
-void WebService::handleOptions() {
-  addCorsHeaders(server_);
-  server_.send(204);
-  LOG_DEBUG(kLogTagWeb, "Handled CORS preflight");
+bool WebService::parseCommand(Command::Type type, JsonObjectConst body, Command& command, CommandError& error) {
+  command = Command();
+  command.type = type;
+  switch (type) {
+    case Command::Type::Plant:
+      if (body.containsKey("species")) {
+        command.hasSpecies = true;
+        const char* species = body["species"].as<const char*>();
+        snprintf(command.species, sizeof(command.species), "%s", species != nullptr ? species : "");
+      }
+      if (body.containsKey("nextPreset")) {
+        command.nextPreset = body["nextPreset"].as<bool>();
+      }
+      if (body.containsKey("presetDelta") && body["presetDelta"].as<int>() > 0) {
+        command.nextPreset = true;
+      }
+      command.fetch = (body.containsKey("fetch") && body["fetch"].as<bool>()) || command.hasSpecies ||
+                      command.nextPreset;
+      return true;
+
+    case Command::Type::Calibrate: {
+      if (handlers_.queueCalibration == nullptr) {
+        error = {503, "Calibration handler unavailable"};
+        return false;
+      }
+      const char* target = body["target"].as<const char*>();
+      if (target == nullptr) {
+        error = {400, "Missing target"};
+        return false;
+      }
+      command.target = parseCalibrationTarget(target);
+      if (command.target == ui::CalibrationTarget::None) {
+        error = {400, "Unknown calibration target"};
+        LOG_WARN(kLogTagWeb, "Unknown calibration target '%s'", target);
+        return false;
+      }
+      return true;
+    }
+
+    case Command::Type::Display:
+      if (handlers_.adjustContrast == nullptr && handlers_.playDemo == nullptr) {
+        error = {503, "Display handlers unavailable"};
+        return false;
+      }
+      if (body.containsKey("contrastDelta")) {
+        command.hasContrast = true;
+        command.contrastDelta = static_cast<int8_t>(body["contrastDelta"].as<int>());
+      }
+      if (body.containsKey("playDemo") && body["playDemo"].as<bool>() && handlers_.playDemo != nullptr) {
+        command.playDemo = true;
+      }
+      return true;
+
+    case Command::Type::ResetProfile:
+      if (handlers_.resetProfile == nullptr) {
+        error = {503, "Reset handler unavailable"};
+        return false;
+      }
+      return true;
+  }
+  error = {400, "Unknown command"};
+  return false;
 }
 
-bool WebService::sendJsonResponse(const String& json, int code) {
-  addCorsHeaders(server_);
-  server_.send(code, "application/json", json);
-  return true;
+bool WebService::hasEffect(const Command& command) {
+  return command.type != Command::Type::Display || command.hasContrast || command.playDemo;
+}
+
+// The fields each endpoint has always answered with.
+void WebService::describeCommand(const Command& command, JsonObject result) {
+  switch (command.type) {
+    case Command::Type::Plant:
+      result["queued"] = command.fetch;
+      result["nextPreset"] = command.nextPreset;
+      break;
+    case Command::Type::Calibrate:
+      result["accepted"] = true;
+      result["target"] = calibrationTargetName(command.target);
+      break;
+    case Command::Type::Display:
+      result["accepted"] = command.playDemo;
+      if (command.hasContrast) {
+        result["note"] = "Contrast control not supported on SH1106 OLED";
+      }
+      break;
+    case Command::Type::ResetProfile:
+      result["reset"] = true;
+      break;
+  }
 }
 
-bool WebService::sendJsonDocument(const JsonDocument& doc, int code) {
-  String payload;
-  serializeJson(doc, payload);
-  return sendJsonResponse(payload, code);
+void WebService::runCommand(const Command& command) {
+  switch (command.type) {
+    case Command::Type::Plant:
+      if (command.hasSpecies && handlers_.setSpecies != nullptr) {
+        handlers_.setSpecies(handlers_.context, String(command.species));
+        LOG_INFO(kLogTagWeb, "Set species via API to '%s'", command.species);
+      }
+      if (command.fetch && handlers_.queueProfileFetch != nullptr) {
+        handlers_.queueProfileFetch(handlers_.context, command.nextPreset);
+        LOG_INFO(kLogTagWeb, "Queued profile fetch (nextPreset=%s)", command.nextPreset ? "true" : "false");
+      }
+      break;
+    case Command::Type::Calibrate:
+      if (handlers_.queueCalibration != nullptr) {
+        handlers_.queueCalibration(handlers_.context, command.target);
+        LOG_INFO(kLogTagWeb, "Calibration %s via API", calibrationTargetName(command.target));
+      }
+      break;
+    case Command::Type::Display:
+      if (command.hasContrast) {
+        LOG_WARN(kLogTagWeb, "Contrast adjustment (%d) requested but unsupported", command.contrastDelta);
+        if (handlers_.adjustContrast != nullptr) {
+          handlers_.adjustContrast(handlers_.context, command.contrastDelta);
+        }
+      }
+      if (command.playDemo && handlers_.playDemo != nullptr) {
+        handlers_.playDemo(handlers_.context);
+        LOG_INFO(kLogTagWeb, "Triggered demo chord via API");
+      }
+      break;
+    case Command::Type::ResetProfile:
+      if (handlers_.resetProfile != nullptr) {
+        handlers_.resetProfile(handlers_.context);
+        LOG_WARN(kLogTagWeb, "Profile reset via API");
+      }
+      break;
+  }
 }
 
-void WebService::sendError(int code, const __FlashStringHelper* message) {
-  StaticJsonDocument<256> doc;
-  doc["error"] = String(message);
-  sendJsonDocument(doc, code);
+// Serializes straight into the connection's transmit buffer. A body larger
+// than the buffer goes out chunked, one buffer at a time, so no response is
+// ever copied to the heap.
+bool WebService::sendJsonDocument(HttpResponse& response, const JsonDocument& doc, int code) {
+  size_t length = measureJson(doc);
+  char* body = response.beginBody(code, "application/json", length);
+  if (body != nullptr) {
+    serializeJson(doc, body, length + 1);
+    return true;
+  }
+  if (response.beginChunked(code, "application/json")) {
+    HttpResponsePrint out(response);
+    serializeJson(doc, out);
+    response.endChunked();
+    return !response.broken();
+  }
+  LOG_WARN(kLogTagWeb, "JSON response of %u bytes too large", static_cast<unsigned>(length));
+  response.send(500, "application/json", "{\"error\":\"Response too large\"}");
+  return false;
 }
 
-void WebService::sendError(int code, const String& message) {
+void WebService::sendError(HttpResponse& response, int code, const char* message) {
   StaticJsonDocument<256> doc;
   doc["error"] = message;
-  sendJsonDocument(doc, code);
+  sendJsonDocument(response, doc, code);
 }
 
 WebService service;
 
 }  // namespace web
-
-
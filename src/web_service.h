@@ -1,13 +1,20 @@
 #pragma once
 
 #include <Arduino.h>
-#include <WebServer.h>
 #include <ArduinoJson.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
+#include "event_stream.h"
+#include "expression_logic.h"
+#include "http_server.h"
 #include "menu_controller.h"
 #include "network_manager.h"
 #include "sensors.h"
 #include "display_manager.h"
+#include "web_bench.h"
 
 namespace web {
 
@@ -21,9 +28,14 @@ struct CommandHandlers {
   void (*resetProfile)(void* ctx) = nullptr;
 };
 
+// The HTTP server runs on its own task. Requests read a snapshot of the state
+// that updateState() publishes, and commands are queued and carried out by
+// loop(), so the handlers never touch UI state directly.
 class WebService {
  public:
+  // Call after setHandlers() and setPresetList(); requests are served from then on.
   void begin();
+  // Runs the commands queued by requests since the last call.
   void loop();
 
   void attachNetworkManager(const net::NetworkManager* network) { network_ = network; }
@@ -36,34 +48,157 @@ class WebService {
                    uint8_t presetIndex,
                    uint8_t presetCount);
 
+  // Sends /api/stream subscribers whatever changed since the last call:
+  // sample, mood and fetch events. Cheap, and a no-op without subscribers.
+  void publishState(const sensing::EnvironmentReadings& env,
+                    brain::MoodKind mood,
+                    bool fetchInProgress,
+                    const String& fetchStatus);
+  void publishCalibration(ui::CalibrationTarget target, uint16_t raw);
+
+  HttpStats stats() const { return server_.stats(); }
+  const EventStream& events() const { return events_; }
+  void resetStats() { server_.resetStats(); }
+  // /api/status bodies serialized, answered from the cache, and answered 304.
+  uint32_t statusBuilds() const { return statusBuilds_; }
+  uint32_t statusCacheHits() const { return statusCacheHits_; }
+  uint32_t statusNotModified() const { return statusNotModified_; }
+
+  // Runs requests through the handlers on the server task; see LoadTest.
+  bool startLoadTest(uint16_t requests) { return loadTest_.start(server_, requests); }
+  const LoadTest& loadTest() const { return loadTest_; }
+
  private:
-  void handleRoot();
-  void handleStatus();
-  void handlePlantPost();
-  void handleCalibratePost();
-  void handleDisplayPost();
-  void handleProfileReset();
-  void handleNotFound();
-  void handleOptions();
-
-  bool sendJsonResponse(const String& json, int code = 200);
-  bool sendJsonDocument(const JsonDocument& doc, int code = 200);
+  struct Command {
+    enum class Type : uint8_t { Plant, Calibrate, Display, ResetProfile };
+    Type type = Type::Plant;
+    bool hasSpecies = false;
+    char species[48] = {};
+    bool fetch = false;
+    bool nextPreset = false;
+    ui::CalibrationTarget target = ui::CalibrationTarget::None;
+    bool hasContrast = false;
+    int8_t contrastDelta = 0;
+    bool playDemo = false;
+  };
+  static constexpr uint8_t kCommandTypeCount = 4;
+
+  struct CommandError {
+    int code = 400;
+    const char* message = "";
+  };
+
+  // What /api/status reports; copied from the loop under snapshotLock_.
+  // version changes whenever any of it does.
+  struct Snapshot {
+    uint32_t version = 0;
+    sensing::EnvironmentReadings env{};
+    bool staConnected = false;
+    String staIp;
+    String apIp;
+    String apSsid;
+    String wifiStatus;
+    String profileStatus;
+    String speciesQuery;
+    bool fetchInProgress = false;
+    uint8_t presetIndex = 0;
+    uint8_t presetCount = 0;
+    bool hasProfile = false;
+    String speciesCommonName;
+    String speciesLatinName;
+    float soilMin = 0.0f;
+    float soilMax = 0.0f;
+    float lightMin = 0.0f;
+    float lightMax = 0.0f;
+    float comfortTempMin = 0.0f;
+    float comfortTempMax = 0.0f;
+    uint16_t wateringIntervalHours = 0;
+  };
+
+  template <void (WebService::*Method)(const HttpRequest&, HttpResponse&)>
+  static void route(void* context, const HttpRequest& request, HttpResponse& response) {
+    (static_cast<WebService*>(context)->*Method)(request, response);
+  }
+
+  void handleRoot(const HttpRequest& request, HttpResponse& response);
+  void handleDashboard(const HttpRequest& request, HttpResponse& response);
+  void handleStatus(const HttpRequest& request, HttpResponse& response);
+  void handleStream(const HttpRequest& request, HttpResponse& response);
+  void handleMetrics(const HttpRequest& request, HttpResponse& response);
+  void handlePlantPost(const HttpRequest& request, HttpResponse& response);
+  void handleCalibratePost(const HttpRequest& request, HttpResponse& response);
+  void handleDisplayPost(const HttpRequest& request, HttpResponse& response);
+  void handleProfileReset(const HttpRequest& request, HttpResponse& response);
+  void handleBatchPost(const HttpRequest& request, HttpResponse& response);
+  void handleNotFound(const HttpRequest& request, HttpResponse& response);
+  void handleOptions(const HttpRequest& request, HttpResponse& response);
+
+  void fillStatus(JsonDocument& doc);
+  // Serializes doc into statusJson_; false when it does not fit.
+  bool cacheStatus(const JsonDocument& doc, uint32_t version);
+  bool queueCommand(const Command& command, HttpResponse& response);
+  bool queueCommands(const Command* commands, uint8_t count, HttpResponse& response);
+  void sendSingleCommand(Command::Type type, JsonObjectConst body, HttpResponse& response);
+  // Checks one command's fields against the handlers that are installed.
+  bool parseCommand(Command::Type type, JsonObjectConst body, Command& command, CommandError& error);
+  static bool parseCommandType(const char* name, Command::Type* type);
+  static const char* commandTypeName(Command::Type type);
+  static bool hasEffect(const Command& command);
+  static void describeCommand(const Command& command, JsonObject result);
+  void runCommand(const Command& command);
+
+  bool sendJsonDocument(HttpResponse& response, const JsonDocument& doc, int code = 200);
   template <size_t Capacity>
-  bool parseJsonPayload(StaticJsonDocument<Capacity>& doc);
-  void sendError(int code, const __FlashStringHelper* message);
-  void sendError(int code, const String& message);
+  bool parseJsonPayload(const HttpRequest& request, HttpResponse& response, StaticJsonDocument<Capacity>& doc);
+  void sendError(HttpResponse& response, int code, const char* message);
+  void publishSample(const sensing::EnvironmentReadings& env, bool full);
+  void publishEvent(const char* type, const JsonDocument& doc);
 
-  WebServer server_{80};
+  static constexpr uint8_t kCommandQueueLength = 8;
+  static constexpr uint8_t kMaxBatchCommands = kCommandQueueLength;
+  static constexpr size_t kStatusJsonCapacity = 1280;
+  static constexpr size_t kStatusDocCapacity = 1536;
+
+  HttpServer server_;
   CommandHandlers handlers_;
   const net::NetworkManager* network_ = nullptr;
+  QueueHandle_t commands_ = nullptr;
+  SemaphoreHandle_t commandLock_ = nullptr;  // keeps a batch whole, see queueCommands()
 
-  sensing::EnvironmentReadings lastEnv_{};
-  display::SystemStatusView lastStatus_;
-  String speciesQuery_;
-  bool fetchInProgress_ = false;
-  uint8_t presetIndex_ = 0;
-  uint8_t presetCount_ = 0;
+  SemaphoreHandle_t snapshotLock_ = nullptr;
+  Snapshot snapshot_;
+  uint32_t stateDigest_ = 0;
   const char* const* presets_ = nullptr;
+
+  // Serialized /api/status for statusVersion_; only the server task touches it.
+  char statusJson_[kStatusJsonCapacity] = {};
+  size_t statusLength_ = 0;
+  uint32_t statusVersion_ = 0;
+  char statusEtag_[12] = {};
+  uint32_t statusBuilds_ = 0;
+  uint32_t statusCacheHits_ = 0;
+  uint32_t statusNotModified_ = 0;
+
+  // /api/batch scratch, too big for the server task's stack next to the
+  // JSON document; only that task touches it.
+  struct BatchScratch {
+    Command commands[kMaxBatchCommands];
+    CommandError errors[kMaxBatchCommands];
+    bool valid[kMaxBatchCommands] = {};
+  };
+  BatchScratch batch_;
+
+  EventStream events_;
+  // What subscribers last saw (samples in tenths); set by a new subscriber so
+  // the next publishState() sends everything.
+  std::atomic<bool> resync_{true};
+  int16_t lastSample_[4] = {};
+  uint8_t lastValid_ = 0;
+  brain::MoodKind lastMood_ = brain::MoodKind::Content;
+  bool lastFetchInProgress_ = false;
+  uint32_t lastFetchDigest_ = 0;
+
+  LoadTest loadTest_;
 };
 
 extern WebService service;
@@ -71,14 +206,17 @@ extern WebService service;
 }  // namespace web
 
 template <size_t Capacity>
-bool web::WebService::parseJsonPayload(StaticJsonDocument<Capacity>& doc) {
-  if (!server_.hasArg("plain")) {
-    sendError(400, F("Missing body"));
+bool web::WebService::parseJsonPayload(const HttpRequest& request, HttpResponse& response,
+                                       StaticJsonDocument<Capacity>& doc) {
+  if (request.bodyLength == 0) {
+    sendError(response, 400, "Missing body");
     return false;
   }
-  DeserializationError err = deserializeJson(doc, server_.arg("plain"));
+  DeserializationError err = deserializeJson(doc, request.body, request.bodyLength);
   if (err) {
-    sendError(400, String(F("JSON parse error: ")) + err.c_str());
+    char message[64];
+    snprintf(message, sizeof(message), "JSON parse error: %s", err.c_str());
+    sendError(response, 400, message);
     return false;
   }
   return true;